@@ -1,23 +1,41 @@
 /* SPDX-License-Identifier: ISC */
 
 #include "euler/app/state.h"
+#include "euler/util/logger.h"
+#include "euler/util/object_registry.h"
+
+static int
+run(const int argc, char **argv, std::string &progname)
+{
+	const auto state = euler::app::make_state(argc, argv);
+	progname = state->log()->progname();
+	if (!state->initialize()) {
+		state->log()->error("Failed to initialize state");
+		return EXIT_FAILURE;
+	}
+	state->log()->info("Initialization complete");
+	int exit_code = 0;
+	while (state->loop(exit_code)) {
+		/* ReSharper disable once CppRedundantControlFlowJump */
+		continue; /* NOLINT(*-redundant-control-flow) */
+	}
+	state->log()->info("Exiting with code {}", exit_code);
+	return exit_code;
+}
 
 int
 main(const int argc, char **argv)
 {
 	try {
-		const auto state = euler::app::make_state(argc, argv);
-		if (!state->initialize()) {
-			state->log()->error("Failed to initialize state");
-			return EXIT_FAILURE;
-		}
-		state->log()->info("Initialization complete");
-		int exit_code = 0;
-		while (state->loop(exit_code)) {
-			/* ReSharper disable once CppRedundantControlFlowJump */
-			continue; /* NOLINT(*-redundant-control-flow) */
+		std::string progname;
+		const auto exit_code = run(argc, argv, progname);
+		/* Anything still alive once the state is released has leaked.
+		 * Its logger went with it, so report through a new one. */
+		if constexpr (euler::util::ObjectRegistry::enabled()) {
+			const auto log = euler::util::make_reference<
+			    euler::util::Logger>(progname, "leaks");
+			euler::util::ObjectRegistry::report(log, { log.get() });
 		}
-		state->log()->info("Exiting with code {}", exit_code);
 		return exit_code;
 	} catch (const std::exception &e) {
 		fprintf(stderr, "Unhandled exception: %s\n", e.what());
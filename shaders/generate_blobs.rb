@@ -4,6 +4,7 @@ require 'pathname'
 require 'fileutils'
 require 'tmpdir'
 require 'mkmf'
+require_relative 'reflect'
 
 def usage(error = true)
   out = error ? $stderr : $stdout
@@ -114,9 +115,11 @@ def compile_shaders(slangc, glslc, path)
       raise "Duplicate shaders found for entry '#{key}'" if $shaders.key?(key)
       raise "Constant #{const} already exists!" if $constants.key?(const)
       print "Compiling shader '#{key}' from path '#{c}'..."
+      data = compile_shader(slangc, glslc, dir, c)
       $shaders[key] = {
         constant: const,
-        data: compile_shader(slangc, glslc, dir, c)
+        data: data,
+        layout: Reflect.reflect(data)
       }
       $constants[const] = true
       puts " done"
@@ -150,6 +153,10 @@ output.open('w') do |fh|
 #include <span>
 #include <unordered_map>
 
+#include "euler/vulkan/shader_layout.h"
+
+using ShaderLayout = euler::vulkan::ShaderLayout;
+
 EOF
   sorted.each do |pair|
     k = pair[0]
@@ -183,23 +190,56 @@ EOF
       else
         fh.write ' '
       end
-      fh.print hex(v[:data], i) + ','
+      fh.print hex(v[:data], v[:data].size - i) + ','
     end
     fh.write "\n"
     fh.puts <<EOF
 	// clang-format on
 };
 EOF
+    layout = v[:layout]
+    fh.puts "static constexpr std::array<ShaderLayout::Binding, " \
+            "#{layout.bindings.size}> #{v[:constant]}_BINDINGS = {{"
+    layout.bindings.each do |b|
+      fh.puts "\t{ #{b.set}, #{b.binding}, vk::DescriptorType::#{b.type}, " \
+              "#{b.count}, \"#{b.name}\" },"
+    end
+    fh.puts '}};'
+    fh.puts "static constexpr std::array<ShaderLayout::SpecConstant, " \
+            "#{layout.spec_constants.size}> #{v[:constant]}_SPEC_CONSTANTS = {{"
+    layout.spec_constants.each do |c|
+      fh.puts "\t{ #{c.id}, \"#{c.name}\", #{c.default} },"
+    end
+    fh.puts '}};'
+    fh.puts "static constexpr std::array<ShaderLayout::EntryPoint, " \
+            "#{layout.entry_points.size}> #{v[:constant]}_ENTRY_POINTS = {{"
+    layout.entry_points.each do |e|
+      fh.puts "\t{ vk::ShaderStageFlagBits::#{e.stage}, \"#{e.name}\" },"
+    end
+    fh.puts '}};'
   end
   fh.puts <<EOF
 
 using Renderer = euler::vulkan::Renderer;
 
-template <size_t N>
+template <size_t N, size_t E, size_t B, size_t S>
 static std::pair<std::string_view, Renderer::ShaderData>
-make_entry(std::string_view key, const std::array<uint8_t, N> &value)
+make_entry(std::string_view key, const std::array<uint8_t, N> &code,
+    const std::array<ShaderLayout::EntryPoint, E> &entry_points,
+    const std::array<ShaderLayout::Binding, B> &bindings,
+    const uint32_t push_constant_size,
+    const std::array<ShaderLayout::SpecConstant, S> &spec_constants)
 {
-	return std::make_pair(key, value);
+	return std::make_pair(key,
+	    Renderer::ShaderData {
+		.code = code,
+		.layout = {
+		    .entry_points = entry_points,
+		    .bindings = bindings,
+		    .push_constant_size = push_constant_size,
+		    .spec_constants = spec_constants,
+		},
+	    });
 }
 
 std::optional<Renderer::ShaderData>
@@ -212,7 +252,10 @@ EOF
     k = pair[0]
     v = pair[1]
     c = v[:constant]
-    fh.puts "\t\tmake_entry(\"#{k}\", #{c}),"
+    layout = v[:layout]
+    fh.puts "\t\tmake_entry(\"#{k}\", #{c}, #{c}_ENTRY_POINTS,"
+    fh.puts "\t\t    #{c}_BINDINGS, #{layout.push_constant_size}, " \
+            "#{c}_SPEC_CONSTANTS),"
   end
   fh.puts <<EOF
 		// clang-format on
@@ -13,7 +13,9 @@ layout(location = 3) in flat uint instanceTextureIndex;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    vec4 colour = texture(sampler2D(tex[instanceTextureIndex], texSampler), fragTexCoord);
+    // Texture positions are in texels
+    vec2 size = vec2(textureSize(sampler2D(tex[nonuniformEXT(instanceTextureIndex)], texSampler), 0));
+    vec4 colour = texture(sampler2D(tex[nonuniformEXT(instanceTextureIndex)], texSampler), fragTexCoord / size);
     outColor = vec4(
             colour.r * fragColour.r,
             colour.g * fragColour.g,
@@ -3,22 +3,22 @@
 #extension GL_EXT_scalar_block_layout : enable
 #extension GL_EXT_nonuniform_qualifier : enable
 
+// Packed 2D instance written by spritebatch.comp
 struct DrawInstance {
-    vec4 texturePos;
-    vec4 colour;
+    vec2 xAxis;
+    vec2 yAxis;
+    vec2 translation;
+    uint texturePos[2];
+    uint colour;
     uint textureIndex;
-    mat4 model;
 };
 
-layout(push_constant) uniform PushBuffer {
-    int cameraIndex;
-} push;
-
+// The camera drawn with, bound at its offset of the camera buffer
 layout(set = 0, binding = 0) uniform UniformBufferObject {
-    mat4 cameras[10];
+    mat4 camera;
 } ubo;
 
-layout(set = 3, binding = 3) readonly buffer ObjectBuffer{
+layout(std430, set = 3, binding = 3) readonly buffer ObjectBuffer{
     DrawInstance objects[];
 } objectBuffer;
 
@@ -48,15 +48,21 @@ out gl_PerVertex {
     vec4 gl_Position;
 };
 
+vec2 unpackTexels(uint packed) {
+    return vec2(packed & 0xffffu, packed >> 16);
+}
+
 void main() {
-    vec2 newPos;
     int instance = gl_VertexIndex / 6;
     int vertexIndex = gl_VertexIndex % 6;
-    newPos.x = vertices[vertexIndex].x * objectBuffer.objects[instance].texturePos.z;
-    newPos.y = vertices[vertexIndex].y * objectBuffer.objects[instance].texturePos.w;
-    gl_Position = ubo.cameras[push.cameraIndex] * objectBuffer.objects[instance].model * vec4(newPos, 1.0, 1.0);
-    fragTexCoord.x = objectBuffer.objects[instance].texturePos.x + (texCoords[vertexIndex].x * objectBuffer.objects[instance].texturePos.z);
-    fragTexCoord.y = objectBuffer.objects[instance].texturePos.y + (texCoords[vertexIndex].y * objectBuffer.objects[instance].texturePos.w);
-    fragColour = objectBuffer.objects[instance].colour;
-    textureIndex = objectBuffer.objects[instance].textureIndex;
+    DrawInstance draw = objectBuffer.objects[instance];
+    vec2 vertex = vertices[vertexIndex];
+    vec2 world = draw.xAxis * vertex.x + draw.yAxis * vertex.y + draw.translation;
+    gl_Position = ubo.camera * vec4(world, 1.0, 1.0);
+    vec2 texturePos = unpackTexels(draw.texturePos[0]);
+    vec2 textureSize = unpackTexels(draw.texturePos[1]);
+    fragTexCoord = texturePos + texCoords[vertexIndex] * textureSize;
+    fragColour = unpackUnorm4x8(draw.colour);
+    // The CPU path leaves the upper half as padding
+    textureIndex = draw.textureIndex & 0xffffu;
 }
\ No newline at end of file
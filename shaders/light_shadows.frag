@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Each light of a pass owns one channel of one of its four mask layers. The
+// masks are blended with max, so a texel is marked once however many edges
+// shadow it.
+layout(location = 0) flat in uint slot;
+
+layout(location = 0) out vec4 mask0;
+layout(location = 1) out vec4 mask1;
+layout(location = 2) out vec4 mask2;
+layout(location = 3) out vec4 mask3;
+
+void main() {
+    vec4 channel = vec4(equal(uvec4(slot % 4), uvec4(0, 1, 2, 3)));
+    uint mask = slot / 4;
+    mask0 = mask == 0 ? channel : vec4(0.0);
+    mask1 = mask == 1 ? channel : vec4(0.0);
+    mask2 = mask == 2 ? channel : vec4(0.0);
+    mask3 = mask == 3 ? channel : vec4(0.0);
+}
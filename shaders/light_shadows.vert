@@ -0,0 +1,71 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The batched counterpart of shadows.vert, VK2D's shadow shader, which
+// draws one light's push constant over one vertex buffer of edges per draw.
+// Here every edge is read from storage and extruded once per instance, one
+// instance per light, so a whole layer of edges casts for up to 16 lights
+// in one draw.
+
+// Must match the Light in vulkan/lighting.cpp
+struct Light {
+    vec2 position;
+    float radius;
+    uint flags;
+    vec4 colour;
+};
+
+const uint CASTS_SHADOWS = 1;
+
+layout(std430, set = 0, binding = 0) readonly buffer Lights {
+    Light lights[];
+} lightBuffer;
+
+// Occluder edges in world space, one segment each
+layout(std430, set = 0, binding = 1) readonly buffer Edges {
+    vec4 edges[];
+} edgeBuffer;
+
+layout(push_constant) uniform PushBuffer {
+    vec2 origin; // World position of the light buffer's top left
+    vec2 extent; // Size of the light buffer in pixels
+    float scale; // Light buffer pixels per world unit
+} push;
+
+// Which channel of the pass's masks the instance's light owns
+layout(location = 0) flat out uint slot;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+float segmentDistance(vec2 p, vec2 a, vec2 b) {
+    vec2 ab = b - a;
+    float t = clamp(dot(p - a, ab) / max(dot(ab, ab), 1e-6), 0.0, 1.0);
+    return distance(p, a + ab * t);
+}
+
+void main() {
+    // One instance per light, starting at the pass's first, and six
+    // vertices per edge, starting at the layer's first
+    Light light = lightBuffer.lights[gl_InstanceIndex];
+    vec4 edge = edgeBuffer.edges[gl_VertexIndex / 6];
+    int corner = gl_VertexIndex % 6;
+    slot = uint(gl_InstanceIndex) % 16;
+    if ((light.flags & CASTS_SHADOWS) == 0
+            || segmentDistance(light.position, edge.xy, edge.zw) > light.radius) {
+        // Degenerate, so nothing is rasterized
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+    // Triangles a, a', b and b, a', b', where ' is projected away from
+    // the light to infinity
+    vec2 point = (corner == 0 || corner == 1 || corner == 4) ? edge.xy : edge.zw;
+    if (corner == 1 || corner == 4 || corner == 5) {
+        vec2 direction = (point - light.position) * push.scale;
+        gl_Position = vec4(direction * 2.0 / push.extent, 0.0, 0.0);
+    } else {
+        vec2 pixel = (point - push.origin) * push.scale;
+        gl_Position = vec4(pixel * 2.0 / push.extent - 1.0, 0.0, 1.0);
+    }
+}
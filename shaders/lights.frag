@@ -0,0 +1,27 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+const uint CASTS_SHADOWS = 1;
+
+// Written by light_shadows.frag, the same size as the light buffer. Casters
+// come first, so a caster's index is its channel: four per layer.
+layout(set = 0, binding = 2) uniform sampler2DArray masks;
+
+layout(location = 0) in vec2 local;
+layout(location = 1) flat in uint slot;
+layout(location = 2) flat in vec4 colour;
+layout(location = 3) flat in uint flags;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Squared falloff from the centre to the edge of the circle
+    float t = max(1.0 - length(local), 0.0);
+    float lit = t * t;
+    if ((flags & CASTS_SHADOWS) != 0) {
+        ivec3 texel = ivec3(gl_FragCoord.xy, slot / 4);
+        lit *= 1.0 - texelFetch(masks, texel, 0)[slot % 4];
+    }
+    // Added over the ambient colour; alpha is left alone
+    outColor = vec4(colour.rgb * colour.a * lit, 0.0);
+}
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Must match the Light in vulkan/lighting.cpp
+struct Light {
+    vec2 position;
+    float radius;
+    uint flags;
+    vec4 colour;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Lights {
+    Light lights[];
+} lightBuffer;
+
+layout(push_constant) uniform PushBuffer {
+    vec2 origin; // World position of the light buffer's top left
+    vec2 extent; // Size of the light buffer in pixels
+    float scale; // Light buffer pixels per world unit
+} push;
+
+layout(location = 0) out vec2 local;
+layout(location = 1) flat out uint slot;
+layout(location = 2) flat out vec4 colour;
+layout(location = 3) flat out uint flags;
+
+vec2 corners[] = {
+    vec2(-1.0f, -1.0f),
+    vec2(1.0f, -1.0f),
+    vec2(1.0f, 1.0f),
+    vec2(1.0f, 1.0f),
+    vec2(-1.0f, 1.0f),
+    vec2(-1.0f, -1.0f),
+};
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main() {
+    // One instance per light, a quad covering its radius
+    Light light = lightBuffer.lights[gl_InstanceIndex];
+    local = corners[gl_VertexIndex];
+    vec2 world = light.position + local * light.radius;
+    vec2 pixel = (world - push.origin) * push.scale;
+    gl_Position = vec4(pixel * 2.0 / push.extent - 1.0, 0.0, 1.0);
+    slot = gl_InstanceIndex;
+    colour = light.colour;
+    flags = light.flags;
+}
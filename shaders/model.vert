@@ -1,8 +1,11 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Number of camera matrices, specialized per pipeline
+layout(constant_id = 0) const int CAMERA_COUNT = 10;
+
 layout(set = 0, binding = 0) uniform UniformBufferObject {
-    mat4 viewproj[10];
+    mat4 viewproj[CAMERA_COUNT];
 } ubo;
 
 layout(push_constant) uniform PushBuffer {
@@ -0,0 +1,200 @@
+# Minimal SPIR-V reflection for generate_blobs.rb: entry points, descriptor
+# bindings, push constant block size and specialization constants.
+
+module Reflect
+  SPIRV_MAGIC = 0x07230203
+
+  # Opcodes
+  OP_NAME = 5
+  OP_ENTRY_POINT = 15
+  OP_TYPE_BOOL = 20
+  OP_TYPE_INT = 21
+  OP_TYPE_FLOAT = 22
+  OP_TYPE_VECTOR = 23
+  OP_TYPE_MATRIX = 24
+  OP_TYPE_IMAGE = 25
+  OP_TYPE_SAMPLER = 26
+  OP_TYPE_SAMPLED_IMAGE = 27
+  OP_TYPE_ARRAY = 28
+  OP_TYPE_RUNTIME_ARRAY = 29
+  OP_TYPE_STRUCT = 30
+  OP_TYPE_POINTER = 32
+  OP_CONSTANT = 43
+  OP_SPEC_CONSTANT_TRUE = 48
+  OP_SPEC_CONSTANT_FALSE = 49
+  OP_SPEC_CONSTANT = 50
+  OP_VARIABLE = 59
+  OP_DECORATE = 71
+  OP_MEMBER_DECORATE = 72
+
+  # Decorations
+  SPEC_ID = 1
+  BLOCK = 2
+  BUFFER_BLOCK = 3
+  ARRAY_STRIDE = 6
+  MATRIX_STRIDE = 7
+  BINDING = 33
+  DESCRIPTOR_SET = 34
+  OFFSET = 35
+
+  # Storage classes
+  UNIFORM_CONSTANT = 0
+  UNIFORM = 2
+  PUSH_CONSTANT = 9
+  STORAGE_BUFFER = 12
+
+  # Execution models, as vk::ShaderStageFlagBits names
+  STAGES = {
+    0 => 'eVertex',
+    4 => 'eFragment',
+    5 => 'eCompute'
+  }.freeze
+
+  Binding = Struct.new(:set, :binding, :type, :count, :name)
+  SpecConstant = Struct.new(:id, :name, :default)
+  EntryPoint = Struct.new(:stage, :name)
+  Layout = Struct.new(:entry_points, :bindings, :push_constant_size,
+                      :spec_constants)
+
+  def self.string(words)
+    words.pack('V*').unpack1('Z*')
+  end
+
+  def self.reflect(data)
+    words = data.unpack('V*')
+    raise 'Not a SPIR-V module' unless words[0] == SPIRV_MAGIC
+
+    names = {}
+    decorations = Hash.new { |h, k| h[k] = {} }
+    member_decorations = Hash.new { |h, k| h[k] = Hash.new { |m, i| m[i] = {} } }
+    types = {}
+    constants = {}
+    variables = []
+    spec_constants = []
+    entry_points = []
+
+    i = 5
+    while i < words.size
+      count = words[i] >> 16
+      op = words[i] & 0xFFFF
+      raise 'Malformed SPIR-V module' if count.zero?
+
+      args = words[i + 1, count - 1]
+      case op
+      when OP_NAME
+        names[args[0]] = string(args[1..])
+      when OP_ENTRY_POINT
+        stage = STAGES[args[0]]
+        raise "Unsupported execution model #{args[0]}" if stage.nil?
+
+        entry_points << EntryPoint.new(stage, string(args[2..]))
+      when OP_DECORATE
+        decorations[args[0]][args[1]] = args[2]
+      when OP_MEMBER_DECORATE
+        member_decorations[args[0]][args[1]][args[2]] = args[3]
+      when OP_TYPE_BOOL, OP_TYPE_SAMPLER
+        types[args[0]] = { op: op }
+      when OP_TYPE_INT, OP_TYPE_FLOAT
+        types[args[0]] = { op: op, width: args[1] }
+      when OP_TYPE_VECTOR, OP_TYPE_MATRIX
+        types[args[0]] = { op: op, element: args[1], count: args[2] }
+      when OP_TYPE_IMAGE
+        types[args[0]] = { op: op, sampled: args[6] }
+      when OP_TYPE_SAMPLED_IMAGE, OP_TYPE_RUNTIME_ARRAY
+        types[args[0]] = { op: op, element: args[1] }
+      when OP_TYPE_ARRAY
+        types[args[0]] = { op: op, element: args[1], length: args[2] }
+      when OP_TYPE_STRUCT
+        types[args[0]] = { op: op, members: args[1..] }
+      when OP_TYPE_POINTER
+        types[args[0]] = { op: op, storage: args[1], element: args[2] }
+      when OP_CONSTANT, OP_SPEC_CONSTANT
+        constants[args[1]] = args[2]
+        spec_constants << [args[1], args[2]] if op == OP_SPEC_CONSTANT
+      when OP_SPEC_CONSTANT_TRUE, OP_SPEC_CONSTANT_FALSE
+        constants[args[1]] = op == OP_SPEC_CONSTANT_TRUE ? 1 : 0
+        spec_constants << [args[1], constants[args[1]]]
+      when OP_VARIABLE
+        variables << { type: args[0], id: args[1], storage: args[2] }
+      end
+      i += count
+    end
+
+    size_of = lambda do |type_id, stride = nil|
+      type = types.fetch(type_id)
+      case type[:op]
+      when OP_TYPE_BOOL then 4
+      when OP_TYPE_INT, OP_TYPE_FLOAT then type[:width] / 8
+      when OP_TYPE_VECTOR then size_of.call(type[:element]) * type[:count]
+      when OP_TYPE_MATRIX
+        (stride || size_of.call(type[:element])) * type[:count]
+      when OP_TYPE_ARRAY
+        array_stride = decorations[type_id][ARRAY_STRIDE]
+        array_stride ||= size_of.call(type[:element])
+        array_stride * constants.fetch(type[:length])
+      when OP_TYPE_RUNTIME_ARRAY then 0
+      when OP_TYPE_STRUCT
+        type[:members].each_with_index.map do |member, m|
+          decoration = member_decorations[type_id][m]
+          offset = decoration[OFFSET] || 0
+          offset + size_of.call(member, decoration[MATRIX_STRIDE])
+        end.max || 0
+      else raise "Can't size SPIR-V type #{type[:op]}"
+      end
+    end
+
+    bindings = []
+    push_constant_size = 0
+    variables.each do |variable|
+      pointer = types.fetch(variable[:type])
+      type_id = pointer[:element]
+      type = types.fetch(type_id)
+      if variable[:storage] == PUSH_CONSTANT
+        push_constant_size = [push_constant_size, size_of.call(type_id)].max
+        next
+      end
+      next unless [UNIFORM_CONSTANT, UNIFORM, STORAGE_BUFFER].include?(variable[:storage])
+
+      decoration = decorations[variable[:id]]
+      next unless decoration.key?(BINDING)
+
+      # Arrays of descriptors; unsized ones are bindless tables
+      count = 1
+      if type[:op] == OP_TYPE_ARRAY
+        count = constants.fetch(type[:length])
+        type_id = type[:element]
+      elsif type[:op] == OP_TYPE_RUNTIME_ARRAY
+        count = 0
+        type_id = type[:element]
+      end
+      type = types.fetch(type_id)
+      descriptor =
+        case variable[:storage]
+        when STORAGE_BUFFER then 'eStorageBuffer'
+        when UNIFORM
+          decorations[type_id].key?(BUFFER_BLOCK) ? 'eStorageBuffer' : 'eUniformBuffer'
+        else
+          case type[:op]
+          when OP_TYPE_SAMPLER then 'eSampler'
+          when OP_TYPE_SAMPLED_IMAGE then 'eCombinedImageSampler'
+          when OP_TYPE_IMAGE
+            type[:sampled] == 2 ? 'eStorageImage' : 'eSampledImage'
+          else raise "Unsupported descriptor type #{type[:op]}"
+          end
+        end
+      bindings << Binding.new(decoration[DESCRIPTOR_SET] || 0,
+                              decoration[BINDING], descriptor, count,
+                              names[variable[:id]] || '')
+    end
+
+    specs = spec_constants.filter_map do |id, default|
+      spec_id = decorations[id][SPEC_ID]
+      next if spec_id.nil?
+
+      SpecConstant.new(spec_id, names[id] || '', default)
+    end
+
+    Layout.new(entry_points, bindings.sort_by { |b| [b.set, b.binding] },
+               push_constant_size, specs.sort_by(&:id))
+  end
+end
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Sprites alpha blended into a transparent target, so premultiplied
+layout(set = 0, binding = 0) uniform sampler2D sprites;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec4 colour = texelFetch(sprites, ivec2(gl_FragCoord.xy), 0);
+    outColor = colour.a > 0.0f ? vec4(colour.rgb / colour.a, colour.a)
+                               : vec4(0.0f);
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_APP_SCRIPT_H
+#define EULER_APP_SCRIPT_H
+
+#include <string>
+#include <string_view>
+
+#include "euler/util/asset_cache.h"
+
+namespace euler::app {
+
+/* Ruby source loaded through the asset cache, e.g. by Kernel#require. */
+class Script final : public util::Asset {
+public:
+	explicit Script(const util::Storage::DataView data)
+	    : _source(reinterpret_cast<const char *>(data.data()), data.size())
+	{
+	}
+
+	~Script() override = default;
+
+	[[nodiscard]] std::string_view
+	source() const
+	{
+		return _source;
+	}
+
+	[[nodiscard]] size_t
+	size_bytes() const override
+	{
+		return _source.size();
+	}
+
+private:
+	std::string _source;
+};
+
+} /* namespace euler::app */
+
+#endif /* EULER_APP_SCRIPT_H */
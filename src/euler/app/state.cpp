@@ -20,16 +20,20 @@
 #include "euler/app/event.h"
 #include "euler/app/game_ext.h"
 #include "euler/app/graphics_ext.h"
+#include "euler/app/script.h"
 #include "euler/app/gui_ext.h"
 #include "euler/app/util_ext.h"
 #include "euler/app/vulkan_ext.h"
 #include "euler/app/window.h"
 
+#include "euler/util/object_registry.h"
 #include "euler/util/storage.h"
 #include "euler/util/thread.h"
 
 static auto state_count = std::binary_semaphore(1);
 static std::thread::id main_thread_id;
+/* Decoded assets kept resident once nothing else references them. */
+static constexpr size_t ASSET_BUDGET = 64 * 1024 * 1024;
 
 // static constexpr SDL_InitFlags SDL_FLAGS = //
 //     SDL_INIT_AUDIO			   //
@@ -121,7 +125,9 @@ euler::app::State::make_exception(RObject *exc) const
 
 euler::app::State::State(const util::Config &config)
     : _config(config)
+    , _frame_arena(util::make_reference<util::FrameArena>())
 {
+	util::ObjectRegistry::set_capture_sites(config.object_sites);
 	_log = util::make_reference<util::Logger>(config.progname, "app",
 	    config.log_level);
 	_log->debug("Creating state");
@@ -325,20 +331,50 @@ euler::app::State::load_core()
 	 * - Physics
 	 */
 	static std::once_flag once;
+	static bool user_dir = false;
 	std::call_once(once, [&]() {
 		log()->debug("Initializing global state...");
 		main_thread_id = std::this_thread::get_id();
 		log()->debug("Initializing global storage...");
 		init_fs(_config.progname.c_str());
+		user_dir = mount_user_dir(_config.progname.c_str());
+		if (!user_dir) {
+			log()->warn("No user data directory, nothing will "
+				    "be saved");
+		}
+		if (_config.headless) {
+			/* Must be chosen before SDL_Init. The offscreen
+			 * driver creates Vulkan surfaces through
+			 * VK_EXT_headless_surface, so no display is needed. */
+			log()->info("Running headless");
+			SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+			SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+		}
 		log()->debug("Initializing global SDL...");
 		SDL_Init(sdl_init_flags());
 		log()->debug("Global initialization complete");
 	});
 	log()->debug("Creating window");
-	_window = util::make_reference<Window>(_log, _config.progname);
+	_window = util::make_reference<Window>(_log, _config.progname,
+	    _config.headless ? Window::HEADLESS_FLAGS : Window::DEFAULT_FLAGS);
 	log()->debug("Initializing Vulkan");
 	_renderer = util::make_reference<vulkan::Renderer>(log());
-	_renderer->initialize(_window);
+	if (user_dir) {
+		_user_storage = util::make_reference<util::Storage>();
+		_assets = util::make_reference<util::AssetCache>(_user_storage,
+		    ASSET_BUDGET);
+	}
+	_renderer->initialize(_window, _config.renderer, _user_storage);
+	_renderer->pipeline_cache()->prewarm();
+	if (_config.headless) {
+		_window->set_offscreen(
+		    util::make_reference<vulkan::OffscreenTarget>(_renderer,
+			Window::DEFAULT_WIDTH, Window::DEFAULT_HEIGHT));
+		_window->capture_frames(
+		    { _config.capture_frames.begin(),
+			_config.capture_frames.end() },
+		    _config.capture_directory);
+	}
 
 	log()->debug("Initializing interpreter");
 	_mrb = mrb_open();
@@ -449,7 +485,11 @@ bool
 euler::app::State::update(int &exit_code)
 {
 	assert(util::is_main_thread());
+	/* In low-latency mode, sleep so that input is polled as late as
+	 * possible. */
+	_window->frame_pacer()->wait();
 	const auto gc_idx = mrb_gc_arena_save(_mrb);
+	_frame_arena->begin_frame();
 	system()->tick();
 	auto fn = [&](const SDL_Event &ev) {
 		//
@@ -460,13 +500,18 @@ euler::app::State::update(int &exit_code)
 	assert(_methods.update);
 	if (!app_update(_system->dt())) return false;
 	mrb_gc_arena_restore(_mrb, gc_idx);
-	_window->draw(exit_code, [&](int &retval) {
+	_window->draw(exit_code, *_frame_arena, [&](int &retval) {
 		if (_methods.draw && !app_draw()) {
 			retval = EXIT_FAILURE;
 			return false;
 		}
 		return true;
 	});
+	if (_config.max_frames != 0
+	    && _window->frame_count() >= _config.max_frames) {
+		_log->info("Stopping after {} frames", _config.max_frames);
+		return false;
+	}
 
 	return true;
 }
@@ -480,8 +525,15 @@ euler::app::State::require(const char *path)
 		_log->debug("Module '{}' already loaded", path);
 		return false;
 	}
-	const auto data = _user_storage->read_file(path);
-	if (!load_text(path, data)) {
+	if (_assets == nullptr) {
+		_log->error("No storage to load module '{}' from", path);
+		return false;
+	}
+	const auto script = _assets->load<Script>(path,
+	    [](const util::Storage::DataView data) {
+		    return util::make_reference<Script>(data);
+	    });
+	if (!load_text(path, script->source())) {
 		_log->error("Failed to load module '{}'", path);
 		return false;
 	}
@@ -14,6 +14,8 @@
 #include "euler/app/system.h"
 #include "euler/graphics/window.h"
 #include "euler/gui/window.h"
+#include "euler/util/arena.h"
+#include "euler/util/asset_cache.h"
 #include "euler/util/config.h"
 #include "euler/util/logger.h"
 #include "euler/util/mruby_exception.h"
@@ -64,6 +66,32 @@ public:
 		return _title_storage;
 	}
 
+	[[nodiscard]] util::Reference<util::FrameArena>
+	frame_arena() const override
+	{
+		return _frame_arena;
+	}
+
+	/* Decoded assets read from user storage, such as required scripts.
+	 * Null without a user data directory. */
+	[[nodiscard]] util::Reference<util::AssetCache>
+	assets() const
+	{
+		return _assets;
+	}
+
+	[[nodiscard]] util::Reference<vulkan::Renderer>
+	renderer() const
+	{
+		return _renderer;
+	}
+
+	[[nodiscard]] util::Reference<graphics::Window>
+	window() const
+	{
+		return _window;
+	}
+
 	static util::Reference<State>
 	get(const mrb_state *mrb)
 	{
@@ -288,6 +316,8 @@ private:
 	util::Reference<util::Logger> _log;
 	util::Reference<util::Storage> _user_storage;
 	util::Reference<util::Storage> _title_storage;
+	util::Reference<util::FrameArena> _frame_arena;
+	util::Reference<util::AssetCache> _assets;
 	util::Reference<vulkan::Renderer> _renderer;
 	util::Reference<graphics::Window> _window;
 	util::Reference<gui::Window> _gui;
@@ -201,6 +201,35 @@ storage_write_file(mrb_state *mrb, const mrb_value self_value)
 	}
 }
 
+static mrb_value
+storage_write_file_async(mrb_state *mrb, const mrb_value self_value)
+{
+	const auto self = unwrap<Storage>(mrb, self_value, &STORAGE_TYPE);
+	char *path;
+	mrb_value content_value;
+	mrb_get_args(mrb, "zS", &path, &content_value);
+	auto content = std::string(RSTRING_PTR(content_value),
+	    RSTRING_LEN(content_value));
+	try {
+		self->write_file_async(path, std::move(content));
+		return mrb_nil_value();
+	} catch (const std::exception &e) {
+		mrb_raise(mrb, E_RUNTIME_ERROR, e.what());
+	}
+}
+
+static mrb_value
+storage_flush(mrb_state *mrb, const mrb_value self_value)
+{
+	const auto self = unwrap<Storage>(mrb, self_value, &STORAGE_TYPE);
+	try {
+		self->flush();
+		return mrb_nil_value();
+	} catch (const std::exception &e) {
+		mrb_raise(mrb, E_RUNTIME_ERROR, e.what());
+	}
+}
+
 static mrb_value
 storage_create_directory(mrb_state *mrb, const mrb_value self_value)
 {
@@ -230,6 +259,10 @@ init_storage(mrb_state *mrb, Modules &mod)
 	    MRB_ARGS_REQ(1));
 	mrb_define_method(mrb, storage, "write_file", storage_write_file,
 	    MRB_ARGS_REQ(2));
+	mrb_define_method(mrb, storage, "write_file_async",
+	    storage_write_file_async, MRB_ARGS_REQ(2));
+	mrb_define_method(mrb, storage, "flush", storage_flush,
+	    MRB_ARGS_NONE());
 	mrb_define_method(mrb, storage, "create_directory",
 	    storage_create_directory, MRB_ARGS_REQ(1));
 }
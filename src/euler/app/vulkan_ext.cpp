@@ -2,12 +2,198 @@
 
 #include "euler/app/vulkan_ext.h"
 
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include <mruby/array.h>
+#include <mruby/string.h>
+
+using PresentMode = euler::util::RendererConfig::PresentMode;
+
+static euler::util::Reference<euler::vulkan::Renderer>
+renderer(mrb_state *mrb)
+{
+	const auto state = euler::app::State::get(mrb);
+	return state->renderer();
+}
+
+template <typename Fn>
+static void
+update_settings(mrb_state *mrb, Fn &&fn)
+{
+	const auto r = renderer(mrb);
+	auto settings = r->settings();
+	fn(settings);
+	try {
+		r->set_settings(settings);
+	} catch (const std::exception &e) {
+		mrb_raise(mrb, E_RUNTIME_ERROR, e.what());
+	}
+}
+
+/* Ruby spells present modes as symbols, so fifo-relaxed is :fifo_relaxed */
+static mrb_value
+present_mode_value(mrb_state *mrb, const PresentMode mode)
+{
+	auto name = std::string(
+	    euler::util::RendererConfig::present_mode_name(mode));
+	std::ranges::replace(name, '-', '_');
+	return mrb_symbol_value(mrb_intern(mrb, name.data(), name.size()));
+}
+
+static PresentMode
+value_to_present_mode(mrb_state *mrb, const mrb_value value)
+{
+	std::string name;
+	if (mrb_symbol_p(value)) {
+		name = mrb_sym_name(mrb, mrb_symbol(value));
+	} else if (mrb_string_p(value)) {
+		name = std::string(RSTRING_PTR(value), RSTRING_LEN(value));
+	} else {
+		mrb_raise(mrb, E_TYPE_ERROR,
+		    "Present mode must be a symbol or string");
+	}
+	std::ranges::replace(name, '_', '-');
+	const auto mode = euler::util::RendererConfig::parse_present_mode(name);
+	if (!mode.has_value())
+		mrb_raisef(mrb, E_ARGUMENT_ERROR, "Unknown present mode: %v",
+		    value);
+	return *mode;
+}
+
+static mrb_value
+vulkan_msaa(mrb_state *mrb, mrb_value)
+{
+	return mrb_int_value(mrb, renderer(mrb)->settings().msaa);
+}
+
+static mrb_value
+vulkan_set_msaa(mrb_state *mrb, mrb_value)
+{
+	mrb_int samples;
+	mrb_get_args(mrb, "i", &samples);
+	if (samples < 1 || samples > 16)
+		mrb_raise(mrb, E_ARGUMENT_ERROR,
+		    "MSAA sample count must be between 1 and 16");
+	update_settings(mrb, [&](euler::util::RendererConfig &settings) {
+		settings.msaa = static_cast<uint32_t>(samples);
+	});
+	return mrb_int_value(mrb, renderer(mrb)->settings().msaa);
+}
+
+static mrb_value
+vulkan_present_mode(mrb_state *mrb, mrb_value)
+{
+	return present_mode_value(mrb, renderer(mrb)->settings().present_mode);
+}
+
+static mrb_value
+vulkan_set_present_mode(mrb_state *mrb, mrb_value)
+{
+	mrb_value mode_value;
+	mrb_get_args(mrb, "o", &mode_value);
+	const auto mode = value_to_present_mode(mrb, mode_value);
+	update_settings(mrb, [&](euler::util::RendererConfig &settings) {
+		settings.present_mode = mode;
+	});
+	return present_mode_value(mrb, renderer(mrb)->settings().present_mode);
+}
+
+static mrb_value
+vulkan_validation(mrb_state *mrb, mrb_value)
+{
+	return mrb_bool_value(renderer(mrb)->settings().validation);
+}
+
+static mrb_value
+vulkan_frames_in_flight(mrb_state *mrb, mrb_value)
+{
+	return mrb_int_value(mrb, renderer(mrb)->settings().frames_in_flight);
+}
+
+static mrb_value
+vulkan_low_latency(mrb_state *mrb, mrb_value)
+{
+	return mrb_bool_value(renderer(mrb)->settings().low_latency);
+}
+
+static mrb_value
+vulkan_set_low_latency(mrb_state *mrb, mrb_value)
+{
+	mrb_bool enabled;
+	mrb_get_args(mrb, "b", &enabled);
+	update_settings(mrb, [&](euler::util::RendererConfig &settings) {
+		settings.low_latency = enabled;
+	});
+	return mrb_bool_value(enabled);
+}
+
+static mrb_value
+vulkan_frame_limit(mrb_state *mrb, mrb_value)
+{
+	return mrb_float_value(mrb, renderer(mrb)->settings().frame_limit);
+}
+
+static mrb_value
+vulkan_set_frame_limit(mrb_state *mrb, mrb_value)
+{
+	mrb_float hz;
+	mrb_get_args(mrb, "f", &hz);
+	if (!(hz >= 0))
+		mrb_raise(mrb, E_ARGUMENT_ERROR,
+		    "Frame limit must be non-negative");
+	update_settings(mrb, [&](euler::util::RendererConfig &settings) {
+		settings.frame_limit = hz;
+	});
+	return mrb_float_value(mrb, hz);
+}
+
+/* [last, mean, p99, max] input-to-present times in milliseconds over the
+ * recent frames. */
+static mrb_value
+vulkan_input_latency(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::app::State::get(mrb);
+	const auto latency = state->window()->frame_pacer()->latency();
+	const mrb_value values[] = {
+		mrb_float_value(mrb, latency.last.count()),
+		mrb_float_value(mrb, latency.mean.count()),
+		mrb_float_value(mrb, latency.p99.count()),
+		mrb_float_value(mrb, latency.max.count()),
+	};
+	return mrb_ary_new_from_values(mrb, std::size(values), values);
+}
+
 void
 euler::app::init_vulkan(util::Reference<State> state)
 {
 	state->log()->info("Initializing Euler::Vulkan...");
 	auto mrb = state->mrb();
 	auto &mod = state->module();
-	mod.util.module = mrb_define_module_under(mrb, mod.module, "Vulkan");
+	mod.vulkan.module = mrb_define_module_under(mrb, mod.module, "Vulkan");
+	const auto vulkan = mod.vulkan.module;
+	mrb_define_module_function(mrb, vulkan, "msaa", vulkan_msaa,
+	    MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "msaa=", vulkan_set_msaa,
+	    MRB_ARGS_REQ(1));
+	mrb_define_module_function(mrb, vulkan, "present_mode",
+	    vulkan_present_mode, MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "present_mode=",
+	    vulkan_set_present_mode, MRB_ARGS_REQ(1));
+	mrb_define_module_function(mrb, vulkan, "validation?",
+	    vulkan_validation, MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "frames_in_flight",
+	    vulkan_frames_in_flight, MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "low_latency?",
+	    vulkan_low_latency, MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "low_latency=",
+	    vulkan_set_low_latency, MRB_ARGS_REQ(1));
+	mrb_define_module_function(mrb, vulkan, "frame_limit",
+	    vulkan_frame_limit, MRB_ARGS_NONE());
+	mrb_define_module_function(mrb, vulkan, "frame_limit=",
+	    vulkan_set_frame_limit, MRB_ARGS_REQ(1));
+	mrb_define_module_function(mrb, vulkan, "input_latency",
+	    vulkan_input_latency, MRB_ARGS_NONE());
 	state->log()->info("Euler::Vulkan initialized");
-}
\ No newline at end of file
+}
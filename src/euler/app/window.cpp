@@ -3,7 +3,7 @@
 #include "euler/app/window.h"
 
 euler::app::Window::Window(const util::Reference<util::Logger> &log,
-    const std::string &progname)
-	    : gui::Window(log, progname)
+    const std::string &progname, const SDL_WindowFlags flags)
+	    : gui::Window(log, progname, flags)
 {
 }
\ No newline at end of file
@@ -9,7 +9,8 @@
 namespace euler::app {
 class Window final : public gui::Window {
 public:
-	Window(const util::Reference<util::Logger> &log, const std::string &progname);
+	Window(const util::Reference<util::Logger> &log, const std::string &progname,
+	    SDL_WindowFlags flags = DEFAULT_FLAGS);
 	~Window() override = default;
 
 };
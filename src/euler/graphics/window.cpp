@@ -39,8 +39,12 @@ euler::graphics::Window::poll_event(SDL_Event &e,
 	bool quit = false;
 	start_input();
 	[[maybe_unused]] auto guard = input_guard();
+	frame_pacer()->input_sampled();
 	while (SDL_PollEvent(&e)) {
 		_log->debug("Received event {}", e.type);
+		if (e.type == SDL_EVENT_WINDOW_DISPLAY_CHANGED
+		    || e.type == SDL_EVENT_DISPLAY_CURRENT_MODE_CHANGED)
+			refresh_display();
 		quit = !fn(e);
 		if (quit) break;
 		if (process_gui_event(e)) continue;
@@ -24,6 +24,9 @@ public:
 	    | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY;
 	static constexpr int DEFAULT_WIDTH = 1280;
 	static constexpr int DEFAULT_HEIGHT = 720;
+	/* For SDL's offscreen video driver, which presents nowhere. */
+	static constexpr auto HEADLESS_FLAGS = SDL_WINDOW_VULKAN
+	    | SDL_WINDOW_HIDDEN;
 	explicit Window(const util::Reference<util::Logger> &log,
 	    const std::string &title = "Euler Game", int width = DEFAULT_WIDTH,
 	    int height = DEFAULT_HEIGHT, SDL_WindowFlags flags = DEFAULT_FLAGS);
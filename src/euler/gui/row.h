@@ -6,12 +6,17 @@
 #include <functional>
 
 #include "euler/util/object.h"
+#include "euler/util/pool.h"
 
 namespace euler::gui {
 class Widget;
 
-class Row final : public util::Object {
+/* Rows are created and dropped every frame while building the GUI. */
+class Row final : public util::Object, public util::Pooled<Row> {
 public:
+	/* Only ever touched from the main thread while building the GUI. */
+	using RefCount = util::LocalRefCount;
+
 	Row(bool dynamic, float height, int cols,
 	    const util::Reference<Widget> &window);
 
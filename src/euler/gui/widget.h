@@ -14,6 +14,9 @@ class Window;
 
 class Widget final : public util::Object {
 public:
+	/* Only ever touched from the main thread while building the GUI. */
+	using RefCount = util::LocalRefCount;
+
 	struct Flags {
 		bool border : 1 = false;
 		bool moveable : 1 = false;
@@ -15,6 +15,8 @@ euler::gui::Window::process_gui_event(SDL_Event &e)
 }
 
 euler::gui::Window::Window(const util::Reference<util::Logger> &parent,
-    const std::string &progname) : graphics::Window(parent, progname)
+    const std::string &progname, const SDL_WindowFlags flags)
+    : graphics::Window(parent, progname, DEFAULT_WIDTH, DEFAULT_HEIGHT,
+	  flags)
 {
 }
@@ -25,7 +25,8 @@ namespace euler::gui {
 class Window : public graphics::Window {
 public:
 	Window(const util::Reference<util::Logger> &parent,
-	    const std::string &progname);
+	    const std::string &progname,
+	    SDL_WindowFlags flags = graphics::Window::DEFAULT_FLAGS);
 	~Window() override = default;
 	void widget(const char *title,
 	    const std::function<void(const util::Reference<Widget> &)> &fn,
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+euler::util::Arena::Arena(const size_t chunk_size)
+    : _chunk_size(chunk_size)
+{
+}
+
+euler::util::Arena::~Arena() { release(); }
+
+void *
+euler::util::Arena::do_allocate(const size_t bytes, const size_t alignment)
+{
+	auto aligned = [&] {
+		const auto addr = reinterpret_cast<uintptr_t>(_cursor);
+		return reinterpret_cast<std::byte *>(
+		    (addr + alignment - 1) & ~(alignment - 1));
+	};
+	auto ptr = aligned();
+	if (_cursor == nullptr || ptr + bytes > _end) {
+		grow(bytes + alignment);
+		ptr = aligned();
+	}
+	_used += ptr + bytes - _cursor;
+	_cursor = ptr + bytes;
+	_high_water = std::max(_high_water, _used);
+	return ptr;
+}
+
+void
+euler::util::Arena::reset()
+{
+	if (_chunks.size() > 1) {
+		release();
+		grow(_high_water);
+	} else if (!_chunks.empty()) {
+		_cursor = _chunks.front().data;
+		_end = _cursor + _chunks.front().size;
+	}
+	_used = 0;
+}
+
+void
+euler::util::Arena::grow(const size_t min_size)
+{
+	/* Wasted tail space of the old chunk counts as used so that the
+	 * high-water mark is enough to hold a whole frame in one chunk. */
+	_used += _end - _cursor;
+	/* Grow geometrically so a frame needs only a few chunks before the
+	 * next reset coalesces them. */
+	const size_t size = std::max({ _chunk_size, min_size, _capacity });
+	const auto data = static_cast<std::byte *>(::operator new(size));
+	_chunks.push_back(Chunk { data, size });
+	_capacity += size;
+	_cursor = data;
+	_end = data + size;
+}
+
+void
+euler::util::Arena::release()
+{
+	for (const auto &chunk : _chunks) ::operator delete(chunk.data);
+	_chunks.clear();
+	_cursor = nullptr;
+	_end = nullptr;
+	_capacity = 0;
+}
+
+euler::util::FrameArena::FrameArena(const size_t chunk_size)
+    : _arenas { Arena(chunk_size), Arena(chunk_size) }
+{
+}
+
+void
+euler::util::FrameArena::begin_frame()
+{
+	++_frame;
+	current().reset();
+}
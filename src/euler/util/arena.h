@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_ARENA_H
+#define EULER_UTIL_ARENA_H
+
+#include <array>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "euler/util/object.h"
+
+namespace euler::util {
+
+/*
+ * Bump allocator. Individual deallocations are no-ops; everything is
+ * released at once by reset(). Destructors are never run, so anything
+ * placed here must either be trivially destructible or be destroyed by its
+ * owner before the arena is reset.
+ *
+ * Not thread-safe.
+ */
+class Arena final : public std::pmr::memory_resource {
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+	explicit Arena(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+	~Arena() override;
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	/* Invalidates every allocation made since the last reset. If the
+	 * arena had to grow, its chunks are coalesced into a single one large
+	 * enough for the high-water mark, so a steady workload settles into
+	 * one chunk and never allocates again. */
+	void reset();
+
+	[[nodiscard]] size_t
+	used() const
+	{
+		return _used;
+	}
+
+	[[nodiscard]] size_t
+	capacity() const
+	{
+		return _capacity;
+	}
+
+	[[nodiscard]] size_t
+	high_water() const
+	{
+		return _high_water;
+	}
+
+protected:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+
+	void
+	do_deallocate(void *, size_t, size_t) override
+	{
+	}
+
+	bool
+	do_is_equal(const memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+private:
+	struct Chunk {
+		std::byte *data;
+		size_t size;
+	};
+
+	void grow(size_t min_size);
+	void release();
+
+	size_t _chunk_size;
+	std::vector<Chunk> _chunks;
+	std::byte *_cursor = nullptr;
+	std::byte *_end = nullptr;
+	/* Bytes handed out, including alignment padding. */
+	size_t _used = 0;
+	size_t _capacity = 0;
+	size_t _high_water = 0;
+};
+
+/*
+ * Double-buffered arena for data that lives for a single frame: command
+ * lists, scratch vectors, formatted strings. begin_frame() swaps buffers and
+ * resets the new current one, so allocations from the previous frame stay
+ * valid for one more frame, e.g. for work the GPU is still consuming.
+ *
+ * Main thread only.
+ */
+class FrameArena final : public Object {
+public:
+	explicit FrameArena(size_t chunk_size = Arena::DEFAULT_CHUNK_SIZE);
+	~FrameArena() override = default;
+
+	void begin_frame();
+
+	[[nodiscard]] Arena &
+	current()
+	{
+		return _arenas[_frame % _arenas.size()];
+	}
+
+	[[nodiscard]] Arena &
+	previous()
+	{
+		return _arenas[(_frame + 1) % _arenas.size()];
+	}
+
+	/* For std::pmr containers, e.g.
+	 * std::pmr::vector<Command> cmds(arena->resource()); */
+	[[nodiscard]] std::pmr::memory_resource *
+	resource()
+	{
+		return &current();
+	}
+
+	template <typename T, typename... Args>
+	T *
+	make(Args &&...args)
+	{
+		static_assert(std::is_trivially_destructible_v<T>);
+		void *ptr = current().allocate(sizeof(T), alignof(T));
+		return new (ptr) T(std::forward<Args>(args)...);
+	}
+
+	template <typename T>
+	std::span<T>
+	make_array(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>);
+		void *ptr = current().allocate(sizeof(T) * count, alignof(T));
+		return std::span<T>(new (ptr) T[count](), count);
+	}
+
+	[[nodiscard]] uint64_t
+	frame() const
+	{
+		return _frame;
+	}
+
+private:
+	std::array<Arena, 2> _arenas;
+	uint64_t _frame = 0;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_ARENA_H */
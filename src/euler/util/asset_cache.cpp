@@ -0,0 +1,229 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/asset_cache.h"
+
+#include <algorithm>
+
+euler::util::AssetCache::AssetCache(const Reference<Storage> &storage,
+    const size_t budget)
+    : _storage(storage)
+    , _budget(budget)
+{
+}
+
+std::string
+euler::util::AssetCache::normalize(const std::string_view path)
+{
+	std::vector<std::string_view> parts;
+	size_t start = 0;
+	while (start <= path.size()) {
+		auto end = path.find_first_of("/\\", start);
+		if (end == std::string_view::npos) end = path.size();
+		const auto part = path.substr(start, end - start);
+		start = end + 1;
+		if (part.empty() || part == ".") continue;
+		if (part == "..") {
+			if (!parts.empty()) parts.pop_back();
+			continue;
+		}
+		parts.push_back(part);
+	}
+	std::string out;
+	for (const auto &part : parts) {
+		if (!out.empty()) out += '/';
+		out += part;
+	}
+	return out;
+}
+
+uint64_t
+euler::util::AssetCache::hash(const Storage::DataView data)
+{
+	/* FNV-1a */
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (const auto byte : data) {
+		h ^= byte;
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+euler::util::Reference<euler::util::Asset>
+euler::util::AssetCache::find(const std::string_view path,
+    const std::type_index type)
+{
+	std::lock_guard lock(_mutex);
+	const auto it = _paths.find(PathKey(normalize(path), type));
+	if (it == _paths.end()) return nullptr;
+	auto &entry = _entries.at(it->second);
+	touch(entry, it->second);
+	return entry.asset;
+}
+
+euler::util::Reference<euler::util::Asset>
+euler::util::AssetCache::load(const std::string_view path,
+    const std::type_index type, const Decoder &decode)
+{
+	auto key = normalize(path);
+	if (auto asset = find(key, type); asset != nullptr) return asset;
+
+	/* Read and decode outside the lock; a concurrent load of the same
+	 * content simply loses the race below and adopts the winner. */
+	const auto mapping = _storage->map_file(key);
+	const auto id = Key { hash(mapping->data()), type };
+	{
+		std::lock_guard lock(_mutex);
+		if (const auto it = _entries.find(id); it != _entries.end()) {
+			auto &entry = it->second;
+			if (std::ranges::find(entry.paths, key)
+			    == entry.paths.end()) {
+				entry.paths.push_back(key);
+			}
+			_paths.insert_or_assign(PathKey(std::move(key), type),
+			    id);
+			touch(entry, id);
+			return entry.asset;
+		}
+	}
+	auto asset = decode(mapping->data());
+	if (asset == nullptr) {
+		throw std::runtime_error(
+		    "Asset decoder returned nothing for " + key);
+	}
+
+	std::lock_guard lock(_mutex);
+	auto [it, inserted] = _entries.try_emplace(id);
+	auto &entry = it->second;
+	if (inserted) {
+		entry.asset = asset;
+		entry.bytes = asset->size_bytes();
+		_lru.push_front(id);
+		entry.lru = _lru.begin();
+		_owners.emplace(asset.get(), id);
+		_resident += entry.bytes;
+	}
+	if (std::ranges::find(entry.paths, key) == entry.paths.end())
+		entry.paths.push_back(key);
+	_paths.insert_or_assign(PathKey(std::move(key), type), id);
+	touch(entry, id);
+	auto result = entry.asset;
+	if (_resident > _budget) trim_locked();
+	return result;
+}
+
+void
+euler::util::AssetCache::add_dependency(const Reference<Asset> &parent,
+    const Reference<Asset> &child)
+{
+	std::lock_guard lock(_mutex);
+	const auto p = _owners.find(parent.get());
+	const auto c = _owners.find(child.get());
+	if (p == _owners.end() || c == _owners.end()) {
+		throw std::runtime_error(
+		    "Asset dependencies must both be resident in the cache");
+	}
+	if (p->second == c->second) return;
+	auto &deps = _entries.at(p->second).dependencies;
+	if (std::ranges::find(deps, c->second) != deps.end()) return;
+	deps.push_back(c->second);
+	++_entries.at(c->second).pins;
+}
+
+void
+euler::util::AssetCache::invalidate(const std::string_view path)
+{
+	std::lock_guard lock(_mutex);
+	const auto key = normalize(path);
+	std::erase_if(_paths, [&](const auto &item) {
+		if (item.first.first != key) return false;
+		auto &entry = _entries.at(item.second);
+		std::erase(entry.paths, key);
+		return true;
+	});
+}
+
+size_t
+euler::util::AssetCache::trim()
+{
+	std::lock_guard lock(_mutex);
+	return trim_locked();
+}
+
+void
+euler::util::AssetCache::set_budget(const size_t budget)
+{
+	std::lock_guard lock(_mutex);
+	_budget = budget;
+	if (_resident > _budget) trim_locked();
+}
+
+size_t
+euler::util::AssetCache::budget() const
+{
+	std::lock_guard lock(_mutex);
+	return _budget;
+}
+
+size_t
+euler::util::AssetCache::resident_bytes() const
+{
+	std::lock_guard lock(_mutex);
+	return _resident;
+}
+
+size_t
+euler::util::AssetCache::size() const
+{
+	std::lock_guard lock(_mutex);
+	return _entries.size();
+}
+
+void
+euler::util::AssetCache::touch(Entry &entry, const Key &key)
+{
+	_lru.erase(entry.lru);
+	_lru.push_front(key);
+	entry.lru = _lru.begin();
+}
+
+bool
+euler::util::AssetCache::evictable(const Entry &entry) const
+{
+	/* Only our own reference is left, and nothing resident needs it. */
+	return entry.pins == 0 && entry.asset->reference_count() == 1;
+}
+
+void
+euler::util::AssetCache::erase(const Key &key)
+{
+	const auto it = _entries.find(key);
+	auto &entry = it->second;
+	for (const auto &dep : entry.dependencies) --_entries.at(dep).pins;
+	for (const auto &path : entry.paths)
+		_paths.erase(PathKey(path, key.type));
+	_owners.erase(entry.asset.get());
+	_lru.erase(entry.lru);
+	_resident -= entry.bytes;
+	_entries.erase(it);
+}
+
+size_t
+euler::util::AssetCache::trim_locked()
+{
+	const auto before = _resident;
+	/* Evicting a parent unpins its dependencies, which may make entries
+	 * we've already walked past evictable, so sweep until stable. */
+	bool progress = true;
+	while (_resident > _budget && progress) {
+		progress = false;
+		std::vector<Key> candidates;
+		for (auto it = _lru.rbegin(); it != _lru.rend(); ++it)
+			if (evictable(_entries.at(*it))) candidates.push_back(*it);
+		for (const auto &key : candidates) {
+			if (_resident <= _budget) break;
+			erase(key);
+			progress = true;
+		}
+	}
+	return before - _resident;
+}
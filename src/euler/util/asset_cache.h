@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_ASSET_CACHE_H
+#define EULER_UTIL_ASSET_CACHE_H
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include "euler/util/object.h"
+#include "euler/util/storage.h"
+
+namespace euler::util {
+
+/* Anything owned by an AssetCache. size_bytes() is what gets charged against
+ * the cache's memory budget. */
+class Asset : public Object {
+public:
+	~Asset() override = default;
+	[[nodiscard]] virtual size_t size_bytes() const = 0;
+};
+
+/*
+ * Deduplicating cache for decoded assets. Entries are keyed by the content
+ * hash of the source file and the decoded type, so the same bytes reached
+ * through two different paths are only decoded once.
+ *
+ * The cache holds one reference to every resident asset. Once the cache is
+ * over budget, assets that nobody else references and that no resident asset
+ * depends on are evicted, least recently used first.
+ */
+class AssetCache final : public Object {
+public:
+	using Decoder
+	    = std::function<Reference<Asset>(Storage::DataView data)>;
+
+	AssetCache(const Reference<Storage> &storage, size_t budget);
+	~AssetCache() override = default;
+
+	template <typename T>
+	Reference<T>
+	load(const std::string_view path,
+	    const std::function<Reference<T>(Storage::DataView)> &decode)
+	{
+		static_assert(std::is_base_of_v<Asset, T>);
+		auto asset = load(path, typeid(T),
+		    [&](const Storage::DataView data) -> Reference<Asset> {
+			    return decode(data);
+		    });
+		return Reference<T>(static_cast<T *>(asset.get()));
+	}
+
+	/* Returns the resident asset for path, or nullptr. Does not touch the
+	 * backing storage. */
+	template <typename T>
+	Reference<T>
+	find(const std::string_view path)
+	{
+		static_assert(std::is_base_of_v<Asset, T>);
+		auto asset = find(path, typeid(T));
+		return Reference<T>(static_cast<T *>(asset.get()));
+	}
+
+	/* Pins child for as long as parent is resident, e.g. a font and its
+	 * glyph atlas. Both must be resident in this cache. */
+	void add_dependency(const Reference<Asset> &parent,
+	    const Reference<Asset> &child);
+
+	/* Drops the cached entry for path so the next load rereads it.
+	 * Outstanding references remain valid. */
+	void invalidate(std::string_view path);
+
+	/* Evicts until resident size is within budget or nothing else can
+	 * be evicted. Returns the number of bytes freed. */
+	size_t trim();
+
+	void set_budget(size_t budget);
+	[[nodiscard]] size_t budget() const;
+	[[nodiscard]] size_t resident_bytes() const;
+	[[nodiscard]] size_t size() const;
+
+	/* Collapses separators, '.' and '..' components so equivalent paths
+	 * share a key. */
+	static std::string normalize(std::string_view path);
+	static uint64_t hash(Storage::DataView data);
+
+private:
+	struct Key {
+		uint64_t hash;
+		std::type_index type;
+
+		bool
+		operator==(const Key &other) const
+		{
+			return hash == other.hash && type == other.type;
+		}
+	};
+
+	struct KeyHash {
+		size_t
+		operator()(const Key &key) const
+		{
+			return key.hash ^ (key.type.hash_code() << 1);
+		}
+	};
+
+	struct Entry {
+		Reference<Asset> asset;
+		size_t bytes = 0;
+		/* Resident entries that depend on this one. */
+		uint32_t pins = 0;
+		std::vector<Key> dependencies;
+		std::vector<std::string> paths;
+		std::list<Key>::iterator lru;
+	};
+
+	using PathKey = std::pair<std::string, std::type_index>;
+
+	struct PathKeyHash {
+		size_t
+		operator()(const PathKey &key) const
+		{
+			return std::hash<std::string>()(key.first)
+			    ^ (key.second.hash_code() << 1);
+		}
+	};
+
+	Reference<Asset> load(std::string_view path, std::type_index type,
+	    const Decoder &decode);
+	Reference<Asset> find(std::string_view path, std::type_index type);
+	void touch(Entry &entry, const Key &key);
+	bool evictable(const Entry &entry) const;
+	void erase(const Key &key);
+	size_t trim_locked();
+
+	Reference<Storage> _storage;
+	size_t _budget;
+	size_t _resident = 0;
+	std::unordered_map<Key, Entry, KeyHash> _entries;
+	std::unordered_map<PathKey, Key, PathKeyHash> _paths;
+	std::unordered_map<const Asset *, Key> _owners;
+	/* Most recently used at the front. */
+	std::list<Key> _lru;
+	mutable std::mutex _mutex;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_ASSET_CACHE_H */
@@ -6,6 +6,8 @@ extern "C" {
 #include "euler/util/optparse.h"
 }
 
+#include <bit>
+#include <cstdint>
 #include <iostream>
 #include <thread>
 #include <unordered_map>
@@ -24,6 +26,15 @@ static const SeverityMap LOG_LEVELS = {
 	{ "unknnown", Severity::Unknown },
 };
 
+using PresentMode = euler::util::RendererConfig::PresentMode;
+using PresentModeMap = std::unordered_map<std::string_view, PresentMode>;
+static const PresentModeMap PRESENT_MODES = {
+	{ "fifo", PresentMode::Fifo },
+	{ "fifo-relaxed", PresentMode::FifoRelaxed },
+	{ "mailbox", PresentMode::Mailbox },
+	{ "immediate", PresentMode::Immediate },
+};
+
 [[noreturn]] static void
 usage(std::string_view progname, const bool is_error = true)
 {
@@ -32,16 +43,30 @@ usage(std::string_view progname, const bool is_error = true)
 Euler Game Engine {}
 usage: {} [options] <file>
 Options:
+	-F, --frames-in-flight <n>
+				Set the number of frames the CPU may record
+				ahead of the GPU. (default: 2)
 	-I, --include <path>    Add a directory to the load path. '../lib',
 				relative to <file>, is added by default if it
 				exists. Note that the load path must also
 				include assets that are to be loaded by any
 				game scripts.
+	-P, --present-mode <mode>
+				Set the swapchain present mode. (default: fifo)
+				May be one of:
+				 - fifo
+				 - fifo-relaxed
+				 - mailbox
+				 - immediate
 	-V, --version           Print version information and exit
+	-L, --low-latency       Pace frames for the lowest input latency. FIFO
+				presentation becomes mailbox.
 	-c, --config <file>     Load configuration from file
 	-d, --directory <dir>   Set the working directory to <dir>. This should
 				be the root of the game project.
 				(default: present working directory)
+	-f, --frame-limit <fps> Cap the frame rate in low-latency mode.
+				(default: display refresh rate)
 	-h, --help              Show this help message and exit
 	-l, --log-level <level> Set the log level. (default: info)
 				May be one of:
@@ -52,9 +77,24 @@ Options:
 				 - warn
 				 - error
 				 - critical
+	-m, --msaa <samples>    Set the MSAA sample count: 1, 2, 4, 8 or 16.
+				Clamped to what the GPU supports. (default: 1)
 	-n, --num-threads <n>   Set the number of threads to use (default: {})
 	-q, --quiet             Decrease log level by one
 	-v, --verbose           Increase log level by one
+	--capture <n>[,<n>...]  Write the given frames, counted from zero, as
+				PNG files. Requires --headless.
+	--capture-dir <dir>     Directory for captured frames.
+				(default: captures)
+	--frames <n>            Quit after <n> frames.
+	--headless              Render offscreen without a window. Works with
+				software Vulkan drivers and no display.
+	--object-sites          Record where each object was first referenced
+				and list it in the leak report. Slow; only
+				in builds with EULER_TRACK_OBJECTS.
+	--validation, --no-validation
+				Enable or disable the Vulkan validation layers.
+				(default: on in debug builds)
 Notes:
 	<file> should be the entry point of the game. It is expected to create
 	an object that inherits from `Euler::Game::State` and assign it to
@@ -65,6 +105,67 @@ Notes:
 	exit(is_error ? EXIT_FAILURE : EXIT_SUCCESS);
 }
 
+static uint32_t
+parse_positive(euler::util::Config &config, std::string_view name,
+    std::string_view opt)
+{
+	char *endptr;
+	const auto n = strtoull(opt.data(), &endptr, 10);
+	if (*endptr != '\0' || n == 0 || n > UINT32_MAX) {
+		std::cerr << name << " must be a positive integer, unable to "
+				     "parse '"
+			  << opt << "'" << std::endl;
+		usage(config.progname);
+	}
+	return static_cast<uint32_t>(n);
+}
+
+static void
+parse_msaa(euler::util::Config &config, std::string_view opt)
+{
+	const auto n = parse_positive(config, "MSAA sample count", opt);
+	if (!std::has_single_bit(n) || n > 16) {
+		std::cerr << "MSAA sample count must be 1, 2, 4, 8 or 16, not "
+			  << n << std::endl;
+		usage(config.progname);
+	}
+	config.renderer.msaa = n;
+}
+
+static void
+parse_frame_limit(euler::util::Config &config, std::string_view opt)
+{
+	char *endptr;
+	const auto hz = strtod(opt.data(), &endptr);
+	if (*endptr != '\0' || !(hz >= 0)) {
+		std::cerr << "Frame limit must be a non-negative number, unable "
+			     "to parse '"
+			  << opt << "'" << std::endl;
+		usage(config.progname);
+	}
+	config.renderer.frame_limit = hz;
+}
+
+static void
+parse_captures(euler::util::Config &config, std::string_view opt)
+{
+	while (!opt.empty()) {
+		const auto comma = opt.find(',');
+		const auto item = std::string(opt.substr(0, comma));
+		char *endptr;
+		const auto frame = strtoull(item.c_str(), &endptr, 10);
+		if (item.empty() || *endptr != '\0') {
+			std::cerr << "Capture frames must be a comma-separated "
+				     "list of frame numbers, unable to parse '"
+				  << item << "'" << std::endl;
+			usage(config.progname);
+		}
+		config.capture_frames.push_back(frame);
+		if (comma == std::string_view::npos) break;
+		opt.remove_prefix(comma + 1);
+	}
+}
+
 static void
 parse_config_file(euler::util::Config &, std::string_view)
 {
@@ -104,15 +205,54 @@ parse_thread_count(euler::util::Config &config, std::string_view opt)
 	config.num_threads = n;
 }
 
+std::optional<PresentMode>
+euler::util::RendererConfig::parse_present_mode(const std::string_view name)
+{
+	if (const auto it = PRESENT_MODES.find(name); it != PRESENT_MODES.end())
+		return it->second;
+	return std::nullopt;
+}
+
+std::string_view
+euler::util::RendererConfig::present_mode_name(const PresentMode mode)
+{
+	for (const auto &[name, value] : PRESENT_MODES)
+		if (value == mode) return name;
+	return "unknown";
+}
+
 euler::util::Config
 euler::util::Config::parse_args(int argc, char **argv)
 {
+	/* Long-only options use shortnames outside the printable range. */
+	static constexpr int OPT_VALIDATION = 0x100;
+	static constexpr int OPT_NO_VALIDATION = 0x101;
+	static constexpr int OPT_HEADLESS = 0x102;
+	static constexpr int OPT_CAPTURE = 0x103;
+	static constexpr int OPT_CAPTURE_DIR = 0x104;
+	static constexpr int OPT_FRAMES = 0x105;
+	static constexpr int OPT_OBJECT_SITES = 0x106;
 	static constexpr struct optparse_long LONGOPTS[] = {
+		{
+		    .longname = "frames-in-flight",
+		    .shortname = 'F',
+		    .argtype = OPTPARSE_REQUIRED,
+		},
 		{
 		    .longname = "include",
 		    .shortname = 'I',
 		    .argtype = OPTPARSE_REQUIRED,
 		},
+		{
+		    .longname = "low-latency",
+		    .shortname = 'L',
+		    .argtype = OPTPARSE_NONE,
+		},
+		{
+		    .longname = "present-mode",
+		    .shortname = 'P',
+		    .argtype = OPTPARSE_REQUIRED,
+		},
 		{
 		    .longname = "version",
 		    .shortname = 'V',
@@ -128,6 +268,11 @@ euler::util::Config::parse_args(int argc, char **argv)
 		    .shortname = 'd',
 		    .argtype = OPTPARSE_REQUIRED,
 		},
+		{
+		    .longname = "frame-limit",
+		    .shortname = 'f',
+		    .argtype = OPTPARSE_REQUIRED,
+		},
 		{
 		    .longname = "help",
 		    .shortname = 'h',
@@ -138,6 +283,11 @@ euler::util::Config::parse_args(int argc, char **argv)
 		    .shortname = 'l',
 		    .argtype = OPTPARSE_REQUIRED,
 		},
+		{
+		    .longname = "msaa",
+		    .shortname = 'm',
+		    .argtype = OPTPARSE_REQUIRED,
+		},
 		{
 		    .longname = "num-threads",
 		    .shortname = 'n',
@@ -153,6 +303,41 @@ euler::util::Config::parse_args(int argc, char **argv)
 		    .shortname = 'v',
 		    .argtype = OPTPARSE_NONE,
 		},
+		{
+		    .longname = "validation",
+		    .shortname = OPT_VALIDATION,
+		    .argtype = OPTPARSE_NONE,
+		},
+		{
+		    .longname = "no-validation",
+		    .shortname = OPT_NO_VALIDATION,
+		    .argtype = OPTPARSE_NONE,
+		},
+		{
+		    .longname = "headless",
+		    .shortname = OPT_HEADLESS,
+		    .argtype = OPTPARSE_NONE,
+		},
+		{
+		    .longname = "capture",
+		    .shortname = OPT_CAPTURE,
+		    .argtype = OPTPARSE_REQUIRED,
+		},
+		{
+		    .longname = "capture-dir",
+		    .shortname = OPT_CAPTURE_DIR,
+		    .argtype = OPTPARSE_REQUIRED,
+		},
+		{
+		    .longname = "frames",
+		    .shortname = OPT_FRAMES,
+		    .argtype = OPTPARSE_REQUIRED,
+		},
+		{
+		    .longname = "object-sites",
+		    .shortname = OPT_OBJECT_SITES,
+		    .argtype = OPTPARSE_NONE,
+		},
 		{ /* sentinel */ },
 	};
 
@@ -164,15 +349,39 @@ euler::util::Config::parse_args(int argc, char **argv)
 		.log_level = Severity::Info,
 		.load_path = {},
 		.num_threads = DEFAULT_THREAD_COUNT,
+		.renderer = {},
+		.headless = false,
+		.capture_frames = {},
+		.capture_directory = "captures",
+		.max_frames = 0,
+		.object_sites = false,
 	};
 	struct optparse options;
 	optparse_init(&options, argv);
 	int opt;
 	while ((opt = optparse_long(&options, LONGOPTS, nullptr)) != -1) {
 		switch (opt) {
+		case 'F':
+			out.renderer.frames_in_flight
+			    = parse_positive(out, "Frames in flight", options.optarg);
+			break;
 		case 'I': out.load_path.emplace_back(options.optarg); break;
+		case 'L': out.renderer.low_latency = true; break;
+		case 'P': {
+			const auto mode
+			    = RendererConfig::parse_present_mode(options.optarg);
+			if (!mode.has_value()) {
+				std::cerr
+				    << "Unknown present mode: " << options.optarg
+				    << std::endl;
+				usage(out.progname);
+			}
+			out.renderer.present_mode = *mode;
+			break;
+		}
 		case 'V': std::cout << util::version() << std::endl; exit(0);
 		case 'c': parse_config_file(out, options.optarg); break;
+		case 'f': parse_frame_limit(out, options.optarg); break;
 		case 'h': usage(out.progname, false); break;
 		case 'l': {
 			if (!LOG_LEVELS.contains(options.optarg)) {
@@ -184,6 +393,7 @@ euler::util::Config::parse_args(int argc, char **argv)
 			out.log_level = LOG_LEVELS.at(options.optarg);
 			break;
 		}
+		case 'm': parse_msaa(out, options.optarg); break;
 		case 'n': parse_thread_count(out, options.optarg); break;
 		case 'q': {
 			out.log_level = static_cast<Severity>(
@@ -195,6 +405,18 @@ euler::util::Config::parse_args(int argc, char **argv)
 			    static_cast<int>(out.log_level) - 1);
 			break;
 		}
+		case OPT_VALIDATION: out.renderer.validation = true; break;
+		case OPT_NO_VALIDATION: out.renderer.validation = false; break;
+		case OPT_HEADLESS: out.headless = true; break;
+		case OPT_CAPTURE: parse_captures(out, options.optarg); break;
+		case OPT_CAPTURE_DIR:
+			out.capture_directory = options.optarg;
+			break;
+		case OPT_FRAMES:
+			out.max_frames
+			    = parse_positive(out, "Frame count", options.optarg);
+			break;
+		case OPT_OBJECT_SITES: out.object_sites = true; break;
 		default: usage(out.progname);
 		}
 	}
@@ -209,6 +431,10 @@ euler::util::Config::parse_args(int argc, char **argv)
 		std::cerr << "An entry file must be specified" << std::endl;
 		usage(out.progname);
 	}
+	if (!out.capture_frames.empty() && !out.headless) {
+		std::cerr << "Frame captures require --headless" << std::endl;
+		usage(out.progname);
+	}
 	out.entry_file = options.argv[options.optind];
 	return out;
 }
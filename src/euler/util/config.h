@@ -4,6 +4,8 @@
 #define EULER_UTIL_CONFIG_H
 
 #include <filesystem>
+#include <optional>
+#include <string_view>
 
 #include "euler/util/logger.h"
 #include "euler/util/version.h"
@@ -11,6 +13,37 @@
 
 namespace euler::util {
 static constexpr nthread_t DEFAULT_THREAD_COUNT = 6;
+
+/* Renderer settings. These are plain values so that util doesn't depend on
+ * Vulkan; the renderer maps them onto whatever the device supports. */
+struct RendererConfig {
+	enum class PresentMode {
+		Fifo,
+		FifoRelaxed,
+		Mailbox,
+		Immediate,
+	};
+	/* Samples per pixel; 1 disables MSAA. */
+	uint32_t msaa = 1;
+	PresentMode present_mode = PresentMode::Fifo;
+#ifdef NDEBUG
+	bool validation = false;
+#else
+	bool validation = true;
+#endif
+	uint32_t frames_in_flight = 2;
+	/* Paces frames to sample input as late as possible, and upgrades
+	 * FIFO presentation to mailbox. */
+	bool low_latency = false;
+	/* Frame rate cap in Hz for low-latency mode; 0 means the display's
+	 * refresh rate. */
+	double frame_limit = 0;
+
+	static std::optional<PresentMode> parse_present_mode(
+	    std::string_view name);
+	static std::string_view present_mode_name(PresentMode mode);
+};
+
 struct Config {
 	/* argv[0] */
 	std::string progname;
@@ -20,6 +53,18 @@ struct Config {
 	Logger::Severity log_level = Logger::Severity::Info;
 	std::vector<std::filesystem::path> load_path;
 	nthread_t num_threads = DEFAULT_THREAD_COUNT;
+	RendererConfig renderer = {};
+	/* Renders offscreen with SDL's offscreen video driver, for
+	 * benchmarks and golden-image tests without a display. */
+	bool headless = false;
+	/* Frames to write as PNG files in headless mode. */
+	std::vector<uint64_t> capture_frames;
+	std::filesystem::path capture_directory = "captures";
+	/* Quit after this many frames; 0 runs until the game quits. */
+	uint64_t max_frames = 0;
+	/* Records where each object was first referenced, for the leak report
+	 * of builds with EULER_TRACK_OBJECTS. */
+	bool object_sites = false;
 	static Config parse_args(int argc, char **argv);
 };
 } /* namespace euler::util */
@@ -6,6 +6,7 @@
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <typeinfo>
 
 #include "mruby.h"
 #include "mruby/data.h"
@@ -26,6 +27,61 @@ unsafe_cast(const From &from)
 	return dst;
 }
 
+/*
+ * Reference counting policies. Objects are counted atomically by default. A
+ * class whose instances never leave the thread that created them (GUI rows,
+ * per-frame wrappers) can opt into plain counting with
+ *
+ *	using RefCount = util::LocalRefCount;
+ *
+ * which keeps the same layout but compiles down to ordinary loads and stores.
+ */
+struct AtomicRefCount {
+	static void
+	increment(std::atomic<uint32_t> &count)
+	{
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/* Returns true when the last reference has been released. */
+	static bool
+	decrement(std::atomic<uint32_t> &count)
+	{
+		if (count.fetch_sub(1, std::memory_order_release) > 1)
+			return false;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return true;
+	}
+};
+
+struct LocalRefCount {
+	static void
+	increment(std::atomic<uint32_t> &count)
+	{
+		count.store(count.load(std::memory_order_relaxed) + 1,
+		    std::memory_order_relaxed);
+	}
+
+	static bool
+	decrement(std::atomic<uint32_t> &count)
+	{
+		const auto n = count.load(std::memory_order_relaxed) - 1;
+		count.store(n, std::memory_order_relaxed);
+		return n == 0;
+	}
+};
+
+#ifdef EULER_TRACK_OBJECTS
+namespace detail {
+/* Called when an object receives its first reference and when it is
+ * destroyed; see object_registry.h. size is 0 when it isn't known, i.e. the
+ * object was first referenced as a base class. */
+void track_object(const Object *object, const std::type_info &type,
+    size_t size);
+void untrack_object(const Object *object);
+} /* namespace detail */
+#endif
+
 /* Can't use shared_ptr since we need to fit this in a void *, otherwise things
  * get messy */
 
@@ -90,8 +146,14 @@ class Object {
 	friend class Logger;
 
 public:
+	using RefCount = AtomicRefCount;
+
 	Object() = default;
+#ifdef EULER_TRACK_OBJECTS
+	virtual ~Object();
+#else
 	virtual ~Object() = default;
+#endif
 
 	[[nodiscard]] uint32_t
 	reference_count() const
@@ -123,21 +185,29 @@ template <typename T> class Reference {
 	template <typename U> friend class Reference;
 
 private:
+	using RefCount = typename T::RefCount;
+
 	static void
 	decrement(T *obj)
 	{
 		if (obj == nullptr) return;
-		if (obj->_count.fetch_sub(1, std::memory_order_release) > 1)
-			return;
-		std::atomic_thread_fence(std::memory_order_acquire);
-		delete obj;
+		if (RefCount::decrement(obj->_count)) delete obj;
 	}
 
 	static void
 	increment(T *obj)
 	{
 		if (obj == nullptr) return;
-		obj->_count.fetch_add(1, std::memory_order_relaxed);
+#ifdef EULER_TRACK_OBJECTS
+		if (obj->_count.load(std::memory_order_relaxed) == 0) {
+			/* sizeof(T) only describes the object if T is its
+			 * dynamic type. */
+			const auto &type = typeid(*obj);
+			detail::track_object(obj, type,
+			    type == typeid(T) ? sizeof(T) : 0);
+		}
+#endif
+		RefCount::increment(obj->_count);
 	}
 
 public:
@@ -173,12 +243,29 @@ public:
 		increment(_object);
 	}
 
+	Reference(Reference &&other) noexcept
+	    : _object(other._object)
+	{
+		other._object = nullptr;
+	}
+
 	Reference &
 	operator=(const Reference &other)
 	{
-		if (_object != nullptr) decrement(_object);
+		/* Increment first so self-assignment can't free the object. */
+		increment(other._object);
+		decrement(_object);
+		_object = other._object;
+		return *this;
+	}
+
+	Reference &
+	operator=(Reference &&other) noexcept
+	{
+		if (this == &other) return *this;
+		decrement(_object);
 		_object = other._object;
-		increment(_object);
+		other._object = nullptr;
 		return *this;
 	}
 
@@ -0,0 +1,215 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/object_registry.h"
+
+#include <algorithm>
+
+#include "euler/util/logger.h"
+
+#ifdef EULER_TRACK_OBJECTS
+#include <array>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <unordered_map>
+
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define EULER_HAVE_BACKTRACE 1
+#endif
+
+namespace {
+struct Record {
+	const std::type_info *type;
+	size_t size;
+	int depth = 0;
+	std::array<void *, 24> frames;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::atomic<bool> capture_sites = false;
+	std::unordered_map<const euler::util::Object *, Record> objects;
+	std::unordered_map<std::type_index,
+	    euler::util::ObjectRegistry::TypeStats>
+	    types;
+};
+
+Registry &
+registry()
+{
+	/* Leaked on purpose: objects may still be released during static
+	 * destruction. */
+	static auto registry = new Registry;
+	return *registry;
+}
+
+std::string
+demangle(const std::type_info &type)
+{
+#if __has_include(<cxxabi.h>)
+	int status = 0;
+	const std::unique_ptr<char, decltype(&std::free)> name(
+	    abi::__cxa_demangle(type.name(), nullptr, nullptr, &status),
+	    &std::free);
+	if (status == 0 && name != nullptr) return name.get();
+#endif
+	return type.name();
+}
+
+std::vector<std::string>
+symbolize(const Record &record)
+{
+	std::vector<std::string> site;
+#ifdef EULER_HAVE_BACKTRACE
+	if (record.depth == 0) return site;
+	const std::unique_ptr<char *, decltype(&std::free)> symbols(
+	    backtrace_symbols(record.frames.data(), record.depth), &std::free);
+	if (symbols == nullptr) return site;
+	/* Skip track_object and Reference::increment. */
+	for (int i = 2; i < record.depth; ++i)
+		site.emplace_back(symbols.get()[i]);
+#endif
+	return site;
+}
+} /* namespace */
+
+void
+euler::util::detail::track_object(const Object *object,
+    const std::type_info &type, const size_t size)
+{
+	auto &reg = registry();
+	Record record { &type, size, 0, {} };
+#ifdef EULER_HAVE_BACKTRACE
+	if (reg.capture_sites.load(std::memory_order_relaxed)) {
+		record.depth = backtrace(record.frames.data(),
+		    static_cast<int>(record.frames.size()));
+	}
+#endif
+	std::lock_guard lock(reg.mutex);
+	/* An object whose count drops to zero without being deleted and is
+	 * then re-adopted is still the same instance. */
+	const auto [it, inserted] = reg.objects.try_emplace(object, record);
+	if (!inserted) return;
+	auto &stats = reg.types[type];
+	if (stats.type.empty()) stats.type = demangle(type);
+	if (size != 0) stats.size = size;
+	it->second.size = stats.size;
+	++stats.live;
+	++stats.total;
+	stats.bytes += stats.size;
+	stats.peak_live = std::max(stats.peak_live, stats.live);
+	stats.peak_bytes = std::max(stats.peak_bytes, stats.bytes);
+}
+
+void
+euler::util::detail::untrack_object(const Object *object)
+{
+	auto &reg = registry();
+	std::lock_guard lock(reg.mutex);
+	const auto it = reg.objects.find(object);
+	/* Never referenced, e.g. constructed on the stack. */
+	if (it == reg.objects.end()) return;
+	auto &stats = reg.types.at(*it->second.type);
+	--stats.live;
+	stats.bytes -= it->second.size;
+	reg.objects.erase(it);
+}
+
+euler::util::Object::~Object() { detail::untrack_object(this); }
+
+void
+euler::util::ObjectRegistry::set_capture_sites(const bool capture)
+{
+	registry().capture_sites.store(capture, std::memory_order_relaxed);
+}
+
+std::vector<euler::util::ObjectRegistry::TypeStats>
+euler::util::ObjectRegistry::stats()
+{
+	auto &reg = registry();
+	std::vector<TypeStats> out;
+	{
+		std::lock_guard lock(reg.mutex);
+		out.reserve(reg.types.size());
+		for (const auto &[_, stats] : reg.types) out.push_back(stats);
+	}
+	std::ranges::sort(out, [](const auto &a, const auto &b) {
+		return a.bytes > b.bytes;
+	});
+	return out;
+}
+
+std::vector<euler::util::ObjectRegistry::LiveObject>
+euler::util::ObjectRegistry::live_objects()
+{
+	auto &reg = registry();
+	std::lock_guard lock(reg.mutex);
+	std::vector<LiveObject> out;
+	out.reserve(reg.objects.size());
+	for (const auto &[object, record] : reg.objects) {
+		out.push_back(LiveObject {
+		    object,
+		    reg.types.at(*record.type).type,
+		    object->reference_count(),
+		    symbolize(record),
+		});
+	}
+	return out;
+}
+
+size_t
+euler::util::ObjectRegistry::live_count()
+{
+	auto &reg = registry();
+	std::lock_guard lock(reg.mutex);
+	return reg.objects.size();
+}
+#else
+void
+euler::util::ObjectRegistry::set_capture_sites(bool)
+{
+}
+
+std::vector<euler::util::ObjectRegistry::TypeStats>
+euler::util::ObjectRegistry::stats()
+{
+	return {};
+}
+
+std::vector<euler::util::ObjectRegistry::LiveObject>
+euler::util::ObjectRegistry::live_objects()
+{
+	return {};
+}
+
+size_t
+euler::util::ObjectRegistry::live_count()
+{
+	return 0;
+}
+#endif
+
+void
+euler::util::ObjectRegistry::report(const Reference<Logger> &log,
+    const std::vector<const Object *> &roots)
+{
+	if constexpr (!enabled()) return;
+	for (const auto &stats : ObjectRegistry::stats()) {
+		if (stats.live == 0) continue;
+		log->info("{}: {} live ({} bytes), peak {} ({} bytes), {} total",
+		    stats.type, stats.live, stats.bytes, stats.peak_live,
+		    stats.peak_bytes, stats.total);
+	}
+	for (const auto &live : live_objects()) {
+		if (std::ranges::find(roots, live.object) != roots.end())
+			continue;
+		log->warn("Outstanding {} at {} with {} references", live.type,
+		    static_cast<const void *>(live.object), live.references);
+		for (const auto &frame : live.site) log->warn("    {}", frame);
+	}
+}
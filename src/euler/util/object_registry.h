@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_OBJECT_REGISTRY_H
+#define EULER_UTIL_OBJECT_REGISTRY_H
+
+#include <string>
+#include <vector>
+
+#include "euler/util/object.h"
+
+namespace euler::util {
+
+/*
+ * Live object accounting, compiled in with -DEULER_TRACK_OBJECTS=ON.
+ *
+ * An object is tracked from the moment it receives its first Reference until
+ * it is destroyed. Sizes are those of the object's dynamic type, which is
+ * known whenever the first Reference is to the exact type, as with
+ * make_reference. An object first referenced through a base class is counted
+ * at the size seen for its type before, or not at all. In regular builds every
+ * query returns nothing and nothing is recorded.
+ */
+class ObjectRegistry {
+public:
+	struct TypeStats {
+		std::string type;
+		size_t live = 0;
+		size_t bytes = 0;
+		size_t peak_live = 0;
+		size_t peak_bytes = 0;
+		/* Instances ever tracked. */
+		size_t total = 0;
+		/* sizeof the type, once an instance was referenced as it. */
+		size_t size = 0;
+	};
+
+	struct LiveObject {
+		const Object *object;
+		std::string type;
+		uint32_t references;
+		/* Symbolized call stack of the first reference, if capture was
+		 * enabled at the time. */
+		std::vector<std::string> site;
+	};
+
+	static constexpr bool
+	enabled()
+	{
+#ifdef EULER_TRACK_OBJECTS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/* Recording a call stack per object is expensive; off by default and
+	 * enabled with --object-sites. */
+	static void set_capture_sites(bool capture);
+
+	/* Sorted by live bytes, largest first. */
+	static std::vector<TypeStats> stats();
+	static std::vector<LiveObject> live_objects();
+	static size_t live_count();
+
+	/* Logs per-type totals and every outstanding object, excluding the
+	 * given roots, e.g. the logger doing the reporting. */
+	static void report(const Reference<Logger> &log,
+	    const std::vector<const Object *> &roots = {});
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_OBJECT_REGISTRY_H */
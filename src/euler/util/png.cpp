@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/png.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+static constexpr auto CRC_TABLE = [] {
+	std::array<uint32_t, 256> table {};
+	for (uint32_t i = 0; i < 256; ++i) {
+		auto c = i;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		table[i] = c;
+	}
+	return table;
+}();
+
+static uint32_t
+crc32(const uint32_t crc, const std::string_view data)
+{
+	auto c = ~crc;
+	for (const auto byte : data)
+		c = CRC_TABLE[(c ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (c >> 8);
+	return ~c;
+}
+
+static void
+put_u32(std::string &out, const uint32_t value)
+{
+	out.push_back(static_cast<char>(value >> 24));
+	out.push_back(static_cast<char>(value >> 16));
+	out.push_back(static_cast<char>(value >> 8));
+	out.push_back(static_cast<char>(value));
+}
+
+static void
+put_chunk(std::string &out, const std::string_view type,
+    const std::string_view data)
+{
+	put_u32(out, static_cast<uint32_t>(data.size()));
+	const auto start = out.size();
+	out.append(type);
+	out.append(data);
+	put_u32(out,
+	    crc32(0, std::string_view(out).substr(start, out.size() - start)));
+}
+
+/* A zlib stream made of stored deflate blocks. */
+static std::string
+zlib_store(const std::string_view data)
+{
+	static constexpr size_t MAX_BLOCK = 0xFFFF;
+	std::string out;
+	out.reserve(data.size() + data.size() / MAX_BLOCK * 5 + 16);
+	/* CMF/FLG: deflate, 32K window, no dictionary, fastest. */
+	out.push_back(0x78);
+	out.push_back(0x01);
+	uint32_t a = 1, b = 0;
+	size_t offset = 0;
+	do {
+		const auto size = std::min(MAX_BLOCK, data.size() - offset);
+		const auto last = offset + size == data.size();
+		out.push_back(last ? 1 : 0);
+		out.push_back(static_cast<char>(size & 0xFF));
+		out.push_back(static_cast<char>(size >> 8));
+		out.push_back(static_cast<char>(~size & 0xFF));
+		out.push_back(static_cast<char>((~size >> 8) & 0xFF));
+		const auto block = data.substr(offset, size);
+		out.append(block);
+		for (const auto byte : block) {
+			a = (a + static_cast<uint8_t>(byte)) % 65521;
+			b = (b + a) % 65521;
+		}
+		offset += size;
+	} while (offset < data.size());
+	put_u32(out, (b << 16) | a);
+	return out;
+}
+
+std::string
+euler::util::encode_png(const uint32_t width, const uint32_t height,
+    const std::span<const uint8_t> rgba)
+{
+	const auto stride = static_cast<size_t>(width) * 4;
+	if (width == 0 || height == 0)
+		throw std::runtime_error("PNG images must not be empty");
+	if (rgba.size() < stride * height)
+		throw std::runtime_error("Too few pixels for PNG image");
+	/* Each scanline is prefixed with filter type 0 (none). */
+	std::string raw;
+	raw.reserve((stride + 1) * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		raw.push_back(0);
+		const auto row = rgba.subspan(y * stride, stride);
+		raw.append(reinterpret_cast<const char *>(row.data()), stride);
+	}
+	std::string header;
+	put_u32(header, width);
+	put_u32(header, height);
+	/* 8 bits per channel, RGBA, deflate, adaptive filtering, no
+	 * interlace. */
+	header.append({ 8, 6, 0, 0, 0 });
+
+	std::string out = "\x89PNG\r\n\x1a\n";
+	put_chunk(out, "IHDR", header);
+	put_chunk(out, "IDAT", zlib_store(raw));
+	put_chunk(out, "IEND", {});
+	return out;
+}
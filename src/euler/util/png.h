@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_PNG_H
+#define EULER_UTIL_PNG_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace euler::util {
+
+/* Encodes tightly packed RGBA8 pixels as a PNG file. The image data is
+ * stored rather than compressed: this is for frame captures and golden-image
+ * comparisons, where exact pixels and a dependency-free encoder matter more
+ * than file size. */
+std::string encode_png(uint32_t width, uint32_t height,
+    std::span<const uint8_t> rgba);
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_PNG_H */
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_POOL_H
+#define EULER_UTIL_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace euler::util {
+
+/*
+ * Fixed-size block allocator. Each thread allocates from and frees to its own
+ * cache without synchronization; caches trade batches of blocks with a
+ * shared, lock-free free list when they run dry or grow too large.
+ *
+ * The shared list only ever has batches pushed onto it or is emptied
+ * wholesale, never popped one node at a time, so it's immune to ABA. Slabs
+ * are never returned to the system; a pool's footprint is its high-water
+ * mark.
+ */
+template <size_t Size, size_t Align> class FixedPool {
+	struct Node {
+		Node *next;
+	};
+
+public:
+	static constexpr size_t ALIGN = std::max(Align, alignof(Node));
+	static constexpr size_t BLOCK_SIZE
+	    = (std::max(Size, sizeof(Node)) + ALIGN - 1) / ALIGN * ALIGN;
+	static constexpr size_t BATCH = 64;
+
+	static void *
+	allocate()
+	{
+		auto &cache = local();
+		if (cache.head == nullptr) refill(cache);
+		const auto node = cache.head;
+		cache.head = node->next;
+		--cache.count;
+		return node;
+	}
+
+	static void
+	deallocate(void *ptr)
+	{
+		auto &cache = local();
+		const auto node = static_cast<Node *>(ptr);
+		node->next = cache.head;
+		cache.head = node;
+		if (++cache.count >= 2 * BATCH) release(cache, BATCH);
+	}
+
+private:
+	struct Cache {
+		Node *head = nullptr;
+		size_t count = 0;
+
+		~Cache()
+		{
+			/* Hand everything back when the thread exits. */
+			if (count > 0) release(*this, count);
+		}
+	};
+
+	static Cache &
+	local()
+	{
+		static thread_local Cache cache;
+		return cache;
+	}
+
+	static std::atomic<Node *> &
+	shared()
+	{
+		static std::atomic<Node *> head = nullptr;
+		return head;
+	}
+
+	static void
+	release(Cache &cache, const size_t n)
+	{
+		const auto first = cache.head;
+		auto last = first;
+		for (size_t i = 1; i < n; ++i) last = last->next;
+		cache.head = last->next;
+		cache.count -= n;
+		auto &head = shared();
+		auto expected = head.load(std::memory_order_relaxed);
+		do {
+			last->next = expected;
+		} while (!head.compare_exchange_weak(expected, first,
+		    std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	static void
+	refill(Cache &cache)
+	{
+		if (auto list = shared().exchange(nullptr,
+			std::memory_order_acquire);
+		    list != nullptr) {
+			cache.head = list;
+			cache.count = 0;
+			for (auto node = list; node != nullptr; node = node->next)
+				++cache.count;
+			return;
+		}
+		const auto slab = static_cast<std::byte *>(::operator new(
+		    BLOCK_SIZE * BATCH, std::align_val_t(ALIGN)));
+		for (size_t i = 0; i < BATCH; ++i) {
+			const auto node
+			    = reinterpret_cast<Node *>(slab + i * BLOCK_SIZE);
+			node->next = i + 1 < BATCH
+			    ? reinterpret_cast<Node *>(slab + (i + 1) * BLOCK_SIZE)
+			    : nullptr;
+		}
+		cache.head = reinterpret_cast<Node *>(slab);
+		cache.count = BATCH;
+	}
+};
+
+/*
+ * Opt-in pooled allocation for Object subclasses:
+ *
+ *	class Row final : public util::Object, public util::Pooled<Row> { };
+ *
+ * make_reference allocates with a plain new expression, so this routes it
+ * through the class's pool, and Reference's delete through the virtual
+ * destructor hands the block back to the same pool.
+ */
+template <typename T> class Pooled {
+public:
+	static void *
+	operator new(const size_t size)
+	{
+		/* A subclass that didn't opt in itself is a different size. */
+		if (size != sizeof(T)) return ::operator new(size);
+		return FixedPool<sizeof(T), alignof(T)>::allocate();
+	}
+
+	static void
+	operator delete(void *ptr, const size_t size)
+	{
+		if (size != sizeof(T)) return ::operator delete(ptr);
+		FixedPool<sizeof(T), alignof(T)>::deallocate(ptr);
+	}
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_POOL_H */
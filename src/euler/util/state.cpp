@@ -10,6 +10,17 @@ euler::util::State::init_fs(const char *argv0)
 	PHYSFS_init(argv0);
 }
 
+bool
+euler::util::State::mount_user_dir(const char *app)
+{
+	/* Searched after the game's own files, so saves can't shadow
+	 * assets. */
+	const auto dir = PHYSFS_getPrefDir("euler", app);
+	if (dir == nullptr) return false;
+	return PHYSFS_setWriteDir(dir) != 0
+	    && PHYSFS_mount(dir, nullptr, 1) != 0;
+}
+
 void
 euler::util::State::deinit_fs()
 {
@@ -14,12 +14,16 @@
 #include "euler/util/thread.h"
 
 namespace euler::util {
+class FrameArena;
 class Storage;
 
 /* pure virtual class; the actual state is implemented in game::State */
 class State : public Object {
 protected:
 	void init_fs(const char *argv0 = nullptr);
+	/* Makes the per-user data directory for app writable and
+	 * readable. */
+	bool mount_user_dir(const char *app);
 	void deinit_fs();
 
 public:
@@ -29,6 +33,8 @@ public:
 	[[nodiscard]] virtual Reference<Logger> log() const = 0;
 	[[nodiscard]] virtual Reference<Storage> user_storage() const = 0;
 	[[nodiscard]] virtual Reference<Storage> title_storage() const = 0;
+	/* Scratch memory that is recycled two frames after allocation. */
+	[[nodiscard]] virtual Reference<FrameArena> frame_arena() const = 0;
 	[[nodiscard]] virtual std::unique_lock<std::mutex> lock_mrb() const = 0;
 	[[nodiscard]] virtual std::optional<std::unique_lock<std::mutex>>
 	try_lock_mrb() const = 0;
@@ -2,13 +2,711 @@
 
 #include "euler/util/storage.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#define EULER_STORAGE_POSIX 1
+#endif
+
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
 #include <physfs.h>
 #include <physfssdl3.h>
 #include <SDL3/SDL_storage.h>
 
-euler::util::Storage::Storage() { _storage = PHYSFSSDL3_makeStorage(); }
+using Priority = euler::util::Storage::Priority;
+using Status = euler::util::Storage::Request::Status;
+
+/* State shared between every Request coalesced onto the same read. */
+struct euler::util::Storage::ReadJob {
+	std::string path;
+	std::atomic<Priority> priority;
+	std::atomic<Status> status = Status::Pending;
+	/* Number of live, uncancelled Requests waiting on this job. */
+	std::atomic<uint32_t> interest = 0;
+	std::string data;
+	std::string error;
+	mutable std::mutex mutex;
+	mutable std::condition_variable done;
+
+	ReadJob(const std::string_view path, const Priority priority)
+	    : path(path)
+	    , priority(priority)
+	{
+	}
+
+	bool
+	finished() const
+	{
+		const auto s = status.load(std::memory_order_acquire);
+		return s != Status::Pending && s != Status::Loading;
+	}
+
+	void
+	finish(const Status result)
+	{
+		{
+			std::lock_guard lock(mutex);
+			status.store(result, std::memory_order_release);
+		}
+		done.notify_all();
+	}
+};
+
+struct euler::util::Storage::Loader {
+	using Job = std::shared_ptr<ReadJob>;
+
+	Loader(SDL_Storage *storage, nthread_t count);
+	~Loader();
+
+	Job submit(std::string_view path, Priority priority);
+	void release(const Job &job);
+	size_t pending() const;
+
+private:
+	void run();
+	Job next(std::unique_lock<std::mutex> &lock);
+	void forget(const Job &job);
+
+	SDL_Storage *_storage;
+	mutable std::mutex _mutex;
+	std::condition_variable _wake;
+	std::array<std::deque<Job>, PRIORITY_COUNT> _queues;
+	std::unordered_map<std::string, Job> _inflight;
+	std::vector<std::thread> _threads;
+	bool _stopping = false;
+};
+
+euler::util::Storage::Loader::Loader(SDL_Storage *storage,
+    const nthread_t count)
+    : _storage(storage)
+{
+	_threads.reserve(count);
+	for (nthread_t i = 0; i < count; ++i)
+		_threads.emplace_back([this] { run(); });
+}
+
+euler::util::Storage::Loader::~Loader()
+{
+	{
+		std::lock_guard lock(_mutex);
+		_stopping = true;
+		for (const auto &[_, job] : _inflight) {
+			auto expected = Status::Pending;
+			if (job->status.compare_exchange_strong(expected,
+				Status::Cancelled)) {
+				job->finish(Status::Cancelled);
+			}
+		}
+	}
+	_wake.notify_all();
+	for (auto &thread : _threads) thread.join();
+}
+
+euler::util::Storage::Loader::Job
+euler::util::Storage::Loader::submit(const std::string_view path,
+    const Priority priority)
+{
+	std::lock_guard lock(_mutex);
+	const auto key = std::string(path);
+	if (const auto it = _inflight.find(key); it != _inflight.end()) {
+		auto job = it->second;
+		job->interest.fetch_add(1, std::memory_order_relaxed);
+		/* Promote rather than duplicate. The stale queue entry is
+		 * skipped once the job has been claimed. */
+		if (priority < job->priority.load(std::memory_order_relaxed)) {
+			job->priority.store(priority, std::memory_order_relaxed);
+			_queues[static_cast<size_t>(priority)].push_back(job);
+			_wake.notify_one();
+		}
+		return job;
+	}
+	auto job = std::make_shared<ReadJob>(path, priority);
+	job->interest.store(1, std::memory_order_relaxed);
+	_inflight.emplace(key, job);
+	_queues[static_cast<size_t>(priority)].push_back(job);
+	_wake.notify_one();
+	return job;
+}
+
+void
+euler::util::Storage::Loader::release(const Job &job)
+{
+	{
+		/* Held across the check so submit() can't resurrect a job
+		 * we're about to cancel. */
+		std::lock_guard lock(_mutex);
+		if (job->interest.fetch_sub(1, std::memory_order_acq_rel) > 1)
+			return;
+		auto expected = Status::Pending;
+		if (!job->status.compare_exchange_strong(expected,
+			Status::Cancelled)) {
+			return;
+		}
+		forget(job);
+	}
+	job->finish(Status::Cancelled);
+}
+
+size_t
+euler::util::Storage::Loader::pending() const
+{
+	std::lock_guard lock(_mutex);
+	return _inflight.size();
+}
+
+void
+euler::util::Storage::Loader::forget(const Job &job)
+{
+	if (const auto it = _inflight.find(job->path);
+	    it != _inflight.end() && it->second == job) {
+		_inflight.erase(it);
+	}
+}
+
+euler::util::Storage::Loader::Job
+euler::util::Storage::Loader::next(std::unique_lock<std::mutex> &lock)
+{
+	for (;;) {
+		for (auto &queue : _queues) {
+			while (!queue.empty()) {
+				auto job = std::move(queue.front());
+				queue.pop_front();
+				auto expected = Status::Pending;
+				if (job->status.compare_exchange_strong(expected,
+					Status::Loading)) {
+					return job;
+				}
+			}
+		}
+		if (_stopping) return nullptr;
+		_wake.wait(lock);
+	}
+}
+
+void
+euler::util::Storage::Loader::run()
+{
+	std::unique_lock lock(_mutex);
+	while (const auto job = next(lock)) {
+		lock.unlock();
+		auto result = Status::Done;
+		try {
+			uint64_t size = 0;
+			const auto path = job->path.c_str();
+			if (!SDL_GetStorageFileSize(_storage, path, &size))
+				throw std::runtime_error(SDL_GetError());
+			job->data.resize(size);
+			if (!SDL_ReadStorageFile(_storage, path,
+				job->data.data(), size)) {
+				throw std::runtime_error(SDL_GetError());
+			}
+		} catch (const std::exception &e) {
+			job->error = e.what();
+			job->data.clear();
+			result = Status::Failed;
+		}
+		lock.lock();
+		forget(job);
+		job->finish(result);
+	}
+}
+
+euler::util::Storage::Request::Request(const Reference<Storage> &storage,
+    const std::shared_ptr<ReadJob> &job)
+    : _storage(storage)
+    , _job(job)
+{
+}
+
+euler::util::Storage::Request::~Request() { cancel(); }
+
+euler::util::Storage::Request::Status
+euler::util::Storage::Request::status() const
+{
+	if (_cancelled.load(std::memory_order_relaxed)) return Status::Cancelled;
+	return _job->status.load(std::memory_order_acquire);
+}
+
+bool
+euler::util::Storage::Request::ready() const
+{
+	return _cancelled.load(std::memory_order_relaxed) || _job->finished();
+}
+
+const std::string &
+euler::util::Storage::Request::path() const
+{
+	return _job->path;
+}
+
+const std::string &
+euler::util::Storage::Request::wait() const
+{
+	if (_cancelled.load(std::memory_order_relaxed))
+		throw std::runtime_error("Read was cancelled: " + _job->path);
+	{
+		std::unique_lock lock(_job->mutex);
+		_job->done.wait(lock, [this] { return _job->finished(); });
+	}
+	switch (_job->status.load(std::memory_order_acquire)) {
+	case Status::Done: return _job->data;
+	case Status::Failed: throw std::runtime_error(_job->error);
+	default: throw std::runtime_error("Read was cancelled: " + _job->path);
+	}
+}
+
+void
+euler::util::Storage::Request::cancel()
+{
+	if (_cancelled.exchange(true, std::memory_order_relaxed)) return;
+	_storage->loader().release(_job);
+}
+
+using PathInfo = euler::util::Storage::PathInfo;
+
+static PathInfo::Type
+from_sdl(const SDL_PathType type)
+{
+	switch (type) {
+	case SDL_PATHTYPE_NONE: return PathInfo::Type::None;
+	case SDL_PATHTYPE_FILE: return PathInfo::Type::File;
+	case SDL_PATHTYPE_DIRECTORY: return PathInfo::Type::Directory;
+	default: return PathInfo::Type::Other;
+	}
+}
+
+/*
+ * Trie mirroring the storage tree. Each directory is listed from storage the
+ * first time it's visited; after that lookups never leave memory until the
+ * node is invalidated.
+ */
+struct euler::util::Storage::Index {
+	struct Node {
+		PathInfo::Type type = PathInfo::Type::Directory;
+		bool listed = false;
+		std::map<std::string, std::unique_ptr<Node>, std::less<>>
+		    children;
+	};
+
+	explicit Index(SDL_Storage *storage)
+	    : storage(storage)
+	{
+	}
+
+	static std::vector<std::string_view> split(std::string_view path);
+	static std::string_view trim(std::string_view dir);
+	static std::string join(std::string_view dir, std::string_view name);
+
+	/* Returns nullptr if the path doesn't exist. */
+	Node *find(std::string_view path);
+	void list(Node &node, const std::string &path);
+	void invalidate(std::string_view path);
+	/* path is the node's storage path, relative is the path reported
+	 * back to the caller. A null pattern matches everything. */
+	void glob(Node &node, const std::string &path,
+	    const std::string &relative, const char *pattern,
+	    bool case_insensitive, std::vector<std::string> &out);
+	void glob(Node &node, const std::string &path,
+	    const std::string &relative, std::string_view pattern,
+	    std::span<const std::string_view> parts, bool case_insensitive,
+	    std::vector<std::string> &out);
+
+	SDL_Storage *storage;
+	Node root;
+	std::mutex mutex;
+};
+
+std::vector<std::string_view>
+euler::util::Storage::Index::split(const std::string_view path)
+{
+	std::vector<std::string_view> parts;
+	size_t start = 0;
+	while (start < path.size()) {
+		auto end = path.find('/', start);
+		if (end == std::string_view::npos) end = path.size();
+		if (end > start) parts.push_back(path.substr(start, end - start));
+		start = end + 1;
+	}
+	return parts;
+}
+
+std::string_view
+euler::util::Storage::Index::trim(std::string_view dir)
+{
+	while (!dir.empty() && dir.back() == '/') dir.remove_suffix(1);
+	return dir;
+}
+
+std::string
+euler::util::Storage::Index::join(std::string_view dir,
+    const std::string_view name)
+{
+	dir = trim(dir);
+	if (dir.empty()) return std::string(name);
+	auto out = std::string(dir);
+	out += '/';
+	out += name;
+	return out;
+}
+
+void
+euler::util::Storage::Index::list(Node &node, const std::string &path)
+{
+	std::vector<std::string> names;
+	const auto collect = [](void *userdata, const char *,
+				 const char *name) {
+		static_cast<std::vector<std::string> *>(userdata)->emplace_back(
+		    name);
+		return SDL_ENUM_CONTINUE;
+	};
+	if (!SDL_EnumerateStorageDirectory(storage, path.c_str(), collect,
+		&names)) {
+		throw std::runtime_error(SDL_GetError());
+	}
+	node.children.clear();
+	for (auto &name : names) {
+		auto child = std::make_unique<Node>();
+		SDL_PathInfo info;
+		if (SDL_GetStoragePathInfo(storage, join(path, name).c_str(),
+			&info)) {
+			child->type = from_sdl(info.type);
+		} else {
+			child->type = PathInfo::Type::Other;
+		}
+		node.children.emplace(std::move(name), std::move(child));
+	}
+	node.listed = true;
+}
+
+euler::util::Storage::Index::Node *
+euler::util::Storage::Index::find(const std::string_view path)
+{
+	auto node = &root;
+	std::string current;
+	for (const auto part : split(path)) {
+		if (node->type != PathInfo::Type::Directory) return nullptr;
+		if (!node->listed) list(*node, current);
+		const auto it = node->children.find(part);
+		if (it == node->children.end()) return nullptr;
+		current = join(current, part);
+		node = it->second.get();
+	}
+	return node;
+}
+
+void
+euler::util::Storage::Index::invalidate(const std::string_view path)
+{
+	/* Forget the listing of the parent; that covers the entry itself
+	 * appearing, disappearing or changing type. */
+	auto parts = split(path);
+	if (!parts.empty()) parts.pop_back();
+	auto node = &root;
+	for (const auto part : parts) {
+		if (!node->listed) return;
+		const auto it = node->children.find(part);
+		if (it == node->children.end()) return;
+		node = it->second.get();
+	}
+	node->children.clear();
+	node->listed = false;
+}
+
+static bool
+glob_match(const std::string_view pattern, const std::string_view str,
+    const bool case_insensitive)
+{
+	/* Same rules as SDL's glob: '*' and '?' never match a '/'. */
+	const auto eq = [&](const char a, const char b) {
+		if (!case_insensitive) return a == b;
+		return std::tolower(static_cast<unsigned char>(a))
+		    == std::tolower(static_cast<unsigned char>(b));
+	};
+	size_t p = 0, s = 0;
+	size_t star = std::string_view::npos, mark = 0;
+	while (s < str.size()) {
+		if (p < pattern.size() && pattern[p] == '*') {
+			star = p++;
+			mark = s;
+		} else if (p < pattern.size()
+		    && ((pattern[p] == '?' && str[s] != '/')
+			|| eq(pattern[p], str[s]))) {
+			++p;
+			++s;
+		} else if (star != std::string_view::npos && str[mark] != '/') {
+			p = star + 1;
+			s = ++mark;
+		} else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*') ++p;
+	return p == pattern.size();
+}
+
+void
+euler::util::Storage::Index::glob(Node &node, const std::string &path,
+    const std::string &relative, const char *pattern,
+    const bool case_insensitive, std::vector<std::string> &out)
+{
+	/* Like SDL, no pattern lists the whole subtree. */
+	if (pattern == nullptr) {
+		glob(node, path, relative, {}, {}, case_insensitive, out);
+		return;
+	}
+	const auto parts = split(pattern);
+	if (parts.empty()) return;
+	glob(node, path, relative, pattern, parts, case_insensitive, out);
+}
+
+void
+euler::util::Storage::Index::glob(Node &node, const std::string &path,
+    const std::string &relative, const std::string_view pattern,
+    const std::span<const std::string_view> parts,
+    const bool case_insensitive, std::vector<std::string> &out)
+{
+	/* Wildcards never match a '/', so each level of the tree only has
+	 * to match one component of the pattern and nothing below the
+	 * pattern's depth can match. */
+	const auto everything = parts.empty();
+	if (!node.listed) list(node, path);
+	for (const auto &[name, child] : node.children) {
+		if (!everything
+		    && !glob_match(parts.front(), name, case_insensitive))
+			continue;
+		const auto child_relative = join(relative, name);
+		if (everything
+		    || (parts.size() == 1
+			&& glob_match(pattern, child_relative,
+			    case_insensitive)))
+			out.push_back(child_relative);
+		if (child->type != PathInfo::Type::Directory) continue;
+		if (!everything && parts.size() == 1) continue;
+		glob(*child, join(path, name), child_relative, pattern,
+		    everything ? parts : parts.subspan(1), case_insensitive,
+		    out);
+	}
+}
+
+#ifdef EULER_STORAGE_POSIX
+static std::runtime_error
+errno_error(const std::string_view what, const std::filesystem::path &path)
+{
+	return std::runtime_error(std::string(what) + " " + path.string() + ": "
+	    + std::strerror(errno));
+}
+
+static void
+write_all(const int fd, const std::string_view content,
+    const std::filesystem::path &path)
+{
+	auto data = content.data();
+	auto remaining = content.size();
+	while (remaining > 0) {
+		const auto n = write(fd, data, remaining);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			throw errno_error("Failed to write", path);
+		}
+		data += n;
+		remaining -= static_cast<size_t>(n);
+	}
+}
+
+/* Writes to a uniquely named sibling temporary file, syncs it and renames
+ * it over the target, so concurrent writes to one path never share a
+ * temporary and the last rename wins. Returns false if there's no real
+ * write directory to work in. */
+static bool
+write_real_file(const char *path, const std::string_view content)
+{
+	const auto write_dir = PHYSFS_getWriteDir();
+	if (write_dir == nullptr) return false;
+	const auto target = std::filesystem::path(write_dir) / path;
+	auto name = target.string() + ".XXXXXX";
+	const auto fd = mkostemp(name.data(), O_CLOEXEC);
+	const std::filesystem::path temp = name;
+	if (fd < 0) throw errno_error("Failed to create", temp);
+	try {
+		/* mkostemp creates the file private to the user. */
+		if (fchmod(fd, 0644) != 0)
+			throw errno_error("Failed to set mode of", temp);
+		write_all(fd, content, temp);
+		if (fsync(fd) != 0) throw errno_error("Failed to sync", temp);
+	} catch (...) {
+		close(fd);
+		unlink(temp.c_str());
+		throw;
+	}
+	if (close(fd) != 0) {
+		unlink(temp.c_str());
+		throw errno_error("Failed to close", temp);
+	}
+	if (rename(temp.c_str(), target.c_str()) != 0) {
+		unlink(temp.c_str());
+		throw errno_error("Failed to replace", target);
+	}
+	/* Persist the rename itself. */
+	const auto parent = target.parent_path();
+	if (const auto dir = open(parent.c_str(), O_RDONLY | O_CLOEXEC);
+	    dir >= 0) {
+		fsync(dir);
+		close(dir);
+	}
+	return true;
+}
+#endif
+
+static void
+write_storage_file(SDL_Storage *storage, const char *path,
+    const std::string_view content)
+{
+#ifdef EULER_STORAGE_POSIX
+	if (write_real_file(path, content)) return;
+#endif
+	if (const auto data = reinterpret_cast<const void *>(content.data());
+	    !SDL_WriteStorageFile(storage, path, data, content.size())) {
+		throw std::runtime_error(SDL_GetError());
+	}
+}
+
+struct euler::util::Storage::Writer {
+	explicit Writer(Storage &storage);
+	~Writer();
+
+	void submit(std::string_view path, std::string content);
+	void flush();
+
+private:
+	void run();
+
+	Storage &_storage;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _idle;
+	/* Newest contents per path, in the order paths were first queued. */
+	std::unordered_map<std::string, std::string> _pending;
+	std::deque<std::string> _order;
+	bool _busy = false;
+	bool _stopping = false;
+	std::string _error;
+	std::thread _thread;
+};
+
+euler::util::Storage::Writer::Writer(Storage &storage)
+    : _storage(storage)
+{
+	_thread = std::thread([this] { run(); });
+}
+
+euler::util::Storage::Writer::~Writer()
+{
+	{
+		std::lock_guard lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	/* Pending writes are drained before the thread exits. */
+	_thread.join();
+}
+
+void
+euler::util::Storage::Writer::submit(const std::string_view path,
+    std::string content)
+{
+	{
+		std::lock_guard lock(_mutex);
+		auto [it, inserted] = _pending.insert_or_assign(
+		    std::string(path), std::move(content));
+		if (inserted) _order.push_back(it->first);
+	}
+	_wake.notify_one();
+}
+
+void
+euler::util::Storage::Writer::flush()
+{
+	std::unique_lock lock(_mutex);
+	_idle.wait(lock, [this] { return _pending.empty() && !_busy; });
+	if (_error.empty()) return;
+	auto error = std::move(_error);
+	_error.clear();
+	throw std::runtime_error(error);
+}
+
+void
+euler::util::Storage::Writer::run()
+{
+	std::unique_lock lock(_mutex);
+	for (;;) {
+		_wake.wait(lock,
+		    [this] { return !_order.empty() || _stopping; });
+		if (_order.empty()) return;
+		auto path = std::move(_order.front());
+		_order.pop_front();
+		auto node = _pending.extract(path);
+		_busy = true;
+		lock.unlock();
+		try {
+			write_storage_file(_storage._storage, path.c_str(),
+			    node.mapped());
+			_storage.invalidate(path);
+		} catch (const std::exception &e) {
+			lock.lock();
+			if (_error.empty()) _error = e.what();
+			lock.unlock();
+		}
+		lock.lock();
+		_busy = false;
+		if (_order.empty()) _idle.notify_all();
+	}
+}
 
-euler::util::Storage::~Storage() { SDL_CloseStorage(_storage); }
+euler::util::Storage::Writer &
+euler::util::Storage::writer()
+{
+	std::call_once(_writer_once,
+	    [this] { _writer = std::make_unique<Writer>(*this); });
+	return *_writer;
+}
+
+euler::util::Storage::Storage()
+{
+	_storage = PHYSFSSDL3_makeStorage();
+	_index = std::make_unique<Index>(_storage);
+}
+
+euler::util::Storage::~Storage()
+{
+	/* Worker threads must be joined before the storage they use goes
+	 * away. */
+	_writer.reset();
+	_loader.reset();
+	SDL_CloseStorage(_storage);
+}
+
+euler::util::Storage::Loader &
+euler::util::Storage::loader() const
+{
+	std::call_once(_loader_once, [this] {
+		_loader = std::make_unique<Loader>(_storage, IO_THREAD_COUNT);
+	});
+	return *_loader;
+}
 
 bool
 euler::util::Storage::ready() const
@@ -36,86 +734,248 @@ euler::util::Storage::read_file(const char *path) const
 	return content;
 }
 
-void
-euler::util::Storage::write_file(const char *path,
-    const std::string_view content)
+static std::runtime_error
+physfs_error(const std::string_view path)
 {
-	if (const auto data = reinterpret_cast<const void *>(content.data());
-	    !SDL_WriteStorageFile(_storage, path, data, content.size())) {
+	const auto code = PHYSFS_getLastErrorCode();
+	return std::runtime_error(
+	    std::string(path) + ": " + PHYSFS_getErrorByCode(code));
+}
+
+size_t
+euler::util::Storage::read_into(const char *path,
+    const std::span<uint8_t> buffer) const
+{
+	const auto size = file_size(path);
+	if (size > buffer.size()) {
+		throw std::runtime_error(std::string(path)
+		    + ": buffer too small for file contents");
+	}
+	if (!SDL_ReadStorageFile(_storage, path, buffer.data(), size))
 		throw std::runtime_error(SDL_GetError());
+	return size;
+}
+
+size_t
+euler::util::Storage::read_range(const char *path, const uint64_t offset,
+    const std::span<uint8_t> buffer) const
+{
+	const auto file = PHYSFS_openRead(path);
+	if (file == nullptr) throw physfs_error(path);
+	if (!PHYSFS_seek(file, offset)) {
+		const auto error = physfs_error(path);
+		PHYSFS_close(file);
+		throw error;
+	}
+	const auto n = PHYSFS_readBytes(file, buffer.data(), buffer.size());
+	if (n < 0) {
+		const auto error = physfs_error(path);
+		PHYSFS_close(file);
+		throw error;
 	}
+	PHYSFS_close(file);
+	return static_cast<size_t>(n);
+}
+
+euler::util::Storage::Reader::Reader(PHYSFS_File *file,
+    const std::string_view path)
+    : _file(file)
+    , _path(path)
+{
+	const auto length = PHYSFS_fileLength(file);
+	_size = length < 0 ? 0 : static_cast<uint64_t>(length);
+}
+
+euler::util::Storage::Reader::~Reader() { PHYSFS_close(_file); }
+
+size_t
+euler::util::Storage::Reader::read(const std::span<uint8_t> buffer)
+{
+	const auto n = PHYSFS_readBytes(_file, buffer.data(), buffer.size());
+	if (n < 0) throw physfs_error(_path);
+	return static_cast<size_t>(n);
 }
 
 void
-euler::util::Storage::create_directory(const char *path)
+euler::util::Storage::Reader::seek(const uint64_t offset)
 {
-	if (!SDL_CreateStorageDirectory(_storage, path))
-		throw std::runtime_error(SDL_GetError());
+	if (!PHYSFS_seek(_file, offset)) throw physfs_error(_path);
 }
 
-struct UserData {
-	using EnumerateCallback = euler::util::Storage::EnumerateCallback;
-	const EnumerateCallback &callback;
-	std::string error;
-	void *
-	to_ptr()
-	{
-		return this;
+uint64_t
+euler::util::Storage::Reader::tell() const
+{
+	const auto pos = PHYSFS_tell(_file);
+	if (pos < 0) throw physfs_error(_path);
+	return static_cast<uint64_t>(pos);
+}
+
+uint64_t
+euler::util::Storage::Reader::size() const
+{
+	return _size;
+}
+
+bool
+euler::util::Storage::Reader::eof() const
+{
+	return PHYSFS_eof(_file) != 0;
+}
+
+euler::util::Reference<euler::util::Storage::Reader>
+euler::util::Storage::open_reader(const char *path,
+    const size_t readahead) const
+{
+	const auto file = PHYSFS_openRead(path);
+	if (file == nullptr) throw physfs_error(path);
+	if (readahead > 0 && !PHYSFS_setBuffer(file, readahead)) {
+		const auto error = physfs_error(path);
+		PHYSFS_close(file);
+		throw error;
 	}
-	static UserData *
-	from_ptr(void *ptr)
-	{
-		return static_cast<UserData *>(ptr);
+	return Reference(new Reader(file, path));
+}
+
+euler::util::Storage::Mapping::~Mapping()
+{
+#ifdef EULER_STORAGE_POSIX
+	if (_base != nullptr) munmap(_base, _length);
+#endif
+}
+
+#ifdef EULER_STORAGE_POSIX
+/* Maps the file backing a storage path if it lives in a plain directory.
+ * Returns false if the path has to go through PhysFS instead. */
+static bool
+map_real_file(const char *path, void *&base, size_t &length)
+{
+	const auto real_dir = PHYSFS_getRealDir(path);
+	if (real_dir == nullptr) return false;
+	std::error_code ec;
+	if (!std::filesystem::is_directory(real_dir, ec)) return false;
+	const auto real_path = std::filesystem::path(real_dir) / path;
+	const auto fd = open(real_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return false;
 	}
-	SDL_EnumerationResult execute(std::string_view directory,
-	    std::string_view file);
-	static SDL_EnumerationResult
-	execute(void *userdata, const char *dir, const char *file)
-	{
-		return from_ptr(userdata)->execute(dir, file);
+	length = static_cast<size_t>(st.st_size);
+	base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	/* The mapping holds its own reference to the file. */
+	close(fd);
+	if (base == MAP_FAILED) {
+		base = nullptr;
+		return false;
 	}
-};
+	return true;
+}
+#endif
 
-SDL_EnumerationResult
-UserData::execute(const std::string_view directory, const std::string_view file)
+euler::util::Reference<euler::util::Storage::Mapping>
+euler::util::Storage::map_file(const char *path) const
 {
-	try {
-		if (callback(directory, file)) return SDL_ENUM_CONTINUE;
-		return SDL_ENUM_SUCCESS;
-	} catch (const std::exception &e) {
-		error = e.what();
-		return SDL_ENUM_FAILURE;
-	} catch (...) {
-		error = "Unknown error in enumerate callback";
-		return SDL_ENUM_FAILURE;
+	auto mapping = Reference(new Mapping());
+#ifdef EULER_STORAGE_POSIX
+	if (map_real_file(path, mapping->_base, mapping->_length)) {
+		mapping->_data = DataView(static_cast<const uint8_t *>(
+					      mapping->_base),
+		    mapping->_length);
+		return mapping;
 	}
+#endif
+	mapping->_copy = read_file(path);
+	mapping->_data = DataView(
+	    reinterpret_cast<const uint8_t *>(mapping->_copy.data()),
+	    mapping->_copy.size());
+	return mapping;
+}
+
+euler::util::Reference<euler::util::Storage::Request>
+euler::util::Storage::read_file_async(const char *path,
+    const Priority priority) const
+{
+	const auto job = loader().submit(path, priority);
+	return Reference(new Request(make_reference(this), job));
+}
+
+size_t
+euler::util::Storage::pending_reads() const
+{
+	return loader().pending();
+}
+
+void
+euler::util::Storage::write_file(const char *path,
+    const std::string_view content)
+{
+	write_storage_file(_storage, path, content);
+	invalidate(path);
+}
+
+void
+euler::util::Storage::write_file_async(const char *path, std::string content)
+{
+	writer().submit(path, std::move(content));
+}
+
+void
+euler::util::Storage::flush()
+{
+	writer().flush();
+}
+
+void
+euler::util::Storage::create_directory(const char *path)
+{
+	if (!SDL_CreateStorageDirectory(_storage, path))
+		throw std::runtime_error(SDL_GetError());
+	invalidate(path);
 }
 
 void
 euler::util::Storage::enumerate_directory(const char *directory,
     const EnumerateCallback &callback) const
 {
-	UserData user_data = {
-		.callback = callback,
-		.error = "",
-	};
-
-	if (!SDL_EnumerateStorageDirectory(_storage, directory,
-		UserData::execute, &user_data)) {
-		throw std::runtime_error(user_data.error);
+	if (directory == nullptr) directory = "";
+	std::vector<std::string> names;
+	{
+		std::lock_guard lock(_index->mutex);
+		const auto node = _index->find(directory);
+		if (node == nullptr || node->type != PathInfo::Type::Directory) {
+			throw std::runtime_error(
+			    std::string("No such directory: ") + directory);
+		}
+		if (!node->listed)
+			_index->list(*node, std::string(Index::trim(directory)));
+		names.reserve(node->children.size());
+		for (const auto &[name, _] : node->children)
+			names.push_back(name);
 	}
+	/* Match SDL, which hands callbacks the directory with a trailing
+	 * separator. */
+	auto dir = std::string(directory);
+	if (!dir.empty() && dir.back() != '/') dir += '/';
+	for (const auto &name : names)
+		if (!callback(dir, name)) break;
 }
+
 void
 euler::util::Storage::remove_path(const char *path)
 {
 	if (!SDL_RemoveStoragePath(_storage, path))
 		throw std::runtime_error(SDL_GetError());
+	invalidate(path);
 }
+
 void
 euler::util::Storage::rename_path(const char *old_path, const char *new_path)
 {
 	if (!SDL_RenameStoragePath(_storage, old_path, new_path))
 		throw std::runtime_error(SDL_GetError());
+	invalidate(old_path);
+	invalidate(new_path);
 }
 
 void
@@ -123,19 +983,7 @@ euler::util::Storage::copy(const char *old_path, const char *new_path)
 {
 	if (!SDL_CopyStorageFile(_storage, old_path, new_path))
 		throw std::runtime_error(SDL_GetError());
-}
-
-using PathInfo = euler::util::Storage::PathInfo;
-
-static PathInfo::Type
-from_sdl(const SDL_PathType type)
-{
-	switch (type) {
-	case SDL_PATHTYPE_NONE: return PathInfo::Type::None;
-	case SDL_PATHTYPE_FILE: return PathInfo::Type::File;
-	case SDL_PATHTYPE_DIRECTORY: return PathInfo::Type::Directory;
-	default: return PathInfo::Type::Other;
-	}
+	invalidate(new_path);
 }
 
 euler::util::Storage::PathInfo
@@ -163,15 +1011,37 @@ std::vector<std::string>
 euler::util::Storage::glob_directory(const char *directory, const char *pattern,
     bool case_insensitive) const
 {
-	const SDL_GlobFlags flags
-	    = case_insensitive ? SDL_GLOB_CASEINSENSITIVE : 0;
-	int count = 0;
-	const auto files = SDL_GlobStorageDirectory(_storage, directory,
-	    pattern, flags, &count);
-	if (files == nullptr) throw std::runtime_error(SDL_GetError());
+	if (directory == nullptr) directory = "";
+	std::lock_guard lock(_index->mutex);
+	const auto node = _index->find(directory);
+	if (node == nullptr || node->type != PathInfo::Type::Directory) {
+		throw std::runtime_error(
+		    std::string("No such directory: ") + directory);
+	}
 	std::vector<std::string> result;
-	result.reserve(count);
-	for (int i = 0; i < count; ++i) result.emplace_back(files[i]);
-	SDL_free(files);
+	_index->glob(*node, std::string(Index::trim(directory)), "", pattern,
+	    case_insensitive, result);
 	return result;
 }
+
+bool
+euler::util::Storage::exists(const char *path) const
+{
+	std::lock_guard lock(_index->mutex);
+	return _index->find(path) != nullptr;
+}
+
+void
+euler::util::Storage::refresh_index()
+{
+	std::lock_guard lock(_index->mutex);
+	_index->root.children.clear();
+	_index->root.listed = false;
+}
+
+void
+euler::util::Storage::invalidate(const std::string_view path) const
+{
+	std::lock_guard lock(_index->mutex);
+	_index->invalidate(path);
+}
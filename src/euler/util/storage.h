@@ -3,7 +3,11 @@
 #ifndef EULER_UTIL_STORAGE_H
 #define EULER_UTIL_STORAGE_H
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -11,16 +15,76 @@
 
 #include "euler/util/object.h"
 #include "euler/util/state.h"
+#include "euler/util/thread.h"
+
+struct PHYSFS_File;
 
 namespace euler::util {
 
 class Storage final : public Object {
+	struct ReadJob;
+	struct Loader;
+	struct Writer;
+
 public:
 	Storage();
 	~Storage() override;
 	using Data = std::vector<uint8_t>;
 	using DataView = std::span<const uint8_t>;
 
+	/* Asynchronous reads are serviced highest priority first. Within a
+	 * priority class, requests are serviced in submission order. */
+	enum class Priority {
+		/* Data the game is blocked on, e.g. mid-level streaming. */
+		Critical,
+		Normal,
+		/* Loads that can arrive late, e.g. UI textures. */
+		Background,
+	};
+
+	static constexpr size_t PRIORITY_COUNT
+	    = static_cast<size_t>(Priority::Background) + 1;
+	static constexpr nthread_t IO_THREAD_COUNT = 2;
+
+	/*
+	 * Handle to a pending asynchronous read. Duplicate requests for the
+	 * same path are coalesced into a single read, with each caller holding
+	 * its own handle. The underlying read is abandoned once every handle
+	 * for it has been cancelled or destroyed before the read has started.
+	 */
+	class Request final : public Object {
+		friend class Storage;
+
+	public:
+		enum class Status {
+			Pending,
+			Loading,
+			Done,
+			Failed,
+			Cancelled,
+		};
+
+		~Request() override;
+
+		[[nodiscard]] Status status() const;
+		[[nodiscard]] bool ready() const;
+		[[nodiscard]] const std::string &path() const;
+
+		/* Blocks until the read completes. Throws if the read failed or
+		 * was cancelled. The returned data lives as long as the
+		 * request. */
+		const std::string &wait() const;
+		void cancel();
+
+	private:
+		Request(const Reference<Storage> &storage,
+		    const std::shared_ptr<ReadJob> &job);
+
+		Reference<Storage> _storage;
+		std::shared_ptr<ReadJob> _job;
+		std::atomic<bool> _cancelled = false;
+	};
+
 	struct PathInfo {
 		enum class Type {
 			None,
@@ -51,6 +115,130 @@ public:
 		return read_file(path.c_str());
 	}
 
+	/*
+	 * Read-only view of a whole file. Files that live in a mounted
+	 * directory are mapped straight from the page cache; anything else,
+	 * such as archive members, falls back to a private copy. The view is
+	 * valid for as long as the mapping is referenced.
+	 */
+	class Mapping final : public Object {
+		friend class Storage;
+
+	public:
+		~Mapping() override;
+
+		[[nodiscard]] DataView
+		data() const
+		{
+			return _data;
+		}
+
+		[[nodiscard]] size_t
+		size() const
+		{
+			return _data.size();
+		}
+
+		/* False if the contents had to be copied onto the heap. */
+		[[nodiscard]] bool
+		mapped() const
+		{
+			return _base != nullptr;
+		}
+
+	private:
+		Mapping() = default;
+
+		DataView _data;
+		void *_base = nullptr;
+		size_t _length = 0;
+		std::string _copy;
+	};
+
+	Reference<Mapping> map_file(const char *path) const;
+
+	Reference<Mapping>
+	map_file(const std::string &path) const
+	{
+		return map_file(path.c_str());
+	}
+
+	/* Reads a whole file into a caller-owned buffer, which must be at
+	 * least file_size() bytes. Returns the number of bytes read. */
+	size_t read_into(const char *path, std::span<uint8_t> buffer) const;
+
+	size_t
+	read_into(const std::string &path, const std::span<uint8_t> buffer) const
+	{
+		return read_into(path.c_str(), buffer);
+	}
+
+	/* Reads up to buffer.size() bytes starting at offset. Returns the
+	 * number of bytes read, which is short only at the end of the file. */
+	size_t read_range(const char *path, uint64_t offset,
+	    std::span<uint8_t> buffer) const;
+
+	size_t
+	read_range(const std::string &path, const uint64_t offset,
+	    const std::span<uint8_t> buffer) const
+	{
+		return read_range(path.c_str(), offset, buffer);
+	}
+
+	/* Sequential reader for decoding large files incrementally. */
+	class Reader final : public Object {
+		friend class Storage;
+
+	public:
+		static constexpr size_t DEFAULT_READAHEAD = 64 * 1024;
+
+		~Reader() override;
+
+		/* Fills as much of buffer as possible, returning the number of
+		 * bytes read. Returns 0 at the end of the file. */
+		size_t read(std::span<uint8_t> buffer);
+		void seek(uint64_t offset);
+		[[nodiscard]] uint64_t tell() const;
+		[[nodiscard]] uint64_t size() const;
+		[[nodiscard]] bool eof() const;
+
+	private:
+		Reader(PHYSFS_File *file, std::string_view path);
+
+		PHYSFS_File *_file;
+		std::string _path;
+		uint64_t _size = 0;
+	};
+
+	/* Opens path for chunked reading. readahead bytes are buffered ahead
+	 * of the caller so small reads don't each hit the backing archive. */
+	Reference<Reader> open_reader(const char *path,
+	    size_t readahead = Reader::DEFAULT_READAHEAD) const;
+
+	Reference<Reader>
+	open_reader(const std::string &path,
+	    const size_t readahead = Reader::DEFAULT_READAHEAD) const
+	{
+		return open_reader(path.c_str(), readahead);
+	}
+
+	/* Queues a read on the I/O threads and returns immediately. */
+	Reference<Request> read_file_async(const char *path,
+	    Priority priority = Priority::Normal) const;
+
+	Reference<Request>
+	read_file_async(const std::string &path,
+	    const Priority priority = Priority::Normal) const
+	{
+		return read_file_async(path.c_str(), priority);
+	}
+
+	/* Number of asynchronous reads that have not yet completed. */
+	size_t pending_reads() const;
+
+	/* Writes are atomic where the platform allows: contents go to a
+	 * temporary file which is synced and then renamed over path, so a
+	 * crash never leaves a partially written file behind. */
 	void write_file(const char *path, std::string_view content);
 
 	void
@@ -74,6 +262,23 @@ public:
 		write_file(str.c_str(), content);
 	}
 
+	/*
+	 * Copies content into the write queue and returns immediately; the
+	 * write itself happens on a background thread. Queued writes to the
+	 * same path are coalesced so only the newest contents hit the disk.
+	 */
+	void write_file_async(const char *path, std::string content);
+
+	void
+	write_file_async(const std::string &path, std::string content)
+	{
+		write_file_async(path.c_str(), std::move(content));
+	}
+
+	/* Blocks until every queued write has completed. Throws the first
+	 * error a background write hit since the last flush. */
+	void flush();
+
 	void create_directory(const char *);
 
 	void
@@ -111,11 +316,41 @@ public:
 	void copy(const char *old_path, const char *new_path);
 	PathInfo path_info(const char *) const;
 	uint64_t space_remaining() const;
+
+	/* Results are served from the directory index; see
+	 * refresh_index(). */
 	std::vector<std::string> glob_directory(const char *directory,
 	    const char *pattern, bool case_insensitive = false) const;
 
+	[[nodiscard]] bool exists(const char *path) const;
+
+	[[nodiscard]] bool
+	exists(const std::string &path) const
+	{
+		return exists(path.c_str());
+	}
+
+	/*
+	 * Directory listings are cached in memory the first time each
+	 * directory is visited, and invalidated by writes made through this
+	 * Storage. Changes made behind its back, such as new mounts, require
+	 * an explicit refresh.
+	 */
+	void refresh_index();
+
 private:
+	struct Index;
+
+	Loader &loader() const;
+	Writer &writer();
+	void invalidate(std::string_view path) const;
+
 	SDL_Storage *_storage;
+	std::unique_ptr<Index> _index;
+	mutable std::once_flag _loader_once;
+	mutable std::unique_ptr<Loader> _loader;
+	std::once_flag _writer_once;
+	std::unique_ptr<Writer> _writer;
 };
 } /* namespace euler::util */
 
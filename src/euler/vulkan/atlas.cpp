@@ -0,0 +1,278 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/atlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+euler::vulkan::AtlasPacker::AtlasPacker(const uint32_t width,
+    const uint32_t height)
+    : _width(width)
+    , _height(height)
+{
+	clear();
+}
+
+void
+euler::vulkan::AtlasPacker::clear()
+{
+	_skyline.clear();
+	_skyline.push_back({ 0, 0, _width });
+	_used = 0;
+}
+
+float
+euler::vulkan::AtlasPacker::occupancy() const
+{
+	return static_cast<float>(_used)
+	    / (static_cast<float>(_width) * static_cast<float>(_height));
+}
+
+std::optional<uint32_t>
+euler::vulkan::AtlasPacker::fit(const size_t index, const uint32_t width,
+    const uint32_t height) const
+{
+	const auto x = _skyline[index].x;
+	if (x + width > _width) return std::nullopt;
+	/* The rectangle rests on the highest segment it spans. */
+	uint32_t y = 0;
+	uint32_t remaining = width;
+	for (auto i = index; remaining > 0; ++i) {
+		if (i == _skyline.size()) return std::nullopt;
+		y = std::max(y, _skyline[i].y);
+		if (y + height > _height) return std::nullopt;
+		remaining -= std::min(remaining, _skyline[i].width);
+	}
+	return y;
+}
+
+void
+euler::vulkan::AtlasPacker::place(const size_t index, const uint32_t x,
+    const uint32_t y, const uint32_t width, const uint32_t height)
+{
+	_skyline.insert(_skyline.begin() + static_cast<ptrdiff_t>(index),
+	    { x, y + height, width });
+	/* Trim or drop the segments now underneath the new one. */
+	const auto right = x + width;
+	for (auto i = index + 1; i < _skyline.size();) {
+		auto &seg = _skyline[i];
+		if (seg.x >= right) break;
+		const auto seg_right = seg.x + seg.width;
+		if (seg_right <= right) {
+			_skyline.erase(_skyline.begin() + static_cast<ptrdiff_t>(i));
+			continue;
+		}
+		seg.width = seg_right - right;
+		seg.x = right;
+		break;
+	}
+	/* Merge neighbours at the same height. */
+	for (size_t i = 0; i + 1 < _skyline.size();) {
+		if (_skyline[i].y == _skyline[i + 1].y) {
+			_skyline[i].width += _skyline[i + 1].width;
+			_skyline.erase(
+			    _skyline.begin() + static_cast<ptrdiff_t>(i + 1));
+			continue;
+		}
+		++i;
+	}
+	_used += static_cast<uint64_t>(width) * height;
+}
+
+std::optional<glm::uvec2>
+euler::vulkan::AtlasPacker::insert(const uint32_t width, const uint32_t height)
+{
+	if (width == 0 || height == 0) return glm::uvec2(0, 0);
+	auto best = std::numeric_limits<size_t>::max();
+	auto best_top = std::numeric_limits<uint32_t>::max();
+	auto best_width = std::numeric_limits<uint32_t>::max();
+	uint32_t best_y = 0;
+	for (size_t i = 0; i < _skyline.size(); ++i) {
+		const auto y = fit(i, width, height);
+		if (!y.has_value()) continue;
+		/* Lowest top edge first, then the narrowest resting place to
+		 * leave wide gaps for wide images. */
+		const auto top = *y + height;
+		if (top < best_top
+		    || (top == best_top && _skyline[i].width < best_width)) {
+			best = i;
+			best_top = top;
+			best_width = _skyline[i].width;
+			best_y = *y;
+		}
+	}
+	if (best == std::numeric_limits<size_t>::max()) return std::nullopt;
+	const auto x = _skyline[best].x;
+	place(best, x, best_y, width, height);
+	return glm::uvec2(x, best_y);
+}
+
+euler::vulkan::Atlas::Atlas(const uint32_t page_size, const uint32_t padding)
+    : _page_size(page_size)
+    , _padding(padding)
+{
+}
+
+std::optional<euler::vulkan::Atlas::Region>
+euler::vulkan::Atlas::find(const std::string_view key) const
+{
+	const auto it = _regions.find(std::string(key));
+	if (it == _regions.end()) return std::nullopt;
+	return it->second;
+}
+
+euler::vulkan::Atlas::Region
+euler::vulkan::Atlas::add(const Image &image)
+{
+	if (const auto it = _regions.find(image.key); it != _regions.end())
+		return it->second;
+	return insert(image);
+}
+
+std::vector<euler::vulkan::Atlas::Region>
+euler::vulkan::Atlas::add(const std::span<const Image> images)
+{
+	/* Skyline packing does best with the tallest images first. */
+	std::vector<size_t> order(images.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::stable_sort(order, [&](const size_t a, const size_t b) {
+		if (images[a].height != images[b].height)
+			return images[a].height > images[b].height;
+		return images[a].width > images[b].width;
+	});
+	std::vector<Region> regions(images.size());
+	for (const auto i : order) regions[i] = add(images[i]);
+	return regions;
+}
+
+euler::vulkan::Atlas::Region
+euler::vulkan::Atlas::insert(const Image &image)
+{
+	if (image.width == 0 || image.height == 0) {
+		throw std::runtime_error(
+		    "Atlas image '" + image.key + "' is empty");
+	}
+	if (image.pixels.size()
+	    < static_cast<size_t>(image.width) * image.height
+		* BYTES_PER_PIXEL) {
+		throw std::runtime_error(
+		    "Atlas image '" + image.key + "' has too few pixels");
+	}
+	const auto width = image.width + 2 * _padding;
+	const auto height = image.height + 2 * _padding;
+	if (width > _page_size || height > _page_size) {
+		throw std::runtime_error(
+		    "Atlas image '" + image.key + "' is larger than a page");
+	}
+	/* Streamed images go into the first page with room, so early pages
+	 * fill up before new ones are created. */
+	for (uint32_t i = 0; i <= _pages.size(); ++i) {
+		if (i == _pages.size()) {
+			_pages.push_back(Page {
+			    AtlasPacker(_page_size, _page_size),
+			    std::vector<uint8_t>(static_cast<size_t>(_page_size)
+				* _page_size * BYTES_PER_PIXEL),
+			});
+		}
+		auto &page = _pages[i];
+		const auto at = page.packer.insert(width, height);
+		if (!at.has_value()) continue;
+		blit(page, *at, image);
+		const auto region = Region {
+			i,
+			glm::vec4(static_cast<float>(at->x + _padding),
+			    static_cast<float>(at->y + _padding),
+			    static_cast<float>(image.width),
+			    static_cast<float>(image.height)),
+		};
+		_regions.emplace(image.key, region);
+		return region;
+	}
+	/* Unreachable: a fresh page always has room. */
+	throw std::runtime_error("Atlas packing failed");
+}
+
+void
+euler::vulkan::Atlas::blit(Page &page, const glm::uvec2 at, const Image &image)
+{
+	const auto stride = static_cast<size_t>(_page_size) * BYTES_PER_PIXEL;
+	const auto row_bytes = static_cast<size_t>(image.width) * BYTES_PER_PIXEL;
+	const auto width = image.width + 2 * _padding;
+	const auto height = image.height + 2 * _padding;
+	auto pixel = [&](const uint32_t x, const uint32_t y) {
+		return page.pixels.data() + y * stride
+		    + static_cast<size_t>(x) * BYTES_PER_PIXEL;
+	};
+	for (uint32_t row = 0; row < height; ++row) {
+		/* Rows in the padding repeat the nearest edge row. */
+		const auto src_row = std::clamp<int64_t>(
+		    static_cast<int64_t>(row) - _padding, 0, image.height - 1);
+		const auto src = image.pixels.data() + src_row * row_bytes;
+		const auto y = at.y + row;
+		std::memcpy(pixel(at.x + _padding, y), src, row_bytes);
+		for (uint32_t i = 0; i < _padding; ++i) {
+			std::memcpy(pixel(at.x + i, y), src, BYTES_PER_PIXEL);
+			std::memcpy(pixel(at.x + _padding + image.width + i, y),
+			    src + row_bytes - BYTES_PER_PIXEL, BYTES_PER_PIXEL);
+		}
+	}
+	const auto box = glm::uvec4(at.x, at.y, at.x + width, at.y + height);
+	if (!page.is_dirty) {
+		page.dirty = box;
+		page.is_dirty = true;
+		return;
+	}
+	page.dirty = glm::uvec4(std::min(page.dirty.x, box.x),
+	    std::min(page.dirty.y, box.y), std::max(page.dirty.z, box.z),
+	    std::max(page.dirty.w, box.w));
+}
+
+std::vector<uint32_t>
+euler::vulkan::Atlas::take_dirty()
+{
+	std::vector<uint32_t> dirty;
+	for (uint32_t i = 0; i < _pages.size(); ++i) {
+		if (!_pages[i].is_dirty) continue;
+		_pages[i].is_dirty = false;
+		dirty.push_back(i);
+	}
+	return dirty;
+}
+
+void
+euler::vulkan::Atlas::upload(const util::Reference<Renderer> &renderer,
+    Uploader &uploader, TextureTable &table)
+{
+	const auto stride = static_cast<size_t>(_page_size) * BYTES_PER_PIXEL;
+	for (const auto index : take_dirty()) {
+		auto &page = _pages[index];
+		/* A new texture's contents are undefined, so its first upload
+		 * is the whole page. */
+		if (page.texture == nullptr) {
+			page.texture = util::make_reference<Texture>(renderer,
+			    _page_size, _page_size);
+			uploader.upload(page.texture, page.pixels);
+			page.texture_index = table.add(page.texture);
+			continue;
+		}
+		const auto box = page.dirty;
+		const auto row_bytes
+		    = static_cast<size_t>(box.z - box.x) * BYTES_PER_PIXEL;
+		std::vector<uint8_t> pixels(row_bytes * (box.w - box.y));
+		for (auto y = box.y; y < box.w; ++y) {
+			std::memcpy(pixels.data() + (y - box.y) * row_bytes,
+			    page.pixels.data() + y * stride
+				+ static_cast<size_t>(box.x) * BYTES_PER_PIXEL,
+			    row_bytes);
+		}
+		uploader.upload(page.texture, pixels,
+		    vk::Rect2D {
+			{ static_cast<int32_t>(box.x),
+			    static_cast<int32_t>(box.y) },
+			{ box.z - box.x, box.w - box.y },
+		    });
+	}
+}
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_ATLAS_H
+#define EULER_VULKAN_ATLAS_H
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/texture.h"
+#include "euler/vulkan/texture_table.h"
+#include "euler/vulkan/uploader.h"
+
+namespace euler::vulkan {
+
+/* Skyline bottom-left rectangle packer. Tracks only the top edge of what has
+ * been placed, so insertion is linear in the number of skyline segments. */
+class AtlasPacker {
+public:
+	AtlasPacker(uint32_t width, uint32_t height);
+
+	/* Returns the top-left corner of the placed rectangle, or nothing if
+	 * it doesn't fit. */
+	std::optional<glm::uvec2> insert(uint32_t width, uint32_t height);
+	void clear();
+
+	[[nodiscard]] uint32_t
+	width() const
+	{
+		return _width;
+	}
+
+	[[nodiscard]] uint32_t
+	height() const
+	{
+		return _height;
+	}
+
+	/* Fraction of the area covered by placed rectangles. */
+	[[nodiscard]] float occupancy() const;
+
+private:
+	struct Segment {
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	std::optional<uint32_t> fit(size_t index, uint32_t width,
+	    uint32_t height) const;
+	void place(size_t index, uint32_t x, uint32_t y, uint32_t width,
+	    uint32_t height);
+
+	uint32_t _width;
+	uint32_t _height;
+	uint64_t _used = 0;
+	std::vector<Segment> _skyline;
+};
+
+/*
+ * Packs RGBA8 images into large pages so that many sprites share a texture.
+ * Images can be added at load time in bulk, which packs them largest first,
+ * or one at a time as assets stream in. Each image is surrounded by a border
+ * of its own edge pixels so filtering never bleeds across neighbours.
+ *
+ * Pixels live on the CPU. upload() copies the pages touched since it last
+ * ran to their textures and records each page's TextureTable slot, which is
+ * what sprites drawing from that page pass as their texture index.
+ * Callers managing textures themselves can use take_dirty() and
+ * set_texture_index() instead.
+ */
+class Atlas final : public util::Object {
+public:
+	static constexpr uint32_t DEFAULT_PAGE_SIZE = 2048;
+	static constexpr uint32_t DEFAULT_PADDING = 1;
+	static constexpr uint32_t BYTES_PER_PIXEL = 4;
+
+	struct Image {
+		std::string key;
+		std::span<const uint8_t> pixels;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct Region {
+		uint32_t page;
+		/* x, y, w, h in texels, as DrawCommand::texture_pos expects */
+		glm::vec4 texture_pos;
+	};
+
+	struct Page {
+		AtlasPacker packer;
+		std::vector<uint8_t> pixels;
+		uint32_t texture_index = 0;
+		/* Created by the first upload(). */
+		util::Reference<Texture> texture;
+		/* Bounding box of changes since the last take_dirty(), as
+		 * x0, y0, x1, y1. */
+		glm::uvec4 dirty = { 0, 0, 0, 0 };
+		bool is_dirty = false;
+	};
+
+	explicit Atlas(uint32_t page_size = DEFAULT_PAGE_SIZE,
+	    uint32_t padding = DEFAULT_PADDING);
+	~Atlas() override = default;
+
+	/* Adding a key that is already present returns the existing region
+	 * without touching the pixels. Throws if the image is empty or can't
+	 * fit on an empty page. */
+	Region add(const Image &image);
+	std::vector<Region> add(std::span<const Image> images);
+
+	[[nodiscard]] std::optional<Region> find(std::string_view key) const;
+
+	[[nodiscard]] size_t
+	page_count() const
+	{
+		return _pages.size();
+	}
+
+	[[nodiscard]] const Page &
+	page(const size_t index) const
+	{
+		return _pages.at(index);
+	}
+
+	[[nodiscard]] uint32_t
+	page_size() const
+	{
+		return _page_size;
+	}
+
+	/* Returns the pages changed since the last call and marks them
+	 * clean. */
+	std::vector<uint32_t> take_dirty();
+
+	/* Queues the changed part of every dirty page on uploader, creating
+	 * page textures as needed, and adds new ones to table. Main
+	 * thread. */
+	void upload(const util::Reference<Renderer> &renderer,
+	    Uploader &uploader, TextureTable &table);
+
+	void
+	set_texture_index(const uint32_t page, const uint32_t index)
+	{
+		_pages.at(page).texture_index = index;
+	}
+
+	[[nodiscard]] uint32_t
+	texture_index(const Region &region) const
+	{
+		return _pages.at(region.page).texture_index;
+	}
+
+private:
+	Region insert(const Image &image);
+	void blit(Page &page, glm::uvec2 at, const Image &image);
+
+	uint32_t _page_size;
+	uint32_t _padding;
+	std::vector<Page> _pages;
+	std::unordered_map<std::string, Region> _regions;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_ATLAS_H */
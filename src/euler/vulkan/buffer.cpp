@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/buffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+euler::vulkan::Buffer::Buffer(const util::Reference<Renderer> &renderer,
+    const vk::DeviceSize size, const vk::BufferUsageFlags usage,
+    const vk::MemoryPropertyFlags properties)
+    : _renderer(renderer)
+    , _size(size)
+{
+	const auto &ctx = renderer->context();
+	_buffer = ctx.device.createBuffer(vk::BufferCreateInfo {
+	    .size = size,
+	    .usage = usage,
+	    .sharingMode = vk::SharingMode::eExclusive,
+	});
+	const auto requirements
+	    = ctx.device.getBufferMemoryRequirements(_buffer);
+	const auto type = find_memory_type(ctx.physical_device,
+	    requirements.memoryTypeBits, properties);
+	try {
+		_memory = ctx.device.allocateMemory(vk::MemoryAllocateInfo {
+		    .allocationSize = requirements.size,
+		    .memoryTypeIndex = type,
+		});
+	} catch (...) {
+		ctx.device.destroyBuffer(_buffer);
+		throw;
+	}
+	ctx.device.bindBufferMemory(_buffer, _memory, 0);
+	if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+		const auto ptr = ctx.device.mapMemory(_memory, 0, size);
+		_mapped = std::span(static_cast<uint8_t *>(ptr), size);
+		_coherent = static_cast<bool>(
+		    properties & vk::MemoryPropertyFlagBits::eHostCoherent);
+	}
+}
+
+euler::vulkan::Buffer::~Buffer()
+{
+	const auto device = _renderer->context().device;
+	if (!_mapped.empty()) device.unmapMemory(_memory);
+	device.destroyBuffer(_buffer);
+	device.freeMemory(_memory);
+}
+
+void
+euler::vulkan::Buffer::flush(const vk::DeviceSize offset,
+    const vk::DeviceSize size) const
+{
+	if (_coherent || _mapped.empty()) return;
+	/* Ranges must be aligned to nonCoherentAtomSize; flushing whole
+	 * atoms around the range is always allowed. */
+	const auto atom = _renderer->context()
+			      .physical_device.getProperties()
+			      .limits.nonCoherentAtomSize;
+	const auto begin = offset / atom * atom;
+	const auto end = std::min(_size, (offset + size + atom - 1) / atom * atom);
+	_renderer->context().device.flushMappedMemoryRanges(
+	    vk::MappedMemoryRange {
+		.memory = _memory,
+		.offset = begin,
+		.size = end == _size ? VK_WHOLE_SIZE : end - begin,
+	    });
+}
+
+uint32_t
+euler::vulkan::Buffer::find_memory_type(
+    const vk::PhysicalDevice physical_device, const uint32_t type_bits,
+    const vk::MemoryPropertyFlags properties)
+{
+	const auto memory = physical_device.getMemoryProperties();
+	for (uint32_t i = 0; i < memory.memoryTypeCount; ++i) {
+		if ((type_bits & (1u << i)) == 0) continue;
+		if ((memory.memoryTypes[i].propertyFlags & properties)
+		    == properties)
+			return i;
+	}
+	throw std::runtime_error("No suitable Vulkan memory type");
+}
@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_BUFFER_H
+#define EULER_VULKAN_BUFFER_H
+
+#include <span>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/renderer.h"
+
+namespace euler::vulkan {
+
+/* A buffer with its own dedicated allocation. Host-visible buffers are
+ * mapped for their whole lifetime. */
+class Buffer final : public util::Object {
+public:
+	Buffer(const util::Reference<Renderer> &renderer, vk::DeviceSize size,
+	    vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+	~Buffer() override;
+
+	[[nodiscard]] vk::Buffer
+	buffer() const
+	{
+		return _buffer;
+	}
+
+	[[nodiscard]] vk::DeviceSize
+	size() const
+	{
+		return _size;
+	}
+
+	/* Empty unless the memory is host-visible. */
+	[[nodiscard]] std::span<uint8_t>
+	mapped() const
+	{
+		return _mapped;
+	}
+
+	/* Needed after CPU writes unless the memory is host-coherent. */
+	void flush(vk::DeviceSize offset, vk::DeviceSize size) const;
+
+	static uint32_t find_memory_type(vk::PhysicalDevice physical_device,
+	    uint32_t type_bits, vk::MemoryPropertyFlags properties);
+
+private:
+	util::Reference<Renderer> _renderer;
+	vk::Buffer _buffer;
+	vk::DeviceMemory _memory;
+	vk::DeviceSize _size;
+	std::span<uint8_t> _mapped;
+	bool _coherent = false;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_BUFFER_H */
@@ -2,6 +2,132 @@
 
 #include "euler/vulkan/camera.h"
 
+#include <cmath>
+#include <span>
+
+#include <VK2D/VK2D.h>
+
+#include "euler/vulkan/descriptor_buffer.h"
 #include "euler/vulkan/renderer.h"
-#include "glm/ext/matrix_clip_space.hpp"
+#include "euler/vulkan/surface.h"
 #include "glm/ext/matrix_transform.hpp"
+
+euler::vulkan::Camera::Camera(const util::Reference<Surface> &surface,
+    const Spec &spec)
+    : _spec(spec)
+    , _surface(surface.weaken())
+{
+	_index = surface->attach_camera(this);
+	_attached = true;
+	_dirty = surface->renderer()->context().frames_in_flight;
+}
+
+euler::vulkan::Camera::~Camera() { detach(); }
+
+void
+euler::vulkan::Camera::detach()
+{
+	if (!_attached) return;
+	_attached = false;
+	if (const auto surface = _surface.strengthen(); surface != nullptr)
+		surface->detach_camera(this);
+}
+
+void
+euler::vulkan::Camera::set_spec(const Spec &spec)
+{
+	_spec = spec;
+	if (const auto surface = _surface.strengthen(); surface != nullptr)
+		_dirty = surface->renderer()->context().frames_in_flight;
+}
+
+void
+euler::vulkan::Camera::set_state(const State state)
+{
+	if (_state == State::Deleted) return;
+	if (state == State::Deleted) {
+		_state = state;
+		detach();
+		return;
+	}
+	if (state != State::Reset) {
+		_state = state;
+		return;
+	}
+	const auto surface = _surface.strengthen();
+	if (surface == nullptr) return;
+	const auto w = static_cast<float>(surface->width());
+	const auto h = static_cast<float>(surface->height());
+	_state = State::Normal;
+	set_spec(Spec {
+	    .x = 0,
+	    .y = 0,
+	    .w = w,
+	    .h = h,
+	    .zoom = 1,
+	    .rotation = 0,
+	    .on_screen = { 0, 0, w, h },
+	});
+}
+
+void
+euler::vulkan::Camera::flush_ubo(DescriptorBuffer &buffer)
+{
+	if (_dirty == 0 || !_attached) return;
+	const auto matrix = ubo();
+	buffer.write(_index,
+	    std::span(reinterpret_cast<const uint8_t *>(&matrix),
+		sizeof(matrix)));
+	--_dirty;
+}
+
+glm::mat4
+euler::vulkan::Camera::matrix(const Spec &spec)
+{
+	/* World space is y down like Vulkan's clip space, so no flip is
+	 * needed; depth is flattened to zero. */
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const glm::vec2 extent = { spec.w / zoom, spec.h / zoom };
+	const glm::vec2 centre = glm::vec2(spec.x, spec.y) + extent * 0.5f;
+	auto view = glm::scale(glm::mat4(1.0f),
+	    glm::vec3(2.0f / extent.x, 2.0f / extent.y, 0.0f));
+	view = glm::rotate(view, -spec.rotation, glm::vec3(0, 0, 1));
+	return glm::translate(view, glm::vec3(-centre, 0.0f));
+}
+
+glm::vec4
+euler::vulkan::Camera::view_rect(const Spec &spec)
+{
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const glm::vec2 half = { spec.w / zoom * 0.5f, spec.h / zoom * 0.5f };
+	const glm::vec2 centre = glm::vec2(spec.x, spec.y) + half;
+	/* Bounds of the rotated view. */
+	const auto c = std::abs(std::cos(spec.rotation));
+	const auto s = std::abs(std::sin(spec.rotation));
+	const glm::vec2 bounds = { c * half.x + s * half.y,
+		s * half.x + c * half.y };
+	return { centre.x - bounds.x, centre.y - bounds.y, bounds.x * 2,
+		bounds.y * 2 };
+}
+
+euler::util::Reference<euler::vulkan::Surface>
+euler::vulkan::Camera::surface() const
+{
+	return _surface.strengthen();
+}
+
+euler::vulkan::Camera::Spec
+euler::vulkan::Camera::vk2d_spec()
+{
+	const auto camera = vk2dRendererGetCamera();
+	return Spec {
+		.x = camera.x,
+		.y = camera.y,
+		.w = camera.w,
+		.h = camera.h,
+		.zoom = camera.zoom,
+		.rotation = camera.rot,
+		.on_screen = { camera.xOnScreen, camera.yOnScreen,
+		    camera.wOnScreen, camera.hOnScreen },
+	};
+}
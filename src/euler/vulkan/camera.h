@@ -3,32 +3,42 @@
 #ifndef EULER_VULKAN_CAMERA_H
 #define EULER_VULKAN_CAMERA_H
 
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
 
 #include "euler/util/object.h"
 
 namespace euler::vulkan {
+class DescriptorBuffer;
 class Renderer;
 class Surface;
-class DescriptorBuffer;
 
+/*
+ * A view of the world drawn into a rectangle of the surface. Any number of
+ * cameras can be active at once, e.g. for splitscreen or a minimap; each
+ * owns an element of the sprite renderer's camera buffer, and its matrix is
+ * only uploaded after it changes.
+ */
 class Camera final : public util::Object {
 public:
-	using Index = uint16_t;
+	using Index = uint32_t;
 
 	enum class State {
 		Normal,
 		Disabled,
 		Deleted,
+		/* Goes back to the whole surface and Normal. */
 		Reset,
 	};
 
 	struct Spec {
+		/* Top left of the view in world space */
 		float x;
 		float y;
+		/* Size of the view in pixels; zoom scales the world */
 		float w;
 		float h;
 		float zoom;
+		/* Radians, about the centre of the view */
 		float rotation;
 		struct {
 			float x;
@@ -39,7 +49,7 @@ public:
 	};
 
 	Camera(const util::Reference<Surface> &surface, const Spec &spec);
-	~Camera() override = default;
+	~Camera() override;
 	void set_spec(const Spec &spec);
 	const Spec &
 	spec() const
@@ -48,24 +58,50 @@ public:
 	}
 
 	State state() const { return _state; }
-	void flush_ubo(DescriptorBuffer &buffer);
 	void set_state(State state);
-	glm::mat4 ubo() const;
+	/* Writes the matrix into the buffer's current frame if it changed
+	 * within the last frames in flight. */
+	void flush_ubo(DescriptorBuffer &buffer);
+	/* World to clip space, mapping the view onto its on-screen
+	 * rectangle's viewport. */
+	[[nodiscard]] glm::mat4
+	ubo() const
+	{
+		return matrix(_spec);
+	}
+
+	[[nodiscard]] static glm::mat4 matrix(const Spec &spec);
+	/* x, y, w, h of the world the camera can see, rotation included. */
+	[[nodiscard]] glm::vec4
+	view_rect() const
+	{
+		return view_rect(_spec);
+	}
+
+	[[nodiscard]] static glm::vec4 view_rect(const Spec &spec);
 	[[nodiscard]] util::Reference<Surface> surface() const;
 
+	/* The view VK2D draws with when no camera is enabled. */
+	[[nodiscard]] static Spec vk2d_spec();
+
+	/* Element of the sprite renderer's camera buffer. */
 	Index index() const
 	{
 		return _index;
 	}
 
 private:
+	void detach();
+
 	Spec _spec;
 	Index _index = 0;
 	util::WeakReference<Surface> _surface;
 	State _state = State::Normal;
+	/* Frames whose copy of the matrix is stale. */
+	uint32_t _dirty = 0;
+	bool _attached = false;
 };
 } /* namespace euler::vulkan */
 
 
 #endif /* EULER_VULKAN_CAMERA_H */
-
@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/descriptor_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+euler::vulkan::DescriptorBuffer::DescriptorBuffer(
+    const util::Reference<Renderer> &renderer,
+    const util::Reference<Shader> &shader, const uint32_t set,
+    const vk::DeviceSize element_size, const Index capacity)
+    : _renderer(renderer)
+    , _shader(shader)
+    , _set_index(set)
+    , _element_size(element_size)
+{
+	auto found = false;
+	for (const auto &binding : shader->bindings()) {
+		if (binding.set != set) continue;
+		if (found || binding.count != 1
+		    || (binding.type != vk::DescriptorType::eUniformBuffer
+			&& binding.type
+			    != vk::DescriptorType::eUniformBufferDynamic)) {
+			throw std::runtime_error(std::format(
+			    "Descriptor set {} is not a single uniform buffer",
+			    set));
+		}
+		found = true;
+		_binding = binding.binding;
+	}
+	if (!found) {
+		throw std::runtime_error(
+		    std::format("Shader has no descriptor set {}", set));
+	}
+	shader->use_dynamic_offset(set, _binding);
+
+	const auto &ctx = renderer->context();
+	const auto alignment = ctx.physical_device.getProperties()
+				   .limits.minUniformBufferOffsetAlignment;
+	_stride = (element_size + alignment - 1) / alignment * alignment;
+	const vk::DescriptorPoolSize size = {
+		.type = vk::DescriptorType::eUniformBufferDynamic,
+		.descriptorCount = 1,
+	};
+	_pool = ctx.device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+	    .maxSets = 1,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &size,
+	});
+	const auto layout = shader->set_layouts()[set];
+	try {
+		_set = ctx.device.allocateDescriptorSets(
+		    vk::DescriptorSetAllocateInfo {
+			.descriptorPool = _pool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout,
+		    })[0];
+		create_buffer(std::max<Index>(capacity, 1));
+	} catch (...) {
+		ctx.device.destroyDescriptorPool(_pool);
+		throw;
+	}
+}
+
+euler::vulkan::DescriptorBuffer::~DescriptorBuffer()
+{
+	/* Frames may still read the ring. */
+	const auto device = _renderer->context().device;
+	device.waitIdle();
+	device.destroyDescriptorPool(_pool);
+}
+
+void
+euler::vulkan::DescriptorBuffer::create_buffer(const Index capacity)
+{
+	const auto &ctx = _renderer->context();
+	const auto buffer = util::make_reference<Buffer>(_renderer,
+	    ctx.frames_in_flight * capacity * _stride,
+	    vk::BufferUsageFlagBits::eUniformBuffer,
+	    vk::MemoryPropertyFlagBits::eHostVisible
+		| vk::MemoryPropertyFlagBits::eHostCoherent);
+	if (_buffer != nullptr) {
+		/* Frames in flight still read the old buffer through the
+		 * set, which can't be rewritten under them. */
+		ctx.device.waitIdle();
+		const auto from = _buffer->mapped();
+		const auto to = buffer->mapped();
+		const auto region = _capacity * _stride;
+		for (uint32_t r = 0; r < ctx.frames_in_flight; ++r) {
+			std::memcpy(to.data() + r * capacity * _stride,
+			    from.data() + r * region, region);
+		}
+	}
+	const vk::DescriptorBufferInfo info = {
+		.buffer = buffer->buffer(),
+		.offset = 0,
+		.range = _element_size,
+	};
+	ctx.device.updateDescriptorSets(
+	    vk::WriteDescriptorSet {
+		.dstSet = _set,
+		.dstBinding = _binding,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+		.pBufferInfo = &info,
+	    },
+	    nullptr);
+	_buffer = buffer;
+	_capacity = capacity;
+}
+
+euler::vulkan::DescriptorBuffer::Index
+euler::vulkan::DescriptorBuffer::allocate()
+{
+	if (!_free.empty()) {
+		const auto index = _free.back();
+		_free.pop_back();
+		return index;
+	}
+	if (_next == _capacity) {
+		_renderer->log()->debug("Growing descriptor buffer to {} "
+					"elements",
+		    _capacity * 2);
+		create_buffer(_capacity * 2);
+	}
+	return _next++;
+}
+
+void
+euler::vulkan::DescriptorBuffer::release(const Index index)
+{
+	_free.push_back(index);
+}
+
+void
+euler::vulkan::DescriptorBuffer::begin_frame(const uint32_t frame)
+{
+	if (frame >= _renderer->context().frames_in_flight) {
+		throw std::runtime_error(
+		    std::format("No frame {} in flight", frame));
+	}
+	_region = frame;
+}
+
+void
+euler::vulkan::DescriptorBuffer::write(const Index index,
+    const std::span<const uint8_t> data)
+{
+	if (index >= _capacity || data.size() > _element_size) {
+		throw std::runtime_error(std::format(
+		    "Bad descriptor buffer write of {} bytes to element {}",
+		    data.size(), index));
+	}
+	std::memcpy(_buffer->mapped().data() + offset(index), data.data(),
+	    data.size());
+}
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_DESCRIPTOR_BUFFER_H
+#define EULER_VULKAN_DESCRIPTOR_BUFFER_H
+
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/buffer.h"
+#include "euler/vulkan/shader.h"
+
+namespace euler::vulkan {
+
+/*
+ * Fixed-size uniform elements, such as camera matrices, in a host-visible
+ * ring with one region per frame in flight. The whole ring is one dynamic
+ * uniform buffer descriptor whose range is a single element, so any number
+ * of elements is reached by the offset given when the set is bound.
+ *
+ * Each frame writes into its own region, so an element that changes has to
+ * be written once per frame in flight; writers track that themselves.
+ * Growing the ring waits for the device, so size it for the expected count.
+ *
+ * Main thread only.
+ */
+class DescriptorBuffer final : public util::Object {
+public:
+	using Index = uint32_t;
+
+	static constexpr Index DEFAULT_CAPACITY = 16;
+
+	/* The buffer is the descriptor set set of shader, which must contain
+	 * exactly one uniform buffer; it is made dynamic. */
+	DescriptorBuffer(const util::Reference<Renderer> &renderer,
+	    const util::Reference<Shader> &shader, uint32_t set,
+	    vk::DeviceSize element_size, Index capacity = DEFAULT_CAPACITY);
+	~DescriptorBuffer() override;
+
+	/* Grows the ring if every element is taken. */
+	Index allocate();
+	void release(Index index);
+
+	/* Selects frame's region for write() and offset(). Call once
+	 * frame's fence has signalled. */
+	void begin_frame(uint32_t frame);
+
+	/* Writes element index in the current frame's region. */
+	void write(Index index, std::span<const uint8_t> data);
+
+	/* Offset of element index in the current frame's region, for
+	 * vkCmdBindDescriptorSets. */
+	[[nodiscard]] uint32_t
+	offset(const Index index) const
+	{
+		return static_cast<uint32_t>(
+		    (_region * _capacity + index) * _stride);
+	}
+
+	[[nodiscard]] vk::DescriptorSet
+	descriptor_set() const
+	{
+		return _set;
+	}
+
+	[[nodiscard]] uint32_t
+	set_index() const
+	{
+		return _set_index;
+	}
+
+	[[nodiscard]] Index
+	capacity() const
+	{
+		return _capacity;
+	}
+
+private:
+	void create_buffer(Index capacity);
+
+	util::Reference<Renderer> _renderer;
+	/* Owns the set layout. */
+	util::Reference<Shader> _shader;
+	uint32_t _set_index;
+	uint32_t _binding = 0;
+	vk::DeviceSize _element_size;
+	/* Element size rounded up to minUniformBufferOffsetAlignment. */
+	vk::DeviceSize _stride;
+	Index _capacity = 0;
+	uint32_t _region = 0;
+	vk::DescriptorPool _pool;
+	vk::DescriptorSet _set;
+	util::Reference<Buffer> _buffer;
+	std::vector<Index> _free;
+	Index _next = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_DESCRIPTOR_BUFFER_H */
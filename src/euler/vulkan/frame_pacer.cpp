@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/frame_pacer.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+/* Slack left between the end of the CPU frame and the refresh. */
+static constexpr auto SAFETY_MARGIN = 1ms;
+/* OS sleeps overshoot; the last stretch is spent yielding instead. */
+static constexpr auto SPIN_TIME = 1ms;
+
+euler::vulkan::FramePacer::FramePacer() { _samples.reserve(HISTORY); }
+
+void
+euler::vulkan::FramePacer::set_enabled(const bool enabled)
+{
+	_enabled = enabled;
+	_deadline = {};
+}
+
+void
+euler::vulkan::FramePacer::set_refresh_rate(const double hz)
+{
+	_refresh_rate = hz > 0 ? hz : DEFAULT_REFRESH_RATE;
+}
+
+void
+euler::vulkan::FramePacer::set_frame_limit(const double hz)
+{
+	_frame_limit = std::max(hz, 0.0);
+	_deadline = {};
+}
+
+std::chrono::steady_clock::duration
+euler::vulkan::FramePacer::interval() const
+{
+	const auto hz = _frame_limit > 0 ? _frame_limit : _refresh_rate;
+	return std::chrono::duration_cast<clock::duration>(
+	    std::chrono::duration<double>(1.0 / hz));
+}
+
+void
+euler::vulkan::FramePacer::wait()
+{
+	if (_enabled && _deadline != clock::time_point {}) {
+		const auto wake_at = _deadline
+		    - std::chrono::duration_cast<clock::duration>(_frame_time)
+		    - SAFETY_MARGIN;
+		if (wake_at - SPIN_TIME > clock::now())
+			std::this_thread::sleep_until(wake_at - SPIN_TIME);
+		while (clock::now() < wake_at) std::this_thread::yield();
+	}
+	_wake = clock::now();
+}
+
+void
+euler::vulkan::FramePacer::input_sampled()
+{
+	if (_have_input) return;
+	_input = clock::now();
+	_have_input = true;
+}
+
+void
+euler::vulkan::FramePacer::presented()
+{
+	const auto now = clock::now();
+	if (_have_input) {
+		const auto sample = duration(now - _input);
+		if (_samples.size() < HISTORY)
+			_samples.push_back(sample);
+		else
+			_samples[_next_sample] = sample;
+		_next_sample = (_next_sample + 1) % HISTORY;
+		_have_input = false;
+	}
+	if (_wake != clock::time_point {}) {
+		/* Rise quickly and fall slowly, so a single slow frame pushes
+		 * the wake-up earlier straight away. */
+		const auto work = duration(now - _wake);
+		const auto weight = work > _frame_time ? 0.5 : 0.05;
+		_frame_time += (work - _frame_time) * weight;
+	}
+	const auto step = interval();
+	if (_deadline == clock::time_point {}) {
+		_deadline = now + step;
+		return;
+	}
+	_deadline += step;
+	/* Missed the predicted refresh; start again from this present. */
+	if (_deadline <= now) _deadline = now + step;
+}
+
+euler::vulkan::FramePacer::Latency
+euler::vulkan::FramePacer::latency() const
+{
+	if (_samples.empty()) return {};
+	auto sorted = _samples;
+	const auto p99 = sorted.begin()
+	    + static_cast<ptrdiff_t>((sorted.size() - 1) * 99 / 100);
+	std::ranges::nth_element(sorted, p99);
+	return Latency {
+		.last = _samples[(_next_sample + HISTORY - 1) % HISTORY],
+		.mean = std::accumulate(_samples.begin(), _samples.end(),
+			    duration::zero())
+		    / static_cast<double>(_samples.size()),
+		.p99 = *p99,
+		.max = std::ranges::max(_samples),
+		.frames = _samples.size(),
+	};
+}
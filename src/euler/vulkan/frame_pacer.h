@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_FRAME_PACER_H
+#define EULER_VULKAN_FRAME_PACER_H
+
+#include <chrono>
+#include <vector>
+
+#include "euler/util/object.h"
+
+namespace euler::vulkan {
+
+/*
+ * Paces frames for low input latency and measures input-to-present time.
+ *
+ * With a non-blocking present mode (mailbox or immediate) the CPU would
+ * otherwise run ahead and sample input long before the frame is shown. When
+ * enabled, wait() sleeps until the predicted start of the next refresh minus
+ * the recent CPU frame time, so input is sampled as late as still makes that
+ * refresh. The prediction is re-anchored to present times whenever a frame
+ * runs late.
+ *
+ * Latency is always recorded: input_sampled() marks the start of event
+ * polling and presented() the return from queue present.
+ */
+class FramePacer final : public util::Object {
+public:
+	using clock = std::chrono::steady_clock;
+	using duration = std::chrono::duration<double, std::milli>;
+
+	/* Frames kept for the latency statistics. */
+	static constexpr size_t HISTORY = 240;
+	static constexpr double DEFAULT_REFRESH_RATE = 60.0;
+
+	struct Latency {
+		duration last = duration::zero();
+		duration mean = duration::zero();
+		duration p99 = duration::zero();
+		duration max = duration::zero();
+		size_t frames = 0;
+	};
+
+	FramePacer();
+	~FramePacer() override = default;
+
+	/* Sleeps until the frame should start. Returns immediately when
+	 * pacing is disabled. */
+	void wait();
+	void input_sampled();
+	void presented();
+
+	[[nodiscard]] bool
+	enabled() const
+	{
+		return _enabled;
+	}
+
+	void set_enabled(bool enabled);
+
+	/* The display's refresh rate, in Hz. Zero or less restores the
+	 * default. */
+	void set_refresh_rate(double hz);
+
+	/* Target frame rate in Hz, which may be above the refresh rate in
+	 * immediate mode. Zero paces to the refresh rate. */
+	void set_frame_limit(double hz);
+
+	[[nodiscard]] double
+	frame_limit() const
+	{
+		return _frame_limit;
+	}
+
+	/* Smoothed time from wake-up to present. */
+	[[nodiscard]] duration
+	frame_time() const
+	{
+		return _frame_time;
+	}
+
+	[[nodiscard]] Latency latency() const;
+
+private:
+	[[nodiscard]] clock::duration interval() const;
+
+	bool _enabled = false;
+	double _refresh_rate = DEFAULT_REFRESH_RATE;
+	double _frame_limit = 0;
+	duration _frame_time = duration::zero();
+	/* Predicted time of the refresh the current frame is aiming for. */
+	clock::time_point _deadline;
+	clock::time_point _wake;
+	clock::time_point _input;
+	bool _have_input = false;
+	std::vector<duration> _samples;
+	size_t _next_sample = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_FRAME_PACER_H */
@@ -0,0 +1,846 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/lighting.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+
+#include <VK2D/VK2D.h>
+
+/* Mirrors the std430 Light in lights.vert and light_shadows.vert. */
+struct GpuLight {
+	glm::vec2 position;
+	float radius;
+	uint32_t flags;
+	glm::vec4 colour;
+};
+
+static_assert(offsetof(GpuLight, radius) == 8);
+static_assert(offsetof(GpuLight, flags) == 12);
+static_assert(offsetof(GpuLight, colour) == 16);
+static_assert(sizeof(GpuLight) == 32);
+
+static constexpr uint32_t CASTS_SHADOWS = 1;
+
+/* The push constant block of both pipelines. */
+struct Push {
+	glm::vec2 origin;
+	glm::vec2 extent;
+	float scale;
+};
+
+/* Smallest range a layer is given once it has edges. */
+static constexpr size_t MIN_LAYER_EDGES = 16;
+
+static constexpr auto MASK_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+static constexpr vk::ImageSubresourceRange
+color_range(const uint32_t layer, const uint32_t count)
+{
+	return vk::ImageSubresourceRange {
+		.aspectMask = vk::ImageAspectFlagBits::eColor,
+		.baseMipLevel = 0,
+		.levelCount = 1,
+		.baseArrayLayer = layer,
+		.layerCount = count,
+	};
+}
+
+static const glm::vec4 WHITE = { 1, 1, 1, 1 };
+
+static void
+set_colour(const glm::vec4 &colour)
+{
+	float mod[4] = { colour.r, colour.g, colour.b, colour.a };
+	vk2dRendererSetColourMod(mod);
+}
+
+static void
+draw_texture(VK2DTexture_t *texture, const float x, const float y,
+    const float scale_x, const float scale_y)
+{
+	vk2dRendererDrawTexture(texture, x, y, scale_x, scale_y, 0, 0, 0, 0, 0,
+	    vk2dTextureWidth(texture), vk2dTextureHeight(texture));
+}
+
+euler::vulkan::Lighting::Lighting(const util::Reference<Renderer> &renderer,
+    const util::Reference<RenderGraph> &graph, const uint32_t downscale)
+    : _renderer(renderer)
+    , _graph(graph)
+    , _downscale(std::max(downscale, 1u))
+    /* The light buffer is a VK2D texture, so it has the swapchain's
+     * format. */
+    , _format(static_cast<vk::Format>(
+	  vk2dRendererGetPointer()->surfaceFormat.format))
+{
+	const auto &ctx = _renderer->context();
+	const auto limit = ctx.physical_device.getProperties()
+			       .limits.maxImageArrayLayers;
+	_max_mask_layers = std::max(limit / MASK_COUNT, 1u) * MASK_COUNT;
+	/* What the graph derives once both passes are in it; rebuilt if it
+	 * ends up deriving something else. */
+	using Access = RenderGraph::Access;
+	const RenderGraph::Transition steady = {
+		.from = RenderGraph::usage(Access::Sampled),
+		.to = RenderGraph::usage(Access::ColorWrite),
+		.next = RenderGraph::usage(Access::Sampled),
+	};
+	_mask_transition = steady;
+	_light_transition = steady;
+	try {
+		_mask_pass = _graph->create_render_pass(MASK_COUNT,
+		    MASK_FORMAT, _mask_transition);
+		_light_pass = _graph->create_render_pass(1, _format,
+		    _light_transition);
+		_shadow_shader = Shader::builtin(_renderer,
+		    { "light_shadows.vert", "light_shadows.frag" });
+		_light_shader = Shader::builtin(_renderer,
+		    { "lights.vert", "lights.frag" });
+		create_frames();
+		add_pipelines();
+	} catch (...) {
+		destroy();
+		throw;
+	}
+	/* Drawn outside VK2D and the graph's aliasing, so they're owned here
+	 * and imported. */
+	_light_buffer = _graph->import_image("lightmap",
+	    { .format = _format, .downscale = _downscale }, Access::Sampled);
+	_mask_image = _graph->import_image("light_masks",
+	    { .format = MASK_FORMAT, .downscale = _downscale },
+	    Access::Sampled);
+}
+
+euler::vulkan::Lighting::~Lighting()
+{
+	set_enabled(false);
+	/* The targets and buffers may still be in use by frames in
+	 * flight. */
+	_renderer->context().device.waitIdle();
+	/* The builders point at the shaders and render passes. */
+	_renderer->pipeline_cache()->wait();
+	destroy();
+}
+
+void
+euler::vulkan::Lighting::destroy()
+{
+	const auto device = _renderer->context().device;
+	destroy_targets();
+	device.destroyRenderPass(_mask_pass);
+	device.destroyRenderPass(_light_pass);
+	device.destroySampler(_sampler);
+	for (const auto &frame : _frames) device.destroyFence(frame.fence);
+	_frames.clear();
+	/* Frees the sets and command buffers with them. */
+	device.destroyDescriptorPool(_descriptor_pool);
+	device.destroyCommandPool(_command_pool);
+}
+
+void
+euler::vulkan::Lighting::sync_render_passes()
+{
+	const auto masks = _graph->transition(_shadow_pass, _mask_image);
+	const auto light = _graph->transition(_lights_pass, _light_buffer);
+	if (masks == _mask_transition && light == _light_transition) return;
+	const auto device = _renderer->context().device;
+	/* Only this object's submissions use the passes. The framebuffers
+	 * and pipelines stay valid, as the new passes are compatible. */
+	std::vector<vk::Fence> fences;
+	for (const auto &frame : _frames) fences.push_back(frame.fence);
+	if (device.waitForFences(fences, VK_TRUE, UINT64_MAX)
+	    != vk::Result::eSuccess)
+		throw std::runtime_error("Lighting frames timed out");
+	if (masks != _mask_transition) {
+		device.destroyRenderPass(_mask_pass);
+		_mask_pass = nullptr;
+		_mask_pass = _graph->create_render_pass(MASK_COUNT,
+		    MASK_FORMAT, masks);
+		_mask_transition = masks;
+	}
+	if (light != _light_transition) {
+		device.destroyRenderPass(_light_pass);
+		_light_pass = nullptr;
+		_light_pass = _graph->create_render_pass(1, _format, light);
+		_light_transition = light;
+	}
+}
+
+void
+euler::vulkan::Lighting::add_pipelines()
+{
+	/* Raw pointers, as the shaders hold the renderer that owns the
+	 * cache. The destructor waits for the builds, and the passes
+	 * outlive them as the first draw waits for the pipelines before
+	 * any pass is rebuilt. */
+	const auto cache = _renderer->pipeline_cache();
+	const auto shadows = _shadow_shader.get();
+	cache->add_pipeline("light_shadows",
+	    { shadows->code(0), shadows->code(1) },
+	    [shadows, pass = _mask_pass](const vk::PipelineCache handle) {
+		    return shadows->create_pipeline(
+			Shader::GraphicsState {
+			    .render_pass = pass,
+			    .blend = Shader::Blend::Max,
+			    .color_attachments = MASK_COUNT,
+			    .samples = 1,
+			},
+			handle);
+	    });
+	const auto lights = _light_shader.get();
+	cache->add_pipeline("lights", { lights->code(0), lights->code(1) },
+	    [lights, pass = _light_pass](const vk::PipelineCache handle) {
+		    return lights->create_pipeline(
+			Shader::GraphicsState {
+			    .render_pass = pass,
+			    .blend = Shader::Blend::Add,
+			    .samples = 1,
+			},
+			handle);
+	    });
+}
+
+void
+euler::vulkan::Lighting::create_frames()
+{
+	const auto &ctx = _renderer->context();
+	const auto count = ctx.frames_in_flight;
+	_command_pool = ctx.device.createCommandPool(vk::CommandPoolCreateInfo {
+	    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+	    .queueFamilyIndex = ctx.graphics_family,
+	});
+	const std::array sizes = {
+		vk::DescriptorPoolSize {
+		    .type = vk::DescriptorType::eStorageBuffer,
+		    .descriptorCount = 3 * count,
+		},
+		vk::DescriptorPoolSize {
+		    .type = vk::DescriptorType::eCombinedImageSampler,
+		    .descriptorCount = count,
+		},
+	};
+	_descriptor_pool
+	    = ctx.device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+		.maxSets = 2 * count,
+		.poolSizeCount = static_cast<uint32_t>(sizes.size()),
+		.pPoolSizes = sizes.data(),
+	    });
+	_sampler = ctx.device.createSampler(vk::SamplerCreateInfo {
+	    .magFilter = vk::Filter::eNearest,
+	    .minFilter = vk::Filter::eNearest,
+	    .mipmapMode = vk::SamplerMipmapMode::eNearest,
+	    .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+	    .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+	    .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+	    .maxLod = 0,
+	});
+	const auto commands
+	    = ctx.device.allocateCommandBuffers(vk::CommandBufferAllocateInfo {
+		.commandPool = _command_pool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = count,
+	    });
+	const auto allocate = [&](const util::Reference<Shader> &shader) {
+		const auto layout = shader->set_layouts()[0];
+		return ctx.device.allocateDescriptorSets(
+		    vk::DescriptorSetAllocateInfo {
+			.descriptorPool = _descriptor_pool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout,
+		    })[0];
+	};
+	for (uint32_t i = 0; i < count; ++i) {
+		auto &frame = _frames.emplace_back();
+		frame.commands = commands[i];
+		frame.fence = ctx.device.createFence(vk::FenceCreateInfo {
+		    .flags = vk::FenceCreateFlagBits::eSignaled,
+		});
+		frame.shadow_set = allocate(_shadow_shader);
+		frame.light_set = allocate(_light_shader);
+		reserve(frame.lights, LIGHTS_PER_PASS * sizeof(GpuLight));
+		reserve(frame.edges, sizeof(glm::vec4));
+		write_descriptors(frame);
+	}
+}
+
+bool
+euler::vulkan::Lighting::reserve(util::Reference<Buffer> &buffer,
+    const vk::DeviceSize size) const
+{
+	if (buffer != nullptr && buffer->size() >= size) return false;
+	const auto capacity
+	    = std::max(size, buffer != nullptr ? buffer->size() * 2 : 0);
+	buffer = util::make_reference<Buffer>(_renderer, capacity,
+	    vk::BufferUsageFlagBits::eStorageBuffer,
+	    vk::MemoryPropertyFlagBits::eHostVisible
+		| vk::MemoryPropertyFlagBits::eHostCoherent);
+	return true;
+}
+
+void
+euler::vulkan::Lighting::write_descriptors(Frame &frame) const
+{
+	const vk::DescriptorBufferInfo lights = {
+		.buffer = frame.lights->buffer(),
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	const vk::DescriptorBufferInfo edges = {
+		.buffer = frame.edges->buffer(),
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	const vk::DescriptorImageInfo masks = {
+		.sampler = _sampler,
+		.imageView = _masks.view,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+	};
+	const auto buffer = [](const vk::DescriptorSet set,
+				const uint32_t binding,
+				const vk::DescriptorBufferInfo &info) {
+		return vk::WriteDescriptorSet {
+			.dstSet = set,
+			.dstBinding = binding,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = vk::DescriptorType::eStorageBuffer,
+			.pBufferInfo = &info,
+		};
+	};
+	std::vector writes = {
+		buffer(frame.shadow_set, 0, lights),
+		buffer(frame.shadow_set, 1, edges),
+		buffer(frame.light_set, 0, lights),
+	};
+	/* The masks are created with the light buffer. */
+	if (_masks.view) {
+		writes.push_back(vk::WriteDescriptorSet {
+		    .dstSet = frame.light_set,
+		    .dstBinding = 2,
+		    .dstArrayElement = 0,
+		    .descriptorCount = 1,
+		    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+		    .pImageInfo = &masks,
+		});
+	}
+	_renderer->context().device.updateDescriptorSets(writes, nullptr);
+}
+
+uint32_t
+euler::vulkan::Lighting::mask_layers(const size_t casters) const
+{
+	const auto layers = (casters + 3) / 4;
+	const auto passes = std::max<size_t>((layers + MASK_COUNT - 1)
+		/ MASK_COUNT,
+	    1);
+	return static_cast<uint32_t>(
+	    std::min<size_t>(passes * MASK_COUNT, _max_mask_layers));
+}
+
+void
+euler::vulkan::Lighting::update()
+{
+	if (!_enabled) return;
+	const auto desc = _graph->resolve({ .downscale = _downscale });
+	const auto casters = std::ranges::count_if(_lights,
+	    [](const std::optional<Light> &light) {
+		    return light.has_value() && light->enabled
+			&& light->casts_shadows;
+	    });
+	/* Masks only grow, so a flickering caster doesn't reallocate. */
+	const auto layers = std::max(mask_layers(casters), _masks.count);
+	if (_target != nullptr && _target->width() == desc.width
+	    && _target->height() == desc.height && _masks.count == layers)
+		return;
+	_renderer->context().device.waitIdle();
+	destroy_targets();
+	create_targets(desc, layers);
+}
+
+void
+euler::vulkan::Lighting::create_targets(const RenderGraph::ImageDesc &desc,
+    const uint32_t layers)
+{
+	const auto &ctx = _renderer->context();
+	_target = util::make_reference<OffscreenTarget>(_renderer, desc.width,
+	    desc.height);
+	_masks.count = layers;
+	_masks.image = ctx.device.createImage(vk::ImageCreateInfo {
+	    .imageType = vk::ImageType::e2D,
+	    .format = MASK_FORMAT,
+	    .extent = { desc.width, desc.height, 1 },
+	    .mipLevels = 1,
+	    .arrayLayers = layers,
+	    .samples = vk::SampleCountFlagBits::e1,
+	    .tiling = vk::ImageTiling::eOptimal,
+	    .usage = vk::ImageUsageFlagBits::eColorAttachment
+		| vk::ImageUsageFlagBits::eSampled,
+	    .sharingMode = vk::SharingMode::eExclusive,
+	    .initialLayout = vk::ImageLayout::eUndefined,
+	});
+	const auto requirements
+	    = ctx.device.getImageMemoryRequirements(_masks.image);
+	_masks.memory = ctx.device.allocateMemory(vk::MemoryAllocateInfo {
+	    .allocationSize = requirements.size,
+	    .memoryTypeIndex = Buffer::find_memory_type(ctx.physical_device,
+		requirements.memoryTypeBits,
+		vk::MemoryPropertyFlagBits::eDeviceLocal),
+	});
+	ctx.device.bindImageMemory(_masks.image, _masks.memory, 0);
+	_masks.view = ctx.device.createImageView(vk::ImageViewCreateInfo {
+	    .image = _masks.image,
+	    .viewType = vk::ImageViewType::e2DArray,
+	    .format = MASK_FORMAT,
+	    .subresourceRange = color_range(0, layers),
+	});
+	for (uint32_t i = 0; i < layers; ++i) {
+		_masks.layers.push_back(
+		    ctx.device.createImageView(vk::ImageViewCreateInfo {
+			.image = _masks.image,
+			.viewType = vk::ImageViewType::e2D,
+			.format = MASK_FORMAT,
+			.subresourceRange = color_range(i, 1),
+		    }));
+	}
+	for (uint32_t i = 0; i < layers; i += MASK_COUNT) {
+		_masks.framebuffers.push_back(
+		    ctx.device.createFramebuffer(vk::FramebufferCreateInfo {
+			.renderPass = _mask_pass,
+			.attachmentCount = MASK_COUNT,
+			.pAttachments = &_masks.layers[i],
+			.width = desc.width,
+			.height = desc.height,
+			.layers = 1,
+		    }));
+	}
+	const auto view = _target->view();
+	_light_framebuffer
+	    = ctx.device.createFramebuffer(vk::FramebufferCreateInfo {
+		.renderPass = _light_pass,
+		.attachmentCount = 1,
+		.pAttachments = &view,
+		.width = desc.width,
+		.height = desc.height,
+		.layers = 1,
+	    });
+
+	/* Layers beyond the frame's casters are sampled without being
+	 * drawn, so they start out cleared and in the layout the light
+	 * pass reads. */
+	const auto commands
+	    = ctx.device.allocateCommandBuffers(vk::CommandBufferAllocateInfo {
+		.commandPool = _command_pool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1,
+	    })[0];
+	commands.begin(vk::CommandBufferBeginInfo {
+	    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+	});
+	const auto barrier = [&](const vk::ImageLayout from,
+				 const vk::ImageLayout to,
+				 const vk::AccessFlags src,
+				 const vk::AccessFlags dst,
+				 const vk::PipelineStageFlags src_stages,
+				 const vk::PipelineStageFlags dst_stages) {
+		commands.pipelineBarrier(src_stages, dst_stages, {}, nullptr,
+		    nullptr,
+		    vk::ImageMemoryBarrier {
+			.srcAccessMask = src,
+			.dstAccessMask = dst,
+			.oldLayout = from,
+			.newLayout = to,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = _masks.image,
+			.subresourceRange = color_range(0, layers),
+		    });
+	};
+	barrier(vk::ImageLayout::eUndefined,
+	    vk::ImageLayout::eTransferDstOptimal, {},
+	    vk::AccessFlagBits::eTransferWrite,
+	    vk::PipelineStageFlagBits::eTopOfPipe,
+	    vk::PipelineStageFlagBits::eTransfer);
+	commands.clearColorImage(_masks.image,
+	    vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue {},
+	    color_range(0, layers));
+	barrier(vk::ImageLayout::eTransferDstOptimal,
+	    vk::ImageLayout::eShaderReadOnlyOptimal,
+	    vk::AccessFlagBits::eTransferWrite,
+	    vk::AccessFlagBits::eShaderRead,
+	    vk::PipelineStageFlagBits::eTransfer,
+	    vk::PipelineStageFlagBits::eFragmentShader);
+	commands.end();
+	ctx.graphics_queue.submit(vk::SubmitInfo {
+	    .commandBufferCount = 1,
+	    .pCommandBuffers = &commands,
+	});
+	ctx.graphics_queue.waitIdle();
+	ctx.device.freeCommandBuffers(_command_pool, commands);
+	for (auto &frame : _frames) write_descriptors(frame);
+}
+
+void
+euler::vulkan::Lighting::destroy_targets()
+{
+	const auto device = _renderer->context().device;
+	device.destroyFramebuffer(_light_framebuffer);
+	_light_framebuffer = nullptr;
+	for (const auto framebuffer : _masks.framebuffers)
+		device.destroyFramebuffer(framebuffer);
+	for (const auto view : _masks.layers) device.destroyImageView(view);
+	device.destroyImageView(_masks.view);
+	device.destroyImage(_masks.image);
+	device.freeMemory(_masks.memory);
+	_masks = {};
+	_target = nullptr;
+}
+
+void
+euler::vulkan::Lighting::set_enabled(const bool enabled)
+{
+	if (enabled == _enabled) return;
+	_enabled = enabled;
+	if (!enabled) {
+		_graph->remove_pass("light_shadows");
+		_graph->remove_pass("lights");
+		_graph->remove_pass("light_composite");
+		return;
+	}
+	using Access = RenderGraph::Access;
+	_shadow_pass = _graph->add_pass("light_shadows", "scene")
+			   .write(_mask_image, Access::ColorWrite)
+			   .execute([this] { draw_shadows(); })
+			   .id();
+	_lights_pass = _graph->add_pass("lights", "scene")
+			   .read(_mask_image)
+			   .write(_light_buffer, Access::ColorWrite)
+			   .execute([this] { draw_lights(); })
+			   .id();
+	_graph->add_pass("light_composite", "gui")
+	    .read(_light_buffer)
+	    .write(RenderGraph::BACKBUFFER, Access::ColorBlend)
+	    .execute([this] { composite(); });
+}
+
+euler::vulkan::Lighting::LayerId
+euler::vulkan::Lighting::create_layer()
+{
+	_layers.push_back(Layer {
+	    .edges = {},
+	    .version = ++_version,
+	    .offset = _edge_capacity,
+	    .capacity = 0,
+	});
+	return static_cast<LayerId>(_layers.size() - 1);
+}
+
+void
+euler::vulkan::Lighting::relayout()
+{
+	size_t offset = 0;
+	for (auto &layer : _layers) {
+		if (layer.edges.size() > layer.capacity) {
+			layer.capacity = std::max(
+			    std::bit_ceil(layer.edges.size()), MIN_LAYER_EDGES);
+		}
+		layer.offset = offset;
+		offset += layer.capacity;
+	}
+	_edge_capacity = offset;
+	++_layout;
+}
+
+void
+euler::vulkan::Lighting::add_edge(const LayerId layer, const glm::vec2 a,
+    const glm::vec2 b)
+{
+	auto &l = _layers.at(layer);
+	l.edges.emplace_back(a.x, a.y, b.x, b.y);
+	l.version = ++_version;
+	if (l.edges.size() > l.capacity) relayout();
+}
+
+void
+euler::vulkan::Lighting::add_polygon(const LayerId layer,
+    const std::span<const glm::vec2> points)
+{
+	if (points.size() < 2) return;
+	for (size_t i = 0; i < points.size(); ++i)
+		add_edge(layer, points[i], points[(i + 1) % points.size()]);
+}
+
+void
+euler::vulkan::Lighting::add_box(const LayerId layer, const glm::vec4 &box)
+{
+	const glm::vec2 points[] = {
+		{ box.x, box.y },
+		{ box.x + box.z, box.y },
+		{ box.x + box.z, box.y + box.w },
+		{ box.x, box.y + box.w },
+	};
+	add_polygon(layer, points);
+}
+
+void
+euler::vulkan::Lighting::clear_layer(const LayerId layer)
+{
+	/* Keeps its range for the edges that replace these. */
+	auto &l = _layers.at(layer);
+	l.edges.clear();
+	l.version = ++_version;
+}
+
+euler::vulkan::Lighting::LightId
+euler::vulkan::Lighting::add_light(const Light &light)
+{
+	if (!_free_lights.empty()) {
+		const auto id = _free_lights.back();
+		_free_lights.pop_back();
+		_lights[id] = light;
+		return id;
+	}
+	_lights.emplace_back(light);
+	return static_cast<LightId>(_lights.size() - 1);
+}
+
+void
+euler::vulkan::Lighting::remove_light(const LightId light)
+{
+	if (light >= _lights.size() || !_lights[light].has_value()) return;
+	_lights[light].reset();
+	_free_lights.push_back(light);
+}
+
+euler::vulkan::Camera::Spec
+euler::vulkan::Lighting::view() const
+{
+	if (_view.has_value()) return *_view;
+	return Camera::vk2d_spec();
+}
+
+void
+euler::vulkan::Lighting::upload_edges(Frame &frame)
+{
+	if (frame.layout != _layout) {
+		const auto size
+		    = std::max<size_t>(_edge_capacity, 1) * sizeof(glm::vec4);
+		if (reserve(frame.edges, size)) write_descriptors(frame);
+		/* Every layer may have moved. */
+		frame.layers.assign(_layers.size(), 0);
+		frame.layout = _layout;
+	}
+	frame.layers.resize(_layers.size(), 0);
+	const auto base
+	    = reinterpret_cast<glm::vec4 *>(frame.edges->mapped().data());
+	for (size_t i = 0; i < _layers.size(); ++i) {
+		const auto &layer = _layers[i];
+		if (frame.layers[i] == layer.version) continue;
+		std::ranges::copy(layer.edges, base + layer.offset);
+		frame.layers[i] = layer.version;
+	}
+}
+
+void
+euler::vulkan::Lighting::upload_lights(Frame &frame, const glm::vec2 &origin,
+    const glm::vec2 &extent)
+{
+	const auto visible = [&](const std::optional<Light> &light) {
+		if (!light.has_value() || !light->enabled) return false;
+		const auto r = light->radius;
+		return light->position.x + r >= origin.x
+		    && light->position.x - r <= origin.x + extent.x
+		    && light->position.y + r >= origin.y
+		    && light->position.y - r <= origin.y + extent.y;
+	};
+	const auto gpu = [](const Light &light, const uint32_t flags) {
+		return GpuLight {
+			.position = light.position,
+			.radius = light.radius,
+			.flags = flags,
+			.colour = light.colour,
+		};
+	};
+	_drawn_lights = std::ranges::count_if(_lights, visible);
+	if (reserve(frame.lights,
+		std::max<size_t>(_drawn_lights, 1) * sizeof(GpuLight)))
+		write_descriptors(frame);
+	/* Casters first, so that a caster's index is its mask channel.
+	 * Any beyond the masks' channels are drawn unshadowed. */
+	const auto channels = _masks.count * 4;
+	auto out = reinterpret_cast<GpuLight *>(frame.lights->mapped().data());
+	uint32_t casters = 0;
+	for (const auto &light : _lights) {
+		if (casters == channels) break;
+		if (!visible(light) || !light->casts_shadows) continue;
+		*out++ = gpu(*light, CASTS_SHADOWS);
+		++casters;
+	}
+	uint32_t skipped = 0;
+	for (const auto &light : _lights) {
+		if (!visible(light)) continue;
+		if (light->casts_shadows && skipped < casters) {
+			++skipped;
+			continue;
+		}
+		*out++ = gpu(*light, 0);
+	}
+	_drawn_casters = casters;
+}
+
+void
+euler::vulkan::Lighting::bind(const Frame &frame, const vk::Pipeline pipeline,
+    const util::Reference<Shader> &shader, const vk::DescriptorSet set,
+    const glm::vec2 &origin, const float scale) const
+{
+	const auto width = _target->width();
+	const auto height = _target->height();
+	const Push push = {
+		.origin = origin,
+		.extent = { static_cast<float>(width),
+		    static_cast<float>(height) },
+		.scale = scale,
+	};
+	const auto layout = shader->pipeline_layout();
+	frame.commands.bindPipeline(vk::PipelineBindPoint::eGraphics,
+	    pipeline);
+	frame.commands.setViewport(0,
+	    vk::Viewport {
+		.x = 0,
+		.y = 0,
+		.width = static_cast<float>(width),
+		.height = static_cast<float>(height),
+		.minDepth = 0,
+		.maxDepth = 1,
+	    });
+	frame.commands.setScissor(0,
+	    vk::Rect2D { .offset = { 0, 0 }, .extent = { width, height } });
+	frame.commands.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+	    layout, 0, set, nullptr);
+	frame.commands.pushConstants(layout, vk::ShaderStageFlagBits::eVertex,
+	    0, sizeof(push), &push);
+}
+
+void
+euler::vulkan::Lighting::draw_shadows()
+{
+	/* Enabled mid-frame; update() allocates the targets before the
+	 * next one. */
+	if (_target == nullptr) return;
+	const auto &ctx = _renderer->context();
+	auto &frame = _frames[_frame];
+	_frame = (_frame + 1) % static_cast<uint32_t>(_frames.size());
+	if (ctx.device.waitForFences(frame.fence, VK_TRUE, UINT64_MAX)
+	    != vk::Result::eSuccess)
+		throw std::runtime_error("Lighting frame timed out");
+	if (!_shadow_pipeline || !_light_pipeline) {
+		const auto cache = _renderer->pipeline_cache();
+		_shadow_pipeline = cache->pipeline("light_shadows");
+		_light_pipeline = cache->pipeline("lights");
+		if (!_shadow_pipeline || !_light_pipeline)
+			throw std::runtime_error("No lighting pipelines");
+	}
+	sync_render_passes();
+
+	/* Lights are drawn in the light buffer's pixels, which are the view
+	 * scaled down by the downscale factor. Camera rotation is not
+	 * applied. */
+	const auto spec = view();
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const auto scale = zoom / static_cast<float>(_downscale);
+	const glm::vec2 origin = { spec.x, spec.y };
+	upload_edges(frame);
+	upload_lights(frame, origin, { spec.w / zoom, spec.h / zoom });
+
+	frame.commands.reset();
+	frame.commands.begin(vk::CommandBufferBeginInfo {
+	    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+	});
+	const vk::Rect2D area = { .offset = { 0, 0 },
+		.extent = { _target->width(), _target->height() } };
+	const std::array<vk::ClearValue, MASK_COUNT> clear = {};
+	for (uint32_t first = 0; first < _drawn_casters;
+	    first += LIGHTS_PER_PASS) {
+		const auto count
+		    = std::min(LIGHTS_PER_PASS, _drawn_casters - first);
+		frame.commands.beginRenderPass(
+		    vk::RenderPassBeginInfo {
+			.renderPass = _mask_pass,
+			.framebuffer
+			= _masks.framebuffers[first / LIGHTS_PER_PASS],
+			.renderArea = area,
+			.clearValueCount = MASK_COUNT,
+			.pClearValues = clear.data(),
+		    },
+		    vk::SubpassContents::eInline);
+		bind(frame, _shadow_pipeline, _shadow_shader, frame.shadow_set,
+		    origin, scale);
+		for (const auto &layer : _layers) {
+			if (layer.edges.empty()) continue;
+			const auto edges
+			    = static_cast<uint32_t>(layer.edges.size());
+			const auto offset = static_cast<uint32_t>(layer.offset);
+			frame.commands.draw(edges * 6, count, offset * 6,
+			    first);
+		}
+		frame.commands.endRenderPass();
+	}
+	_recording = &frame;
+}
+
+void
+euler::vulkan::Lighting::draw_lights()
+{
+	if (_recording == nullptr) return;
+	auto &frame = *_recording;
+	_recording = nullptr;
+	const auto spec = view();
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const vk::ClearValue ambient = {
+		.color = { .float32 = std::array { _ambient.r, _ambient.g,
+			       _ambient.b, _ambient.a } },
+	};
+	/* Always drawn, so that the light buffer is at least cleared to the
+	 * ambient colour. */
+	frame.commands.beginRenderPass(
+	    vk::RenderPassBeginInfo {
+		.renderPass = _light_pass,
+		.framebuffer = _light_framebuffer,
+		.renderArea = { .offset = { 0, 0 },
+		    .extent = { _target->width(), _target->height() } },
+		.clearValueCount = 1,
+		.pClearValues = &ambient,
+	    },
+	    vk::SubpassContents::eInline);
+	if (_drawn_lights > 0) {
+		bind(frame, _light_pipeline, _light_shader, frame.light_set,
+		    { spec.x, spec.y }, zoom / static_cast<float>(_downscale));
+		frame.commands.draw(6, static_cast<uint32_t>(_drawn_lights), 0,
+		    0);
+	}
+	frame.commands.endRenderPass();
+	frame.commands.end();
+	const auto &ctx = _renderer->context();
+	ctx.device.resetFences(frame.fence);
+	/* Submitted ahead of VK2D's frame, so on the queue it comes before
+	 * the composite that samples it. */
+	ctx.graphics_queue.submit(vk::SubmitInfo {
+				      .commandBufferCount = 1,
+				      .pCommandBuffers = &frame.commands,
+				  },
+	    frame.fence);
+}
+
+void
+euler::vulkan::Lighting::composite()
+{
+	if (_target == nullptr) return;
+	const auto spec = view();
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const auto scale = static_cast<float>(_downscale) / zoom;
+	vk2dRendererSetBlendMode(VK2D_BLEND_MODE_MUL);
+	set_colour(WHITE);
+	draw_texture(_target->texture(), spec.x, spec.y, scale, scale);
+	vk2dRendererSetBlendMode(VK2D_BLEND_MODE_BLEND);
+}
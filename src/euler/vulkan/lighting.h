@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_LIGHTING_H
+#define EULER_VULKAN_LIGHTING_H
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/buffer.h"
+#include "euler/vulkan/camera.h"
+#include "euler/vulkan/offscreen_target.h"
+#include "euler/vulkan/render_graph.h"
+#include "euler/vulkan/shader.h"
+
+namespace euler::vulkan {
+
+/*
+ * 2D lights with hard shadows, drawn into a low-resolution light buffer
+ * that is multiplied over the scene.
+ *
+ * Occluders are line segments grouped into layers. Every layer owns a range
+ * of the edge buffers and a version, and only layers whose version changed
+ * are rewritten, so a static level is uploaded once per frame in flight and
+ * a moving occluder only rewrites its own layer.
+ *
+ * Lights outside the view are skipped and the rest go into a storage
+ * buffer, shadow casters first. Each caster owns one channel of one layer of
+ * an array of shadow masks. A "light_shadows" pass extrudes every edge once
+ * per caster into the masks, one instanced draw per layer of edges for
+ * every LIGHTS_PER_PASS casters. A "lights" pass then adds every light into
+ * the light buffer, which starts out as the ambient colour, in one instanced
+ * draw, each attenuated by its channel of the masks. Both are recorded
+ * outside VK2D, with render passes built from the render graph's barriers.
+ */
+class Lighting final : public util::Object {
+public:
+	using LightId = uint32_t;
+	using LayerId = uint32_t;
+
+	static constexpr uint32_t DEFAULT_DOWNSCALE = 4;
+	/* Mask layers drawn at once; four colour attachments are all Vulkan
+	 * guarantees. */
+	static constexpr uint32_t MASK_COUNT = 4;
+	/* RGBA8 masks hold four casters per layer. */
+	static constexpr uint32_t LIGHTS_PER_PASS = MASK_COUNT * 4;
+
+	struct Light {
+		/* World space */
+		glm::vec2 position = { 0, 0 };
+		float radius = 128;
+		glm::vec4 colour = { 1, 1, 1, 1 };
+		bool casts_shadows = true;
+		bool enabled = true;
+	};
+
+	/* Lighting starts disabled; enabling it adds "light_shadows" and
+	 * "lights" passes before "scene" and a "light_composite" pass before
+	 * "gui" to graph. Its pipelines are registered with the renderer's
+	 * pipeline cache, so it must be created before the cache is
+	 * prewarmed. */
+	Lighting(const util::Reference<Renderer> &renderer,
+	    const util::Reference<RenderGraph> &graph,
+	    uint32_t downscale = DEFAULT_DOWNSCALE);
+	~Lighting() override;
+
+	void set_enabled(bool enabled);
+
+	[[nodiscard]] bool
+	enabled() const
+	{
+		return _enabled;
+	}
+
+	/* Matches the light buffer to the backbuffer and the masks to the
+	 * number of shadow casters. Waits for the GPU when they change, so
+	 * it must be called between frames, after the graph's backbuffer is
+	 * set. */
+	void update();
+
+	LayerId create_layer();
+	void add_edge(LayerId layer, glm::vec2 a, glm::vec2 b);
+	/* A closed outline. */
+	void add_polygon(LayerId layer, std::span<const glm::vec2> points);
+	/* x, y, w, h */
+	void add_box(LayerId layer, const glm::vec4 &box);
+	void clear_layer(LayerId layer);
+
+	LightId add_light(const Light &light);
+	void remove_light(LightId light);
+
+	[[nodiscard]] Light &
+	light(const LightId id)
+	{
+		return _lights.at(id).value();
+	}
+
+	void
+	set_ambient(const glm::vec4 &colour)
+	{
+		_ambient = colour;
+	}
+
+	[[nodiscard]] const glm::vec4 &
+	ambient() const
+	{
+		return _ambient;
+	}
+
+	/* The view lights are drawn for. Defaults to VK2D's current
+	 * camera. */
+	void
+	set_view(const std::optional<Camera::Spec> &view)
+	{
+		_view = view;
+	}
+
+	/* Lights drawn in the last frame, after culling. */
+	[[nodiscard]] size_t
+	drawn_lights() const
+	{
+		return _drawn_lights;
+	}
+
+private:
+	struct Layer {
+		/* a.xy, b.xy in world space */
+		std::vector<glm::vec4> edges;
+		/* Bumped whenever edges changes. */
+		uint64_t version = 0;
+		/* The layer's range of the edge buffers, in edges. */
+		size_t offset = 0;
+		size_t capacity = 0;
+	};
+
+	/* One per frame in flight, reused once its fence signals. */
+	struct Frame {
+		vk::CommandBuffer commands;
+		vk::Fence fence;
+		util::Reference<Buffer> lights;
+		util::Reference<Buffer> edges;
+		vk::DescriptorSet shadow_set;
+		vk::DescriptorSet light_set;
+		/* The _layout edges is arranged for, and the version of every
+		 * layer it holds. */
+		uint64_t layout = 0;
+		std::vector<uint64_t> layers;
+	};
+
+	/* Four casters per layer, drawn MASK_COUNT layers at a time. */
+	struct Masks {
+		vk::Image image;
+		vk::DeviceMemory memory;
+		/* Every layer, for sampling. */
+		vk::ImageView view;
+		std::vector<vk::ImageView> layers;
+		/* One per MASK_COUNT layers. */
+		std::vector<vk::Framebuffer> framebuffers;
+		uint32_t count = 0;
+	};
+
+	[[nodiscard]] Camera::Spec view() const;
+	/* Rebuilds the render passes if the graph's barriers changed. */
+	void sync_render_passes();
+	void add_pipelines();
+	void create_frames();
+	[[nodiscard]] uint32_t mask_layers(size_t casters) const;
+	void create_targets(const RenderGraph::ImageDesc &desc,
+	    uint32_t layers);
+	void destroy_targets();
+	void destroy();
+	void write_descriptors(Frame &frame) const;
+	/* Grows buffer to hold size bytes; returns whether it changed. */
+	bool reserve(util::Reference<Buffer> &buffer,
+	    vk::DeviceSize size) const;
+	/* Gives every layer room for its edges, moving them if needed. */
+	void relayout();
+	void upload_edges(Frame &frame);
+	void upload_lights(Frame &frame, const glm::vec2 &origin,
+	    const glm::vec2 &extent);
+	void bind(const Frame &frame, vk::Pipeline pipeline,
+	    const util::Reference<Shader> &shader, vk::DescriptorSet set,
+	    const glm::vec2 &origin, float scale) const;
+	void draw_shadows();
+	void draw_lights();
+	void composite();
+
+	util::Reference<Renderer> _renderer;
+	util::Reference<RenderGraph> _graph;
+	uint32_t _downscale;
+	vk::Format _format;
+	RenderGraph::ImageId _light_buffer;
+	RenderGraph::ImageId _mask_image;
+	RenderGraph::PassId _shadow_pass = 0;
+	RenderGraph::PassId _lights_pass = 0;
+	util::Reference<OffscreenTarget> _target;
+	Masks _masks;
+	/* Multiple of MASK_COUNT within the device's limit. */
+	uint32_t _max_mask_layers = 0;
+	vk::Framebuffer _light_framebuffer;
+	/* Masks are cleared, and the light buffer is cleared to the ambient
+	 * colour. */
+	vk::RenderPass _mask_pass;
+	vk::RenderPass _light_pass;
+	RenderGraph::Transition _mask_transition;
+	RenderGraph::Transition _light_transition;
+	util::Reference<Shader> _shadow_shader;
+	util::Reference<Shader> _light_shader;
+	/* Owned by the pipeline cache; fetched on the first draw. */
+	vk::Pipeline _shadow_pipeline;
+	vk::Pipeline _light_pipeline;
+	vk::Sampler _sampler;
+	vk::CommandPool _command_pool;
+	vk::DescriptorPool _descriptor_pool;
+	std::vector<Frame> _frames;
+	uint32_t _frame = 0;
+	/* Recorded by the "light_shadows" pass, submitted by "lights". */
+	Frame *_recording = nullptr;
+	std::vector<Layer> _layers;
+	/* Bumped whenever a layer changes or moves. */
+	uint64_t _version = 0;
+	uint64_t _layout = 1;
+	/* Edges the layers have room for. */
+	size_t _edge_capacity = 0;
+	std::vector<std::optional<Light>> _lights;
+	std::vector<LightId> _free_lights;
+	glm::vec4 _ambient = { 0.1f, 0.1f, 0.15f, 1.0f };
+	bool _enabled = false;
+	std::optional<Camera::Spec> _view;
+	size_t _drawn_lights = 0;
+	/* Casters with a mask channel in the last frame. */
+	uint32_t _drawn_casters = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_LIGHTING_H */
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/offscreen_target.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <VK2D/VK2D.h>
+
+static constexpr vk::ImageSubresourceRange COLOR_RANGE = {
+	.aspectMask = vk::ImageAspectFlagBits::eColor,
+	.baseMipLevel = 0,
+	.levelCount = 1,
+	.baseArrayLayer = 0,
+	.layerCount = 1,
+};
+
+/* VK2D transitions render targets back to this layout when the target is
+ * switched away from. */
+static constexpr auto TARGET_LAYOUT = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+static bool
+is_bgra(const vk::Format format)
+{
+	switch (format) {
+	case vk::Format::eB8G8R8A8Unorm: [[fallthrough]];
+	case vk::Format::eB8G8R8A8Srgb: return true;
+	case vk::Format::eR8G8B8A8Unorm: [[fallthrough]];
+	case vk::Format::eR8G8B8A8Srgb: return false;
+	default:
+		throw std::runtime_error(
+		    "Unsupported offscreen target format "
+		    + vk::to_string(format));
+	}
+}
+
+euler::vulkan::OffscreenTarget::OffscreenTarget(
+    const util::Reference<Renderer> &renderer, const uint32_t width,
+    const uint32_t height)
+    : _renderer(renderer)
+    , _width(width)
+    , _height(height)
+{
+	_texture = vk2dTextureCreate(static_cast<float>(width),
+	    static_cast<float>(height));
+	if (_texture == nullptr)
+		throw std::runtime_error("Failed to create offscreen target");
+	/* Render targets share the swapchain's format. */
+	_format = static_cast<vk::Format>(
+	    vk2dRendererGetPointer()->surfaceFormat.format);
+	(void)is_bgra(_format);
+}
+
+euler::vulkan::OffscreenTarget::~OffscreenTarget()
+{
+	const auto device = _renderer->context().device;
+	/* VK2D may still be drawing into the texture. */
+	device.waitIdle();
+	vk2dTextureFree(_texture);
+	if (_pool) {
+		device.destroyFence(_fence);
+		device.destroyCommandPool(_pool);
+	}
+}
+
+void
+euler::vulkan::OffscreenTarget::begin()
+{
+	vk2dRendererSetTarget(_texture);
+}
+
+void
+euler::vulkan::OffscreenTarget::end()
+{
+	vk2dRendererSetTarget(VK2D_TARGET_SCREEN);
+}
+
+vk::ImageView
+euler::vulkan::OffscreenTarget::view() const
+{
+	return vk::ImageView(_texture->img->view);
+}
+
+std::vector<uint8_t>
+euler::vulkan::OffscreenTarget::read_pixels()
+{
+	const auto &ctx = _renderer->context();
+	const auto size = static_cast<vk::DeviceSize>(_width) * _height * 4;
+	if (_readback == nullptr) {
+		_readback = util::make_reference<Buffer>(_renderer, size,
+		    vk::BufferUsageFlagBits::eTransferDst,
+		    vk::MemoryPropertyFlagBits::eHostVisible
+			| vk::MemoryPropertyFlagBits::eHostCoherent);
+		_pool = ctx.device.createCommandPool(vk::CommandPoolCreateInfo {
+		    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+		    .queueFamilyIndex = ctx.graphics_family,
+		});
+		_commands = ctx.device
+				.allocateCommandBuffers(
+				    vk::CommandBufferAllocateInfo {
+					.commandPool = _pool,
+					.level = vk::CommandBufferLevel::ePrimary,
+					.commandBufferCount = 1,
+				    })
+				.front();
+		_fence = ctx.device.createFence({});
+	}
+	const auto image = vk::Image(_texture->img->img);
+	_commands.reset();
+	_commands.begin(vk::CommandBufferBeginInfo {
+	    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+	});
+	/* Submitted on the same queue after the frame, so the barrier orders
+	 * the copy after the frame's colour writes. */
+	_commands.pipelineBarrier(
+	    vk::PipelineStageFlagBits::eColorAttachmentOutput
+		| vk::PipelineStageFlagBits::eFragmentShader,
+	    vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+	    vk::ImageMemoryBarrier {
+		.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+		.dstAccessMask = vk::AccessFlagBits::eTransferRead,
+		.oldLayout = TARGET_LAYOUT,
+		.newLayout = vk::ImageLayout::eTransferSrcOptimal,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = COLOR_RANGE,
+	    });
+	_commands.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal,
+	    _readback->buffer(),
+	    vk::BufferImageCopy {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+		    .aspectMask = vk::ImageAspectFlagBits::eColor,
+		    .mipLevel = 0,
+		    .baseArrayLayer = 0,
+		    .layerCount = 1,
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { _width, _height, 1 },
+	    });
+	_commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+	    vk::PipelineStageFlagBits::eFragmentShader
+		| vk::PipelineStageFlagBits::eHost,
+	    {}, nullptr,
+	    vk::BufferMemoryBarrier {
+		.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+		.dstAccessMask = vk::AccessFlagBits::eHostRead,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = _readback->buffer(),
+		.offset = 0,
+		.size = size,
+	    },
+	    vk::ImageMemoryBarrier {
+		.srcAccessMask = vk::AccessFlagBits::eTransferRead,
+		.dstAccessMask = vk::AccessFlagBits::eShaderRead,
+		.oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+		.newLayout = TARGET_LAYOUT,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = COLOR_RANGE,
+	    });
+	_commands.end();
+	ctx.device.resetFences(_fence);
+	ctx.graphics_queue.submit(vk::SubmitInfo {
+				      .commandBufferCount = 1,
+				      .pCommandBuffers = &_commands,
+				  },
+	    _fence);
+	if (ctx.device.waitForFences(_fence, VK_TRUE, UINT64_MAX)
+	    != vk::Result::eSuccess)
+		throw std::runtime_error("Offscreen readback timed out");
+
+	std::vector<uint8_t> pixels(size);
+	std::memcpy(pixels.data(), _readback->mapped().data(), size);
+	if (is_bgra(_format)) {
+		for (size_t i = 0; i < pixels.size(); i += 4)
+			std::swap(pixels[i], pixels[i + 2]);
+	}
+	return pixels;
+}
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_OFFSCREEN_TARGET_H
+#define EULER_VULKAN_OFFSCREEN_TARGET_H
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/buffer.h"
+#include "euler/vulkan/renderer.h"
+
+struct VK2DTexture_t;
+
+namespace euler::vulkan {
+
+/*
+ * A VK2D render target that frames can be drawn into instead of the
+ * swapchain, and read back from. Used for headless rendering, where nothing
+ * is ever shown, and for frame captures.
+ */
+class OffscreenTarget final : public util::Object {
+public:
+	OffscreenTarget(const util::Reference<Renderer> &renderer,
+	    uint32_t width, uint32_t height);
+	~OffscreenTarget() override;
+
+	/* Redirects drawing to the target. Only valid inside a frame. */
+	void begin();
+	/* Restores the swapchain as the target. */
+	void end();
+
+	/* Waits for the last frame drawn into the target and returns its
+	 * pixels as tightly packed RGBA8. Stalls the GPU, so only call it
+	 * for frames that are captured. */
+	std::vector<uint8_t> read_pixels();
+
+	/* The VK2D texture, for drawing the target's contents. */
+	[[nodiscard]] VK2DTexture_t *
+	texture() const
+	{
+		return _texture;
+	}
+
+	/* The view of the texture's image, for passes recorded outside
+	 * VK2D. They must leave it in eShaderReadOnlyOptimal. */
+	[[nodiscard]] vk::ImageView view() const;
+
+	/* Always the swapchain's format. */
+	[[nodiscard]] vk::Format
+	format() const
+	{
+		return _format;
+	}
+
+	[[nodiscard]] uint32_t
+	width() const
+	{
+		return _width;
+	}
+
+	[[nodiscard]] uint32_t
+	height() const
+	{
+		return _height;
+	}
+
+private:
+	util::Reference<Renderer> _renderer;
+	VK2DTexture_t *_texture = nullptr;
+	uint32_t _width;
+	uint32_t _height;
+	vk::Format _format;
+	/* Created on the first read_pixels(). */
+	util::Reference<Buffer> _readback;
+	vk::CommandPool _pool;
+	vk::CommandBuffer _commands;
+	vk::Fence _fence;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_OFFSCREEN_TARGET_H */
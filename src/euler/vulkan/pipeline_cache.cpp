@@ -0,0 +1,198 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/pipeline_cache.h"
+
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include "euler/util/asset_cache.h"
+
+/* VkPipelineCacheHeaderVersionOne: header size, header version, vendor ID,
+ * device ID and the cache UUID. */
+static constexpr size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+static uint32_t
+read_u32(const std::span<const uint8_t> data, const size_t offset)
+{
+	uint32_t value;
+	std::memcpy(&value, data.data() + offset, sizeof(value));
+	return value;
+}
+
+euler::vulkan::PipelineCache::PipelineCache(
+    const vk::PhysicalDevice physical_device, const vk::Device device,
+    const util::Reference<util::Logger> &log,
+    const util::Reference<util::Storage> &storage)
+    : _device(device)
+    , _log(log)
+    , _storage(storage)
+    , _properties(physical_device.getProperties())
+    , _shader_hash(util::AssetCache::hash({}))
+{
+}
+
+euler::vulkan::PipelineCache::~PipelineCache()
+{
+	if (_thread.joinable()) _thread.join();
+	if (!_cache) return;
+	save();
+	for (const auto &[_, entry] : _entries)
+		if (entry.pipeline) _device.destroyPipeline(entry.pipeline);
+	_device.destroyPipelineCache(_cache);
+}
+
+void
+euler::vulkan::PipelineCache::add_pipeline(std::string name,
+    const std::initializer_list<std::span<const uint8_t>> shaders,
+    Builder build)
+{
+	if (_cache)
+		throw std::runtime_error(
+		    "Pipelines must be added before prewarm");
+	/* Order-dependent, so registering the same shaders in another order
+	 * also invalidates the cache. That's harmless. */
+	for (const auto &code : shaders)
+		_shader_hash = _shader_hash * 31
+		    + util::AssetCache::hash(code);
+	std::lock_guard lock(_mutex);
+	if (!_entries.emplace(name, Entry { .build = std::move(build) })
+		 .second)
+		throw std::runtime_error("Duplicate pipeline '" + name + "'");
+	_order.push_back(std::move(name));
+}
+
+void
+euler::vulkan::PipelineCache::prewarm()
+{
+	if (_cache) return;
+	std::string uuid;
+	for (const auto byte : _properties.pipelineCacheUUID)
+		uuid += std::format("{:02x}", byte);
+	_path = std::format("{}/{}-{:016x}.bin", DIRECTORY, uuid,
+	    _shader_hash);
+	const auto data = load();
+	_cache = _device.createPipelineCache(vk::PipelineCacheCreateInfo {
+	    .initialDataSize = data.size(),
+	    .pInitialData = data.empty() ? nullptr : data.data(),
+	});
+	_log->debug("Pipeline cache loaded {} bytes, {} pipelines to build",
+	    data.size(), _order.size());
+	if (_order.empty()) return;
+	_thread = std::thread([this] { build_all(); });
+}
+
+void
+euler::vulkan::PipelineCache::wait()
+{
+	if (_thread.joinable()) _thread.join();
+}
+
+vk::Pipeline
+euler::vulkan::PipelineCache::pipeline(const std::string &name)
+{
+	std::unique_lock lock(_mutex);
+	const auto it = _entries.find(name);
+	if (it == _entries.end())
+		throw std::runtime_error("No pipeline named '" + name + "'");
+	if (!_cache)
+		throw std::runtime_error(
+		    "Pipeline cache has not been prewarmed");
+	_built.wait(lock, [&] { return it->second.done; });
+	return it->second.pipeline;
+}
+
+void
+euler::vulkan::PipelineCache::save()
+{
+	if (_storage == nullptr || !_cache) return;
+	const auto data = _device.getPipelineCacheData(_cache);
+	try {
+		remove_stale();
+		_storage->write_file_async(_path,
+		    std::string(reinterpret_cast<const char *>(data.data()),
+			data.size()));
+	} catch (const std::exception &e) {
+		_log->warn("Failed to save pipeline cache: {}", e.what());
+	}
+}
+
+std::vector<uint8_t>
+euler::vulkan::PipelineCache::load() const
+{
+	if (_storage == nullptr || !_storage->exists(_path)) return {};
+	try {
+		const auto content = _storage->read_file(_path);
+		std::vector<uint8_t> data(content.begin(), content.end());
+		if (compatible(data)) return data;
+		_log->warn("Ignoring incompatible pipeline cache {}", _path);
+	} catch (const std::exception &e) {
+		_log->warn("Failed to load pipeline cache: {}", e.what());
+	}
+	return {};
+}
+
+bool
+euler::vulkan::PipelineCache::compatible(
+    const std::span<const uint8_t> data) const
+{
+	/* Drivers are supposed to reject foreign data themselves, but not
+	 * all of them do so gracefully. */
+	if (data.size() < HEADER_SIZE) return false;
+	if (read_u32(data, 0) < HEADER_SIZE) return false;
+	if (read_u32(data, 4)
+	    != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne))
+		return false;
+	if (read_u32(data, 8) != _properties.vendorID) return false;
+	if (read_u32(data, 12) != _properties.deviceID) return false;
+	return std::memcmp(data.data() + 16,
+		   _properties.pipelineCacheUUID.data(), VK_UUID_SIZE)
+	    == 0;
+}
+
+void
+euler::vulkan::PipelineCache::remove_stale() const
+{
+	if (!_storage->exists(DIRECTORY)) {
+		_storage->create_directory(DIRECTORY);
+		return;
+	}
+	std::vector<std::string> stale;
+	_storage->enumerate_directory(DIRECTORY,
+	    [&](const std::string_view directory,
+		const std::string_view file) {
+		    auto path = std::string(directory) + std::string(file);
+		    if (path != _path) stale.push_back(std::move(path));
+		    return true;
+	    });
+	for (const auto &path : stale) {
+		_log->debug("Removing stale pipeline cache {}", path);
+		_storage->remove_path(path);
+	}
+}
+
+void
+euler::vulkan::PipelineCache::build_all()
+{
+	/* Registration is closed once the cache exists, so the order and
+	 * builders no longer change. */
+	for (const auto &name : _order) {
+		auto &entry = _entries.at(name);
+		vk::Pipeline pipeline;
+		try {
+			pipeline = entry.build(_cache);
+		} catch (const std::exception &e) {
+			_log->error("Failed to build pipeline '{}': {}",
+			    name, e.what());
+		}
+		{
+			std::lock_guard lock(_mutex);
+			entry.pipeline = pipeline;
+			entry.done = true;
+			entry.build = nullptr;
+		}
+		_built.notify_all();
+	}
+	/* Everything the game is known to need is in the cache now. */
+	save();
+}
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_PIPELINE_CACHE_H
+#define EULER_VULKAN_PIPELINE_CACHE_H
+
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/logger.h"
+#include "euler/util/object.h"
+#include "euler/util/storage.h"
+
+namespace euler::vulkan {
+
+/*
+ * Keeps compiled pipelines across runs. The driver's pipeline cache is
+ * stored in user storage under a name made from the driver's cache UUID and
+ * a hash of the SPIR-V of every known pipeline, so a driver update or a
+ * shader change starts from an empty cache instead of feeding the driver
+ * stale data. Caches under any other name are deleted when saving.
+ *
+ * Known pipelines are registered before prewarm(), which loads the cache
+ * and compiles them all on a background thread while the game starts up.
+ * pipeline() hands them out, waiting only if that one isn't built yet.
+ */
+class PipelineCache final : public util::Object {
+public:
+	using Builder = std::function<vk::Pipeline(vk::PipelineCache)>;
+
+	static constexpr const char *DIRECTORY = "pipeline-cache";
+
+	/* Without storage, nothing is loaded or saved. Owned by the
+	 * renderer, so it holds the device rather than a reference back. */
+	PipelineCache(vk::PhysicalDevice physical_device, vk::Device device,
+	    const util::Reference<util::Logger> &log,
+	    const util::Reference<util::Storage> &storage);
+	~PipelineCache() override;
+
+	/* Registers a pipeline built from shaders, which are hashed into
+	 * the cache key. Only before prewarm(). build runs once, on the
+	 * background thread, and is released afterwards; anything it
+	 * points to must outlive wait(). */
+	void add_pipeline(std::string name,
+	    std::initializer_list<std::span<const uint8_t>> shaders,
+	    Builder build);
+
+	/* Loads the saved cache and starts building every registered
+	 * pipeline in the background. */
+	void prewarm();
+
+	/* Blocks until the background builds are done. */
+	void wait();
+
+	/* A registered pipeline, or null if building it failed. */
+	[[nodiscard]] vk::Pipeline pipeline(const std::string &name);
+
+	/* For pipelines created outside the registry. Null before
+	 * prewarm(). */
+	[[nodiscard]] vk::PipelineCache
+	handle() const
+	{
+		return _cache;
+	}
+
+	/* Writes the cache to storage, atomically and in the
+	 * background. */
+	void save();
+
+	/* The storage path for the current driver and shaders. */
+	[[nodiscard]] const std::string &
+	path() const
+	{
+		return _path;
+	}
+
+private:
+	struct Entry {
+		Builder build;
+		vk::Pipeline pipeline;
+		bool done = false;
+	};
+
+	[[nodiscard]] std::vector<uint8_t> load() const;
+	[[nodiscard]] bool compatible(std::span<const uint8_t> data) const;
+	void remove_stale() const;
+	void build_all();
+
+	vk::Device _device;
+	util::Reference<util::Logger> _log;
+	util::Reference<util::Storage> _storage;
+	vk::PhysicalDeviceProperties _properties;
+	uint64_t _shader_hash;
+	std::string _path;
+	vk::PipelineCache _cache;
+	std::thread _thread;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _built;
+	std::vector<std::string> _order;
+	std::unordered_map<std::string, Entry> _entries;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_PIPELINE_CACHE_H */
@@ -0,0 +1,553 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/render_graph.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <limits>
+#include <ranges>
+#include <stdexcept>
+
+#include <VK2D/VK2D.h>
+
+using RenderGraph = euler::vulkan::RenderGraph;
+
+static bool
+is_write(const RenderGraph::Access access)
+{
+	switch (access) {
+	case RenderGraph::Access::ColorWrite: [[fallthrough]];
+	case RenderGraph::Access::ColorBlend: [[fallthrough]];
+	case RenderGraph::Access::StorageWrite: return true;
+	default: return false;
+	}
+}
+
+/* The format of every VK2D render target. */
+static vk::Format
+target_format()
+{
+	return static_cast<vk::Format>(
+	    vk2dRendererGetPointer()->surfaceFormat.format);
+}
+
+static bool
+is_color(const RenderGraph::Access access)
+{
+	return access == RenderGraph::Access::ColorWrite
+	    || access == RenderGraph::Access::ColorBlend;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::read(const ImageId image, const Access access)
+{
+	if (is_write(access))
+		throw std::runtime_error("Render graph read with a write access");
+	_graph._passes.at(_pass).reads.push_back({ image, access });
+	_graph._dirty = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::write(const ImageId image, const Access access)
+{
+	if (!is_write(access))
+		throw std::runtime_error("Render graph write with a read access");
+	_graph._passes.at(_pass).writes.push_back({ image, access });
+	_graph._dirty = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::side_effects()
+{
+	_graph._passes.at(_pass).side_effects = true;
+	_graph._dirty = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder &
+RenderGraph::PassBuilder::execute(std::function<void()> fn)
+{
+	_graph._passes.at(_pass).fn = std::move(fn);
+	return *this;
+}
+
+euler::vulkan::RenderGraph::RenderGraph(
+    const util::Reference<Renderer> &renderer)
+    : _renderer(renderer)
+{
+	_images.push_back(Image {
+	    .name = "backbuffer",
+	    .desc = {},
+	    .imported = true,
+	    .final_access = Access::Present,
+	});
+}
+
+RenderGraph::Usage
+euler::vulkan::RenderGraph::usage(const Access access)
+{
+	using Stage = vk::PipelineStageFlagBits;
+	using Flag = vk::AccessFlagBits;
+	using Layout = vk::ImageLayout;
+	switch (access) {
+	case Access::Sampled:
+		return { Stage::eFragmentShader | Stage::eComputeShader,
+			Flag::eShaderRead, Layout::eShaderReadOnlyOptimal };
+	case Access::ColorWrite:
+		return { Stage::eColorAttachmentOutput,
+			Flag::eColorAttachmentWrite,
+			Layout::eColorAttachmentOptimal };
+	case Access::ColorBlend:
+		return { Stage::eColorAttachmentOutput,
+			Flag::eColorAttachmentRead | Flag::eColorAttachmentWrite,
+			Layout::eColorAttachmentOptimal };
+	case Access::StorageRead:
+		return { Stage::eFragmentShader | Stage::eComputeShader,
+			Flag::eShaderRead, Layout::eGeneral };
+	case Access::StorageWrite:
+		return { Stage::eComputeShader, Flag::eShaderWrite,
+			Layout::eGeneral };
+	case Access::Present:
+		return { Stage::eBottomOfPipe, {}, Layout::ePresentSrcKHR };
+	default: throw std::runtime_error("Unknown render graph access");
+	}
+}
+
+void
+euler::vulkan::RenderGraph::set_backbuffer(const ImageDesc &desc,
+    const util::Reference<OffscreenTarget> &target)
+{
+	_backbuffer_target = target;
+	if (desc == _backbuffer) return;
+	_backbuffer = desc;
+	_images[BACKBUFFER].desc = desc;
+	/* Backbuffer-sized images change size with it. */
+	_dirty = true;
+}
+
+RenderGraph::ImageId
+euler::vulkan::RenderGraph::create_image(std::string name,
+    const ImageDesc &desc)
+{
+	if (desc.format != vk::Format::eUndefined
+	    && desc.format != target_format()) {
+		throw std::runtime_error(std::format(
+		    "Render graph image '{}' can't be {}; transient images "
+		    "have the swapchain's format",
+		    name, vk::to_string(desc.format)));
+	}
+	_images.push_back(Image {
+	    .name = std::move(name),
+	    .desc = desc,
+	    .imported = false,
+	    .final_access = Access::Sampled,
+	});
+	_dirty = true;
+	return static_cast<ImageId>(_images.size() - 1);
+}
+
+RenderGraph::ImageId
+euler::vulkan::RenderGraph::import_image(std::string name,
+    const ImageDesc &desc, const Access final_access)
+{
+	_images.push_back(Image {
+	    .name = std::move(name),
+	    .desc = desc,
+	    .imported = true,
+	    .final_access = final_access,
+	});
+	_dirty = true;
+	return static_cast<ImageId>(_images.size() - 1);
+}
+
+RenderGraph::PassBuilder
+euler::vulkan::RenderGraph::add_pass(std::string name,
+    const std::string_view before)
+{
+	const auto id = static_cast<PassId>(_passes.size());
+	_passes.push_back(Pass { .name = std::move(name) });
+	const auto it = std::ranges::find_if(_order, [&](const PassId p) {
+		return !_passes[p].removed && _passes[p].name == before;
+	});
+	if (!before.empty() && it == _order.end()) {
+		throw std::runtime_error(
+		    "No render pass named '" + std::string(before) + "'");
+	}
+	_order.insert(it, id);
+	_dirty = true;
+	return { *this, id };
+}
+
+void
+euler::vulkan::RenderGraph::remove_pass(const std::string_view name)
+{
+	/* Ids stay stable; the pass is just never scheduled again. */
+	for (auto &pass : _passes) {
+		if (pass.name != name || pass.removed) continue;
+		pass.removed = true;
+		pass.fn = nullptr;
+		_dirty = true;
+	}
+}
+
+RenderGraph::ImageDesc
+euler::vulkan::RenderGraph::resolve(const ImageDesc &desc) const
+{
+	auto out = desc;
+	const auto scale = std::max(out.downscale, 1u);
+	if (out.width == 0) out.width = std::max(_backbuffer.width / scale, 1u);
+	if (out.height == 0)
+		out.height = std::max(_backbuffer.height / scale, 1u);
+	if (out.format == vk::Format::eUndefined) out.format = target_format();
+	return out;
+}
+
+std::optional<RenderGraph::ImageId>
+euler::vulkan::RenderGraph::color_target(const Pass &pass) const
+{
+	for (const auto &use : pass.writes)
+		if (is_color(use.access)) return use.image;
+	return std::nullopt;
+}
+
+void
+euler::vulkan::RenderGraph::cull()
+{
+	/* Walk backwards from the imported images, keeping every pass that
+	 * contributes to one. */
+	std::vector<bool> needed(_images.size(), false);
+	for (size_t i = 0; i < _images.size(); ++i)
+		needed[i] = _images[i].imported;
+	for (const auto id : std::views::reverse(_order)) {
+		auto &pass = _passes[id];
+		pass.live = !pass.removed
+		    && (pass.side_effects
+			|| std::ranges::any_of(pass.writes, [&](const Use &w) {
+				   return needed[w.image];
+			   }));
+		if (!pass.live) continue;
+		for (const auto &use : pass.reads) needed[use.image] = true;
+		/* Blending reads what was there before. */
+		for (const auto &use : pass.writes)
+			if (use.access == Access::ColorBlend)
+				needed[use.image] = true;
+	}
+}
+
+void
+euler::vulkan::RenderGraph::build_groups()
+{
+	_groups.clear();
+	/* Images written by the group being built. */
+	std::vector<bool> written(_images.size(), false);
+	for (const auto id : _order) {
+		auto &pass = _passes[id];
+		if (!pass.live) continue;
+		const auto target = color_target(pass);
+		auto merge = !_groups.empty() && target.has_value()
+		    && _groups.back().target == target;
+		/* Sampling something drawn earlier in the same render pass
+		 * needs the pass to end first. */
+		for (const auto &use : pass.reads)
+			if (written[use.image]) merge = false;
+		if (!merge) {
+			_groups.push_back(Group { .passes = {}, .target = target });
+			std::fill(written.begin(), written.end(), false);
+		}
+		_groups.back().passes.push_back(id);
+		pass.group = _groups.size() - 1;
+		for (const auto &use : pass.writes) written[use.image] = true;
+	}
+}
+
+void
+euler::vulkan::RenderGraph::derive_barriers()
+{
+	/* Imported images arrive as they were left last frame; transient
+	 * ones hold nothing worth keeping. */
+	std::vector<Usage> last(_images.size());
+	std::vector<bool> last_wrote(_images.size(), false);
+	for (size_t i = 0; i < _images.size(); ++i) {
+		if (_images[i].imported) {
+			last[i] = usage(_images[i].final_access);
+		} else {
+			last[i] = Usage { vk::PipelineStageFlagBits::eTopOfPipe,
+				{}, vk::ImageLayout::eUndefined };
+		}
+	}
+	for (auto &group : _groups) {
+		group.barriers.clear();
+		auto add = [&](const Use &use) {
+			const auto to = usage(use.access);
+			const auto writes = is_write(use.access);
+			/* Read after read in the same layout needs nothing. */
+			if (!writes && !last_wrote[use.image]
+			    && last[use.image].layout == to.layout)
+				return;
+			const auto it = std::ranges::find_if(group.barriers,
+			    [&](const Barrier &b) { return b.image == use.image; });
+			/* Merged passes share their group's barrier. */
+			if (it != group.barriers.end()) {
+				it->to.stages |= to.stages;
+				it->to.access |= to.access;
+			} else {
+				group.barriers.push_back(
+				    Barrier { use.image, last[use.image], to });
+			}
+			last[use.image] = to;
+			last_wrote[use.image] = writes;
+		};
+		for (const auto id : group.passes) {
+			for (const auto &use : _passes[id].reads) add(use);
+			for (const auto &use : _passes[id].writes) add(use);
+		}
+	}
+}
+
+void
+euler::vulkan::RenderGraph::alias()
+{
+	/* First and last group touching each transient image. */
+	static constexpr auto NONE = std::numeric_limits<size_t>::max();
+	std::vector<std::pair<size_t, size_t>> lifetime(_images.size(),
+	    { NONE, 0 });
+	for (size_t g = 0; g < _groups.size(); ++g) {
+		for (const auto id : _groups[g].passes) {
+			const auto &pass = _passes[id];
+			for (const auto *uses : { &pass.reads, &pass.writes }) {
+				for (const auto &use : *uses) {
+					auto &[first, end] = lifetime[use.image];
+					first = std::min(first, g);
+					end = std::max(end, g);
+				}
+			}
+		}
+	}
+	std::vector<ImageId> order;
+	for (ImageId i = 0; i < _images.size(); ++i)
+		if (!_images[i].imported && lifetime[i].first != NONE)
+			order.push_back(i);
+	std::ranges::sort(order, {},
+	    [&](const ImageId i) { return lifetime[i].first; });
+
+	/* Greedy interval colouring: reuse the first target of the same
+	 * size and format that is free by the time the image is needed. */
+	auto previous = std::move(_physical);
+	_physical.clear();
+	std::vector<size_t> busy_until;
+	for (const auto i : order) {
+		auto &image = _images[i];
+		const auto desc = resolve(image.desc);
+		size_t slot = 0;
+		for (; slot < _physical.size(); ++slot) {
+			if (_physical[slot].desc == desc
+			    && busy_until[slot] < lifetime[i].first)
+				break;
+		}
+		if (slot == _physical.size()) {
+			_physical.push_back(Physical { desc, nullptr });
+			busy_until.push_back(0);
+		}
+		busy_until[slot] = lifetime[i].second;
+		image.physical = slot;
+	}
+	/* Keep targets from the last compile where the size still fits. */
+	for (auto &physical : _physical) {
+		const auto it = std::ranges::find_if(previous,
+		    [&](const Physical &p) {
+			    return p.desc == physical.desc && p.target != nullptr;
+		    });
+		if (it != previous.end()) {
+			physical.target = std::move(it->target);
+		} else {
+			physical.target = util::make_reference<OffscreenTarget>(
+			    _renderer, physical.desc.width,
+			    physical.desc.height);
+		}
+	}
+}
+
+void
+euler::vulkan::RenderGraph::compile()
+{
+	for (const auto &pass : _passes) {
+		for (const auto *uses : { &pass.reads, &pass.writes }) {
+			for (const auto &use : *uses) {
+				if (use.image >= _images.size()) {
+					throw std::runtime_error("Render pass '"
+					    + pass.name
+					    + "' uses an unknown image");
+				}
+			}
+		}
+	}
+	cull();
+	build_groups();
+	derive_barriers();
+	alias();
+	_dirty = false;
+	_renderer->log()->debug("Render graph compiled: {} groups, {} "
+				"transient targets\n{}",
+	    _groups.size(), _physical.size(), describe());
+}
+
+void
+euler::vulkan::RenderGraph::execute()
+{
+	if (_dirty) compile();
+	for (const auto &group : _groups) {
+		const auto offscreen = group.target.has_value()
+		    && !_images[*group.target].imported;
+		if (offscreen) target(*group.target)->begin();
+		for (const auto id : group.passes)
+			if (_passes[id].fn) _passes[id].fn();
+		if (!offscreen) continue;
+		/* Back to whatever stands in for the swapchain. */
+		if (_backbuffer_target != nullptr)
+			_backbuffer_target->begin();
+		else
+			target(*group.target)->end();
+	}
+}
+
+const euler::util::Reference<euler::vulkan::OffscreenTarget> &
+euler::vulkan::RenderGraph::target(const ImageId image) const
+{
+	const auto &img = _images.at(image);
+	if (img.imported) {
+		throw std::runtime_error(
+		    "Imported image '" + img.name + "' has no graph target");
+	}
+	if (_dirty || img.physical >= _physical.size()) {
+		throw std::runtime_error(
+		    "Render graph image '" + img.name + "' is not allocated");
+	}
+	return _physical[img.physical].target;
+}
+
+std::span<const RenderGraph::Barrier>
+euler::vulkan::RenderGraph::barriers(const PassId pass) const
+{
+	const auto &p = _passes.at(pass);
+	if (!p.live || _dirty) return {};
+	const auto &group = _groups[p.group];
+	if (group.passes.front() != pass) return {};
+	return group.barriers;
+}
+
+std::optional<RenderGraph::Barrier>
+euler::vulkan::RenderGraph::barrier(const PassId pass,
+    const ImageId image) const
+{
+	for (const auto &b : barriers(pass))
+		if (b.image == image) return b;
+	return std::nullopt;
+}
+
+RenderGraph::Usage
+euler::vulkan::RenderGraph::next_usage(const PassId pass,
+    const ImageId image) const
+{
+	const auto &p = _passes.at(pass);
+	const auto &img = _images.at(image);
+	if (p.live && !_dirty) {
+		for (auto g = p.group + 1; g < _groups.size(); ++g)
+			for (const auto &b : _groups[g].barriers)
+				if (b.image == image) return b.to;
+	}
+	if (img.imported) return usage(img.final_access);
+	return Usage { vk::PipelineStageFlagBits::eBottomOfPipe, {},
+		vk::ImageLayout::eUndefined };
+}
+
+RenderGraph::Transition
+euler::vulkan::RenderGraph::transition(const PassId pass,
+    const ImageId image) const
+{
+	Transition out;
+	out.to = usage(Access::ColorWrite);
+	out.from = out.to;
+	if (const auto found = barrier(pass, image); found.has_value()) {
+		out.from = found->from;
+		out.to = found->to;
+	}
+	out.next = next_usage(pass, image);
+	return out;
+}
+
+vk::RenderPass
+euler::vulkan::RenderGraph::create_render_pass(const uint32_t attachments,
+    const vk::Format format, const Transition &transition) const
+{
+	/* Cleared, so whatever the previous use left behind is discarded,
+	 * and left as the next use wants it. */
+	const std::vector descriptions(attachments,
+	    vk::AttachmentDescription {
+		.format = format,
+		.samples = vk::SampleCountFlagBits::e1,
+		.loadOp = vk::AttachmentLoadOp::eClear,
+		.storeOp = vk::AttachmentStoreOp::eStore,
+		.stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
+		.stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
+		.initialLayout = vk::ImageLayout::eUndefined,
+		.finalLayout = transition.next.layout,
+	    });
+	std::vector<vk::AttachmentReference> references;
+	for (uint32_t i = 0; i < attachments; ++i) {
+		references.push_back(vk::AttachmentReference {
+		    .attachment = i,
+		    .layout = transition.to.layout,
+		});
+	}
+	const vk::SubpassDescription subpass = {
+		.pipelineBindPoint = vk::PipelineBindPoint::eGraphics,
+		.colorAttachmentCount = attachments,
+		.pColorAttachments = references.data(),
+	};
+	const std::array dependencies = {
+		vk::SubpassDependency {
+		    .srcSubpass = VK_SUBPASS_EXTERNAL,
+		    .dstSubpass = 0,
+		    .srcStageMask = transition.from.stages,
+		    .dstStageMask = transition.to.stages,
+		    .srcAccessMask = transition.from.access,
+		    .dstAccessMask = transition.to.access,
+		},
+		vk::SubpassDependency {
+		    .srcSubpass = 0,
+		    .dstSubpass = VK_SUBPASS_EXTERNAL,
+		    .srcStageMask = transition.to.stages,
+		    .dstStageMask = transition.next.stages,
+		    .srcAccessMask = transition.to.access,
+		    .dstAccessMask = transition.next.access,
+		},
+	};
+	return _renderer->context().device.createRenderPass(
+	    vk::RenderPassCreateInfo {
+		.attachmentCount = attachments,
+		.pAttachments = descriptions.data(),
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+		.dependencyCount = static_cast<uint32_t>(dependencies.size()),
+		.pDependencies = dependencies.data(),
+	    });
+}
+
+std::string
+euler::vulkan::RenderGraph::describe() const
+{
+	std::string out;
+	for (size_t g = 0; g < _groups.size(); ++g) {
+		const auto &group = _groups[g];
+		out += std::format("  [{}] {}:", g,
+		    group.target.has_value() ? _images[*group.target].name
+					     : "compute");
+		for (const auto id : group.passes)
+			out += " " + _passes[id].name;
+		out += std::format(" ({} barriers)\n", group.barriers.size());
+	}
+	return out;
+}
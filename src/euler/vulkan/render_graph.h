@@ -0,0 +1,267 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_RENDER_GRAPH_H
+#define EULER_VULKAN_RENDER_GRAPH_H
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/offscreen_target.h"
+#include "euler/vulkan/renderer.h"
+
+namespace euler::vulkan {
+
+/*
+ * Declares how a frame is composed. Passes state which images they read
+ * and write; compile() then
+ *
+ *  - drops passes whose results never reach an imported image,
+ *  - merges neighbouring passes that draw into the same image without
+ *    sampling each other's output, so they share one render pass,
+ *  - derives the barrier each image needs between its uses, and
+ *  - lets transient images whose lifetimes don't overlap share one
+ *    physical render target.
+ *
+ * Images are either imported (the swapchain, or an image owned elsewhere)
+ * or transient, in which case the graph allocates them as VK2D render
+ * targets. Those always have the swapchain's format, so transient images
+ * can't ask for another one. VK2D records the layout transitions for its
+ * own targets when the target changes, so the graph records no barriers
+ * itself. Passes that record Vulkan commands of their own build their
+ * synchronization from the derived ones instead, e.g. as the dependencies
+ * and layouts of their render passes.
+ *
+ * A pass renders into its first colour write. Passes that draw into
+ * further images switch targets themselves and return to that one.
+ *
+ * The graph is declared once and executed every frame. Changing it marks
+ * it for recompilation on the next execute().
+ */
+class RenderGraph final : public util::Object {
+public:
+	using ImageId = uint32_t;
+	using PassId = uint32_t;
+
+	/* The swapchain, always imported. */
+	static constexpr ImageId BACKBUFFER = 0;
+
+	enum class Access {
+		/* Read in a shader. */
+		Sampled,
+		/* Drawn into, discarding what was there. */
+		ColorWrite,
+		/* Drawn into with blending over the existing contents. */
+		ColorBlend,
+		StorageRead,
+		StorageWrite,
+		/* Final access of imported images that are presented. */
+		Present,
+	};
+
+	struct ImageDesc {
+		/* Zero means the size of the backbuffer. */
+		uint32_t width = 0;
+		uint32_t height = 0;
+		/* Undefined means the swapchain's format, the only one
+		 * transient images support. */
+		vk::Format format = vk::Format::eUndefined;
+		/* Divides backbuffer-relative sizes, for low-resolution
+		 * buffers. */
+		uint32_t downscale = 1;
+
+		bool operator==(const ImageDesc &) const = default;
+	};
+
+	/* What an image must be made visible for, as a barrier's source or
+	 * destination. */
+	struct Usage {
+		vk::PipelineStageFlags stages;
+		vk::AccessFlags access;
+		vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+
+		bool operator==(const Usage &) const = default;
+	};
+
+	struct Barrier {
+		ImageId image;
+		Usage from;
+		Usage to;
+	};
+
+	/* The synchronization around a render pass that clears and draws
+	 * into an image: what it waits for, how it draws, and what reads
+	 * the result. */
+	struct Transition {
+		Usage from;
+		Usage to;
+		Usage next;
+
+		bool operator==(const Transition &) const = default;
+	};
+
+	class PassBuilder {
+	public:
+		PassBuilder &read(ImageId image, Access access = Access::Sampled);
+		PassBuilder &write(ImageId image,
+		    Access access = Access::ColorWrite);
+		/* Keeps the pass even if nothing reads what it writes. */
+		PassBuilder &side_effects();
+		PassBuilder &execute(std::function<void()> fn);
+
+		[[nodiscard]] PassId
+		id() const
+		{
+			return _pass;
+		}
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph &graph, PassId pass)
+		    : _graph(graph)
+		    , _pass(pass)
+		{
+		}
+
+		RenderGraph &_graph;
+		PassId _pass;
+	};
+
+	/* A run of merged passes sharing one colour target. */
+	struct Group {
+		std::vector<PassId> passes;
+		/* Nothing if the passes only record compute or copy work. */
+		std::optional<ImageId> target;
+		/* Recorded before the group starts. */
+		std::vector<Barrier> barriers;
+	};
+
+	explicit RenderGraph(const util::Reference<Renderer> &renderer);
+	~RenderGraph() override = default;
+
+	/* Describes the swapchain, or the offscreen target standing in for
+	 * it. Recompiles if the size changed. */
+	void set_backbuffer(const ImageDesc &desc,
+	    const util::Reference<OffscreenTarget> &target = nullptr);
+
+	ImageId create_image(std::string name, const ImageDesc &desc);
+	ImageId import_image(std::string name, const ImageDesc &desc,
+	    Access final_access);
+	/* Passes run in the order they are added, or just before the pass
+	 * named before. */
+	PassBuilder add_pass(std::string name, std::string_view before = {});
+	void remove_pass(std::string_view name);
+
+	void compile();
+	/* Compiles if needed, then runs every live pass in order. */
+	void execute();
+
+	[[nodiscard]] const std::vector<Group> &
+	groups() const
+	{
+		return _groups;
+	}
+
+	/* The physical render target behind a transient image, for passes
+	 * that sample it. Valid once the graph has compiled. */
+	[[nodiscard]] const util::Reference<OffscreenTarget> &target(
+	    ImageId image) const;
+
+	/* Barriers a pass recording its own Vulkan commands needs before
+	 * it. Passes drawing through VK2D can ignore them. Only the first
+	 * pass of a group has any, and only once the graph has compiled. */
+	[[nodiscard]] std::span<const Barrier> barriers(PassId pass) const;
+	/* The one of those for image, if any. */
+	[[nodiscard]] std::optional<Barrier> barrier(PassId pass,
+	    ImageId image) const;
+	/* What image is used for after pass: the destination of its next
+	 * barrier or, for an imported image with none, its final access.
+	 * A pass leaving the image in this state needs no further barrier,
+	 * e.g. as the final layout and outgoing dependency of a render
+	 * pass. */
+	[[nodiscard]] Usage next_usage(PassId pass, ImageId image) const;
+	/* barrier() and next_usage() for a pass that clears image, which
+	 * is then only a colour write if the graph derived no barrier. */
+	[[nodiscard]] Transition transition(PassId pass, ImageId image) const;
+	/* A single-subpass render pass clearing attachments images of
+	 * format and leaving them as transition.next wants them, with
+	 * transition's dependencies on either side. The caller owns it. */
+	[[nodiscard]] vk::RenderPass create_render_pass(uint32_t attachments,
+	    vk::Format format, const Transition &transition) const;
+
+	/* Number of physical targets backing the transient images. */
+	[[nodiscard]] size_t
+	physical_count() const
+	{
+		return _physical.size();
+	}
+
+	/* desc with backbuffer-relative sizes and the format filled in,
+	 * e.g. for sizing an imported image to match. */
+	[[nodiscard]] ImageDesc resolve(const ImageDesc &desc) const;
+
+	/* One line per group, for logging. */
+	[[nodiscard]] std::string describe() const;
+
+	static Usage usage(Access access);
+
+private:
+	struct Image {
+		std::string name;
+		ImageDesc desc;
+		bool imported;
+		Access final_access;
+		/* Index into _physical for transient images. */
+		size_t physical = 0;
+	};
+
+	struct Use {
+		ImageId image;
+		Access access;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<Use> reads;
+		std::vector<Use> writes;
+		std::function<void()> fn;
+		bool side_effects = false;
+		bool removed = false;
+		bool live = false;
+		/* Index into _groups once compiled. */
+		size_t group = 0;
+	};
+
+	struct Physical {
+		ImageDesc desc;
+		util::Reference<OffscreenTarget> target;
+	};
+
+	[[nodiscard]] std::optional<ImageId> color_target(
+	    const Pass &pass) const;
+	void cull();
+	void build_groups();
+	void derive_barriers();
+	void alias();
+
+	util::Reference<Renderer> _renderer;
+	std::vector<Image> _images;
+	std::vector<Pass> _passes;
+	/* Execution order of _passes. */
+	std::vector<PassId> _order;
+	std::vector<Group> _groups;
+	std::vector<Physical> _physical;
+	ImageDesc _backbuffer;
+	util::Reference<OffscreenTarget> _backbuffer_target;
+	bool _dirty = true;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_RENDER_GRAPH_H */
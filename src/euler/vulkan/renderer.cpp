@@ -2,6 +2,9 @@
 
 #include "euler/vulkan/renderer.h"
 
+#include <algorithm>
+#include <bit>
+
 #include <VK2D/Logger.h>
 #include <VK2D/VK2D.h>
 
@@ -40,10 +43,61 @@ from_vk2d(const VK2DLogSeverity severity)
 	}
 }
 
+static VK2DMSAA
+to_vk2d_msaa(const uint32_t samples)
+{
+	if (samples >= 16) return VK2D_MSAA_16X;
+	if (samples >= 8) return VK2D_MSAA_8X;
+	if (samples >= 4) return VK2D_MSAA_4X;
+	if (samples >= 2) return VK2D_MSAA_2X;
+	return VK2D_MSAA_1X;
+}
+
+using PresentMode = util::RendererConfig::PresentMode;
+
+/* VK2D has no relaxed FIFO mode; log_settings() warns about it. */
+static VK2DScreenMode
+to_vk2d(const PresentMode mode)
+{
+	switch (mode) {
+	case PresentMode::Fifo: [[fallthrough]];
+	case PresentMode::FifoRelaxed: return VK2D_SCREEN_MODE_VSYNC;
+	case PresentMode::Mailbox: return VK2D_SCREEN_MODE_TRIPLE_BUFFER;
+	case PresentMode::Immediate: return VK2D_SCREEN_MODE_IMMEDIATE;
+	default: return VK2D_SCREEN_MODE_VSYNC;
+	}
+}
+
+/* FIFO blocks in present and queues frames behind the display, which is
+ * exactly the latency that low-latency mode is meant to remove. */
+static PresentMode
+effective_present_mode(const util::RendererConfig &settings)
+{
+	if (!settings.low_latency) return settings.present_mode;
+	switch (settings.present_mode) {
+	case PresentMode::Fifo: [[fallthrough]];
+	case PresentMode::FifoRelaxed: return PresentMode::Mailbox;
+	default: return settings.present_mode;
+	}
+}
+
+static VK2DRendererConfig
+to_vk2d(const util::RendererConfig &settings)
+{
+	/* Pixel art is drawn with nearest filtering regardless. */
+	return VK2DRendererConfig {
+		.msaa = to_vk2d_msaa(settings.msaa),
+		.screenMode = to_vk2d(effective_present_mode(settings)),
+		.filterMode = VK2D_FILTER_TYPE_NEAREST,
+	};
+}
+
 euler::vulkan::Renderer::~Renderer() { renderer_semaphore.release(); }
 
 void
-euler::vulkan::Renderer::initialize(const util::Reference<Surface> &surface)
+euler::vulkan::Renderer::initialize(const util::Reference<Surface> &surface,
+    const util::RendererConfig &settings,
+    const util::Reference<util::Storage> &storage)
 {
 	_log->info("Initializing Vulkan renderer");
 	if (!renderer_semaphore.try_acquire()) {
@@ -52,13 +106,9 @@ euler::vulkan::Renderer::initialize(const util::Reference<Surface> &surface)
 	}
 	_initialized = true;
 	_surface = surface.weaken();
-	static constexpr VK2DRendererConfig config = {
-		.msaa = VK2D_MSAA_16X,
-		.screenMode = VK2D_SCREEN_MODE_VSYNC,
-		.filterMode = VK2D_FILTER_TYPE_NEAREST,
-	};
-	static constexpr VK2DStartupOptions startup_options = {
-		.enableDebug = true,
+	const auto config = to_vk2d(settings);
+	const VK2DStartupOptions startup_options = {
+		.enableDebug = settings.validation,
 		.stdoutLogging = true,
 		.quitOnError = false,
 		.errorFile = nullptr,
@@ -95,10 +145,96 @@ euler::vulkan::Renderer::initialize(const util::Reference<Surface> &surface)
 
 	/* ReSharper restore CppParameterMayBeConstPtrOrRef */
 	vk2dRendererInit(surface->window(), config, &startup_options);
+	const auto vk2d = vk2dRendererGetPointer();
+	_settings = settings;
+	if (settings.frames_in_flight != VK2D_MAX_FRAMES_IN_FLIGHT) {
+		_log->warn("{} frames in flight requested, but VK2D is built "
+			   "with {}",
+		    settings.frames_in_flight, VK2D_MAX_FRAMES_IN_FLIGHT);
+	}
+	_settings.frames_in_flight = VK2D_MAX_FRAMES_IN_FLIGHT;
+	/* VK2D asks for a single graphics queue, so there is no transfer
+	 * queue to hand out. */
+	_context = Context {
+		.instance = vk2d->vk,
+		.physical_device = vk2d->pd->dev,
+		.device = vk2d->ld->dev,
+		.graphics_queue = vk2d->ld->queue,
+		.graphics_family = vk2d->pd->QueueFamily.graphicsFamily,
+		.transfer_queue = nullptr,
+		.transfer_family = vk2d->pd->QueueFamily.graphicsFamily,
+		.frames_in_flight = VK2D_MAX_FRAMES_IN_FLIGHT,
+	};
+	_pipeline_cache = util::make_reference<PipelineCache>(
+	    _context.physical_device, _context.device, _log, storage);
+	/* VK2D makes the same adjustment internally. */
+	_settings.msaa = supported_msaa(settings.msaa);
+	log_settings();
 	_log->info("Vulkan renderer initialized");
 	surface->set_renderer(util::Reference(this));
 }
 
+uint32_t
+euler::vulkan::Renderer::supported_msaa(const uint32_t samples) const
+{
+	const auto counts = _context.physical_device.getProperties()
+				.limits.framebufferColorSampleCounts;
+	auto supported = std::bit_floor(std::clamp(samples, 1u, 16u));
+	while (supported > 1
+	    && !(counts & static_cast<vk::SampleCountFlagBits>(supported)))
+		supported >>= 1;
+	if (supported != samples) {
+		_log->warn("{}x MSAA requested, using {}x", samples,
+		    supported);
+	}
+	return supported;
+}
+
+void
+euler::vulkan::Renderer::log_settings() const
+{
+	if (effective_present_mode(_settings) == PresentMode::FifoRelaxed)
+		_log->warn("VK2D has no relaxed FIFO mode, using FIFO");
+	_log->info("Renderer settings: {}x MSAA, {} present mode, "
+		   "validation {}, {} frames in flight, low latency {}",
+	    _settings.msaa,
+	    util::RendererConfig::present_mode_name(
+		effective_present_mode(_settings)),
+	    _settings.validation ? "on" : "off", _settings.frames_in_flight,
+	    _settings.low_latency ? "on" : "off");
+}
+
+void
+euler::vulkan::Renderer::set_settings(const util::RendererConfig &settings)
+{
+	if (!_initialized)
+		throw std::runtime_error("Renderer is not initialized");
+	if (settings.validation != _settings.validation) {
+		_log->warn("Validation can only be changed at startup, "
+			   "ignoring");
+	}
+	if (settings.frames_in_flight != _settings.frames_in_flight) {
+		_log->warn("Frames in flight can only be changed at startup, "
+			   "ignoring");
+	}
+	const auto msaa = supported_msaa(settings.msaa);
+	const auto previous = to_vk2d(_settings);
+	_settings.msaa = msaa;
+	_settings.present_mode = settings.present_mode;
+	_settings.low_latency = settings.low_latency;
+	_settings.frame_limit = settings.frame_limit;
+	if (const auto s = surface(); s != nullptr)
+		s->configure_pacer(_settings);
+	const auto config = to_vk2d(_settings);
+	if (config.msaa == previous.msaa
+	    && config.screenMode == previous.screenMode)
+		return;
+	/* Rebuilds the swapchain and render targets before the next
+	 * frame. */
+	vk2dRendererSetConfig(config);
+	log_settings();
+}
+
 nk_context *
 euler::vulkan::Renderer::gui_context()
 {
@@ -114,4 +250,13 @@ util::Reference<euler::vulkan::Surface>
 euler::vulkan::Renderer::surface() const
 {
 	return _surface.strengthen();
-}
\ No newline at end of file
+}
+
+const uint8_t *
+euler_vulkan_renderer_shader_data(euler_vulkan_renderer *, const char *key,
+    size_t *size_out)
+{
+	const auto data = euler::vulkan::Renderer::load_builtin_shader(key);
+	*size_out = data.has_value() ? data->code.size() : 0;
+	return data.has_value() ? data->code.data() : nullptr;
+}
@@ -6,11 +6,19 @@
 #ifndef __cplusplus
 #include <stdint.h>
 #else
+#include <optional>
+#include <span>
+#include <string_view>
 #include <thread>
 
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/config.h"
 #include "euler/util/logger.h"
 #include "euler/util/object.h"
 #include "euler/util/version.h"
+#include "euler/vulkan/pipeline_cache.h"
+#include "euler/vulkan/shader_layout.h"
 
 struct nk_context;
 
@@ -35,17 +43,87 @@ public:
 	}
 	~Renderer() override;
 
-	void initialize(const util::Reference<Surface> &surface);
+	/* Pipeline caches are kept in storage if one is given. */
+	void initialize(const util::Reference<Surface> &surface,
+	    const util::RendererConfig &settings = {},
+	    const util::Reference<util::Storage> &storage = nullptr);
+
+	/* Settings as applied, after clamping to what the device and VK2D
+	 * support. */
+	[[nodiscard]] const util::RendererConfig &
+	settings() const
+	{
+		return _settings;
+	}
+
+	/* Applies MSAA and present mode changes by rebuilding the swapchain.
+	 * VK2D keeps the new configuration, so later rebuilds (on resize, for
+	 * example) use it too. Validation and frames in flight are fixed once
+	 * the device exists; changes to them are logged and ignored. */
+	void set_settings(const util::RendererConfig &settings);
+
+	/* Handles owned by VK2D, for engine code that talks to Vulkan
+	 * directly. Valid once initialize() has returned. */
+	struct Context {
+		vk::Instance instance;
+		vk::PhysicalDevice physical_device;
+		vk::Device device;
+		vk::Queue graphics_queue;
+		uint32_t graphics_family = 0;
+		/* Null if the device was created without a dedicated
+		 * transfer queue. */
+		vk::Queue transfer_queue;
+		uint32_t transfer_family = 0;
+		uint32_t frames_in_flight = 0;
+	};
+
+	[[nodiscard]] const Context &
+	context() const
+	{
+		return _context;
+	}
+
+	[[nodiscard]] const util::Reference<util::Logger> &
+	log() const
+	{
+		return _log;
+	}
+
+	/* Register known pipelines, then prewarm() it once at startup.
+	 * Valid once initialize() has returned. */
+	[[nodiscard]] const util::Reference<PipelineCache> &
+	pipeline_cache() const
+	{
+		return _pipeline_cache;
+	}
+
+	/* A SPIR-V module compiled into the engine from shaders/, with the
+	 * layout reflected from it. */
+	struct ShaderData {
+		std::span<const uint8_t> code;
+		ShaderLayout layout;
+	};
+
+	/* By file name, e.g. "instanced.vert". */
+	static std::optional<ShaderData> load_builtin_shader(
+	    std::string_view key);
 
 	nk_context *gui_context();
 	const nk_context *gui_context() const;
 
 private:
 	util::Reference<Surface> surface() const;
+	/* The largest sample count up to samples that the device can
+	 * render to. */
+	uint32_t supported_msaa(uint32_t samples) const;
+	void log_settings() const;
 
 	util::WeakReference<Surface> _surface;
 	util::Reference<util::Logger> _log;
 	VK2DLogger *_vk2d_logger = nullptr;
+	Context _context;
+	util::Reference<PipelineCache> _pipeline_cache;
+	util::RendererConfig _settings;
 	bool _initialized = false;
 };
 } /* namespace euler::vulkan */
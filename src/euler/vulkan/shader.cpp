@@ -2,3 +2,394 @@
 
 #include "euler/vulkan/shader.h"
 
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+
+euler::vulkan::Shader::Shader(const util::Reference<Renderer> &renderer,
+    const std::span<const Renderer::ShaderData> modules)
+    : _renderer(renderer)
+{
+	if (modules.empty()) throw std::runtime_error("Shader has no modules");
+	const auto device = renderer->context().device;
+	for (const auto &data : modules) {
+		const auto module
+		    = device.createShaderModule(vk::ShaderModuleCreateInfo {
+			.codeSize = data.code.size(),
+			.pCode = reinterpret_cast<const uint32_t *>(
+			    data.code.data()),
+		    });
+		_modules.push_back(Module { module, data.layout, data.code });
+		for (const auto &constant : data.layout.spec_constants) {
+			const auto same = std::ranges::find(_constants,
+			    constant.id, &ShaderLayout::SpecConstant::id);
+			if (same == _constants.end()) {
+				_constants.push_back(constant);
+				_values.push_back(constant.default_value);
+			} else if (same->name != constant.name) {
+				throw std::runtime_error(std::format(
+				    "Specialization constant {} is '{}' in one "
+				    "stage and '{}' in another",
+				    constant.id, same->name, constant.name));
+			}
+		}
+	}
+	merge_bindings();
+	create_layouts();
+}
+
+euler::vulkan::Shader::~Shader()
+{
+	destroy_layouts();
+	const auto device = _renderer->context().device;
+	for (const auto &module : _modules)
+		device.destroyShaderModule(module.module);
+}
+
+euler::util::Reference<euler::vulkan::Shader>
+euler::vulkan::Shader::builtin(const util::Reference<Renderer> &renderer,
+    const std::initializer_list<std::string_view> keys)
+{
+	std::vector<Renderer::ShaderData> modules;
+	for (const auto key : keys) {
+		auto data = Renderer::load_builtin_shader(key);
+		if (!data.has_value()) {
+			throw std::runtime_error(
+			    std::format("No built-in shader '{}'", key));
+		}
+		modules.push_back(*data);
+	}
+	return util::make_reference<Shader>(renderer, modules);
+}
+
+void
+euler::vulkan::Shader::specialize(const std::string_view name,
+    const uint32_t value)
+{
+	const auto it = std::ranges::find(_constants, name,
+	    &ShaderLayout::SpecConstant::name);
+	if (it == _constants.end()) {
+		throw std::runtime_error(
+		    std::format("No specialization constant '{}'", name));
+	}
+	_values[it - _constants.begin()] = value;
+}
+
+void
+euler::vulkan::Shader::use_dynamic_offset(const uint32_t set,
+    const uint32_t binding)
+{
+	const auto it = std::ranges::find_if(_bindings,
+	    [&](const ShaderLayout::Binding &b) {
+		    return b.set == set && b.binding == binding;
+	    });
+	if (it == _bindings.end()) {
+		throw std::runtime_error(std::format(
+		    "No descriptor set {} binding {}", set, binding));
+	}
+	switch (it->type) {
+	case vk::DescriptorType::eUniformBuffer:
+		it->type = vk::DescriptorType::eUniformBufferDynamic;
+		break;
+	case vk::DescriptorType::eStorageBuffer:
+		it->type = vk::DescriptorType::eStorageBufferDynamic;
+		break;
+	case vk::DescriptorType::eUniformBufferDynamic: [[fallthrough]];
+	case vk::DescriptorType::eStorageBufferDynamic: return;
+	default:
+		throw std::runtime_error(std::format(
+		    "Descriptor set {} binding {} ('{}') is not a buffer", set,
+		    binding, it->name));
+	}
+	destroy_layouts();
+	create_layouts();
+}
+
+void
+euler::vulkan::Shader::merge_bindings()
+{
+	for (const auto &module : _modules) {
+		vk::ShaderStageFlags stages;
+		for (const auto &entry : module.layout.entry_points)
+			stages |= entry.stage;
+		for (const auto &binding : module.layout.bindings) {
+			const auto it = std::ranges::find_if(_bindings,
+			    [&](const ShaderLayout::Binding &b) {
+				    return b.set == binding.set
+					&& b.binding == binding.binding;
+			    });
+			if (it == _bindings.end()) {
+				_bindings.push_back(binding);
+				_binding_stages.push_back(stages);
+				continue;
+			}
+			if (it->type != binding.type
+			    || it->count != binding.count) {
+				throw std::runtime_error(std::format(
+				    "Stages disagree on descriptor set {} "
+				    "binding {} ('{}')",
+				    binding.set, binding.binding,
+				    binding.name));
+			}
+			_binding_stages[it - _bindings.begin()] |= stages;
+		}
+	}
+}
+
+void
+euler::vulkan::Shader::create_layouts()
+{
+	const auto device = _renderer->context().device;
+	uint32_t set_count = 0;
+	for (const auto &binding : _bindings)
+		set_count = std::max(set_count, binding.set + 1);
+	for (uint32_t set = 0; set < set_count; ++set) {
+		std::vector<vk::DescriptorSetLayoutBinding> bindings;
+		std::vector<vk::DescriptorBindingFlags> flags;
+		auto bindless = false;
+		for (size_t i = 0; i < _bindings.size(); ++i) {
+			const auto &binding = _bindings[i];
+			if (binding.set != set) continue;
+			const auto unbounded = binding.count == 0;
+			bindless |= unbounded;
+			bindings.push_back(vk::DescriptorSetLayoutBinding {
+			    .binding = binding.binding,
+			    .descriptorType = binding.type,
+			    .descriptorCount = unbounded
+				? MAX_BINDLESS_DESCRIPTORS
+				: binding.count,
+			    .stageFlags = _binding_stages[i],
+			});
+			flags.push_back(unbounded
+				? vk::DescriptorBindingFlagBits::ePartiallyBound
+				    | vk::DescriptorBindingFlagBits::
+					eUpdateAfterBind
+				: vk::DescriptorBindingFlags());
+		}
+		const vk::DescriptorSetLayoutBindingFlagsCreateInfo
+		    binding_flags = {
+			    .bindingCount = static_cast<uint32_t>(flags.size()),
+			    .pBindingFlags = flags.data(),
+		    };
+		_set_layouts.push_back(device.createDescriptorSetLayout(
+		    vk::DescriptorSetLayoutCreateInfo {
+			.pNext = bindless ? &binding_flags : nullptr,
+			.flags = bindless
+				? vk::DescriptorSetLayoutCreateFlagBits::
+				    eUpdateAfterBindPool
+				: vk::DescriptorSetLayoutCreateFlags(),
+			.bindingCount
+			= static_cast<uint32_t>(bindings.size()),
+			.pBindings = bindings.data(),
+		    }));
+	}
+
+	/* One range shared by every stage that declares the block. */
+	vk::PushConstantRange push_constants = {};
+	for (const auto &module : _modules) {
+		if (module.layout.push_constant_size == 0) continue;
+		for (const auto &entry : module.layout.entry_points)
+			push_constants.stageFlags |= entry.stage;
+		push_constants.size = std::max(push_constants.size,
+		    module.layout.push_constant_size);
+	}
+	_pipeline_layout = device.createPipelineLayout(
+	    vk::PipelineLayoutCreateInfo {
+		.setLayoutCount = static_cast<uint32_t>(_set_layouts.size()),
+		.pSetLayouts = _set_layouts.data(),
+		.pushConstantRangeCount = push_constants.size > 0 ? 1u : 0u,
+		.pPushConstantRanges = &push_constants,
+	    });
+}
+
+void
+euler::vulkan::Shader::destroy_layouts()
+{
+	const auto device = _renderer->context().device;
+	device.destroyPipelineLayout(_pipeline_layout);
+	for (const auto layout : _set_layouts)
+		device.destroyDescriptorSetLayout(layout);
+	_pipeline_layout = nullptr;
+	_set_layouts.clear();
+}
+
+std::vector<vk::PipelineShaderStageCreateInfo>
+euler::vulkan::Shader::stages(
+    std::vector<vk::SpecializationInfo> &specialization,
+    std::vector<vk::SpecializationMapEntry> &entries) const
+{
+	/* Each module only gets the constants it declares, all pointing
+	 * into _values. */
+	std::vector<size_t> first;
+	for (const auto &module : _modules) {
+		first.push_back(entries.size());
+		for (const auto &constant : module.layout.spec_constants) {
+			const auto index = std::ranges::find(_constants,
+					       constant.id,
+					       &ShaderLayout::SpecConstant::id)
+			    - _constants.begin();
+			entries.push_back(vk::SpecializationMapEntry {
+			    .constantID = constant.id,
+			    .offset = static_cast<uint32_t>(
+				index * sizeof(uint32_t)),
+			    .size = sizeof(uint32_t),
+			});
+		}
+	}
+	for (size_t m = 0; m < _modules.size(); ++m) {
+		const auto count = _modules[m].layout.spec_constants.size();
+		specialization.push_back(vk::SpecializationInfo {
+		    .mapEntryCount = static_cast<uint32_t>(count),
+		    .pMapEntries = entries.data() + first[m],
+		    .dataSize = _values.size() * sizeof(uint32_t),
+		    .pData = _values.data(),
+		});
+	}
+	std::vector<vk::PipelineShaderStageCreateInfo> out;
+	for (size_t m = 0; m < _modules.size(); ++m) {
+		for (const auto &entry : _modules[m].layout.entry_points) {
+			out.push_back(vk::PipelineShaderStageCreateInfo {
+			    .stage = entry.stage,
+			    .module = _modules[m].module,
+			    .pName = entry.name.data(),
+			    .pSpecializationInfo = &specialization[m],
+			});
+		}
+	}
+	return out;
+}
+
+static vk::PipelineColorBlendAttachmentState
+blend_attachment(const euler::vulkan::Shader::Blend blend)
+{
+	using Blend = euler::vulkan::Shader::Blend;
+	using Factor = vk::BlendFactor;
+	auto state = vk::PipelineColorBlendAttachmentState {
+		.blendEnable = blend != Blend::None,
+		.srcColorBlendFactor = Factor::eOne,
+		.dstColorBlendFactor = Factor::eOne,
+		.colorBlendOp = vk::BlendOp::eAdd,
+		.srcAlphaBlendFactor = Factor::eOne,
+		.dstAlphaBlendFactor = Factor::eOne,
+		.alphaBlendOp = vk::BlendOp::eAdd,
+		.colorWriteMask = vk::ColorComponentFlagBits::eR
+		    | vk::ColorComponentFlagBits::eG
+		    | vk::ColorComponentFlagBits::eB
+		    | vk::ColorComponentFlagBits::eA,
+	};
+	switch (blend) {
+	case Blend::Alpha:
+		state.srcColorBlendFactor = Factor::eSrcAlpha;
+		state.dstColorBlendFactor = Factor::eOneMinusSrcAlpha;
+		state.dstAlphaBlendFactor = Factor::eOneMinusSrcAlpha;
+		break;
+	case Blend::Max:
+		state.colorBlendOp = vk::BlendOp::eMax;
+		state.alphaBlendOp = vk::BlendOp::eMax;
+		break;
+	default: break;
+	}
+	return state;
+}
+
+vk::Pipeline
+euler::vulkan::Shader::create_pipeline(const GraphicsState &state,
+    const vk::PipelineCache cache) const
+{
+	std::vector<vk::SpecializationInfo> specialization;
+	std::vector<vk::SpecializationMapEntry> entries;
+	const auto stage_infos = stages(specialization, entries);
+
+	const vk::PipelineVertexInputStateCreateInfo vertex_input = {
+		.vertexBindingDescriptionCount
+		= static_cast<uint32_t>(state.vertex_bindings.size()),
+		.pVertexBindingDescriptions = state.vertex_bindings.data(),
+		.vertexAttributeDescriptionCount
+		= static_cast<uint32_t>(state.vertex_attributes.size()),
+		.pVertexAttributeDescriptions = state.vertex_attributes.data(),
+	};
+	const vk::PipelineInputAssemblyStateCreateInfo input_assembly = {
+		.topology = state.topology,
+	};
+	const vk::PipelineViewportStateCreateInfo viewport = {
+		.viewportCount = 1,
+		.scissorCount = 1,
+	};
+	const vk::PipelineRasterizationStateCreateInfo rasterization = {
+		.polygonMode = vk::PolygonMode::eFill,
+		.cullMode = vk::CullModeFlagBits::eNone,
+		.frontFace = vk::FrontFace::eCounterClockwise,
+		.lineWidth = 1.0f,
+	};
+	/* MSAA is pipeline state rather than a specialization constant;
+	 * no shader depends on the sample count. */
+	const auto samples = state.samples != 0
+	    ? state.samples
+	    : _renderer->settings().msaa;
+	const vk::PipelineMultisampleStateCreateInfo multisample = {
+		.rasterizationSamples
+		= static_cast<vk::SampleCountFlagBits>(samples),
+	};
+	const std::vector attachments(state.color_attachments,
+	    blend_attachment(state.blend));
+	const vk::PipelineColorBlendStateCreateInfo blend = {
+		.attachmentCount = static_cast<uint32_t>(attachments.size()),
+		.pAttachments = attachments.data(),
+	};
+	const std::array dynamic_states = {
+		vk::DynamicState::eViewport,
+		vk::DynamicState::eScissor,
+	};
+	const vk::PipelineDynamicStateCreateInfo dynamic = {
+		.dynamicStateCount
+		= static_cast<uint32_t>(dynamic_states.size()),
+		.pDynamicStates = dynamic_states.data(),
+	};
+	const auto [result, pipeline]
+	    = _renderer->context().device.createGraphicsPipeline(cache,
+		vk::GraphicsPipelineCreateInfo {
+		    .stageCount = static_cast<uint32_t>(stage_infos.size()),
+		    .pStages = stage_infos.data(),
+		    .pVertexInputState = &vertex_input,
+		    .pInputAssemblyState = &input_assembly,
+		    .pViewportState = &viewport,
+		    .pRasterizationState = &rasterization,
+		    .pMultisampleState = &multisample,
+		    .pColorBlendState = &blend,
+		    .pDynamicState = &dynamic,
+		    .layout = _pipeline_layout,
+		    .renderPass = state.render_pass,
+		    .subpass = state.subpass,
+		});
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error(
+		    "Failed to create graphics pipeline: "
+		    + vk::to_string(result));
+	}
+	return pipeline;
+}
+
+vk::Pipeline
+euler::vulkan::Shader::create_compute_pipeline(
+    const vk::PipelineCache cache) const
+{
+	std::vector<vk::SpecializationInfo> specialization;
+	std::vector<vk::SpecializationMapEntry> entries;
+	const auto stage_infos = stages(specialization, entries);
+	if (stage_infos.size() != 1
+	    || stage_infos[0].stage != vk::ShaderStageFlagBits::eCompute)
+		throw std::runtime_error("Not a compute shader");
+	const auto [result, pipeline]
+	    = _renderer->context().device.createComputePipeline(cache,
+		vk::ComputePipelineCreateInfo {
+		    .stage = stage_infos[0],
+		    .layout = _pipeline_layout,
+		});
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error(
+		    "Failed to create compute pipeline: "
+		    + vk::to_string(result));
+	}
+	return pipeline;
+}
@@ -3,24 +3,141 @@
 #ifndef EULER_VULKAN_SHADER_H
 #define EULER_VULKAN_SHADER_H
 
-#include "euler/util/object.h"
-
-#include <vulkan/vulkan_raii.hpp>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <string_view>
 #include <vector>
-#include <filesystem>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/renderer.h"
+#include "euler/vulkan/shader_layout.h"
 
 namespace euler::vulkan {
 
+/*
+ * The stages of one pipeline and the layout they share. Descriptor set and
+ * pipeline layouts are built from the reflected layouts of the stages, so
+ * they can't disagree with the shaders; stages that declare the same
+ * binding differently are rejected.
+ *
+ * Variants such as the camera count are specialization constants, set by
+ * name before creating pipelines.
+ */
 class Shader final : public util::Object {
 public:
-	Shader(const std::filesystem::path &path, uint32_t uniform_size = 0);
-	Shader(const std::vector<uint8_t> &vertex,
-	    const std::vector<uint8_t> &fragment, uint32_t uniform_size = 0);
+	/* Size of runtime arrays of descriptors, which are bound
+	 * partially and updated after binding. Matches VK2D's texture
+	 * limit. */
+	static constexpr uint32_t MAX_BINDLESS_DESCRIPTORS
+	    = std::numeric_limits<uint16_t>::max();
+
+	enum class Blend {
+		None,
+		/* Alpha blending over the target. */
+		Alpha,
+		Add,
+		/* Per-component maximum. */
+		Max,
+	};
+
+	struct GraphicsState {
+		vk::RenderPass render_pass;
+		uint32_t subpass = 0;
+		std::span<const vk::VertexInputBindingDescription>
+		    vertex_bindings;
+		std::span<const vk::VertexInputAttributeDescription>
+		    vertex_attributes;
+		vk::PrimitiveTopology topology
+		    = vk::PrimitiveTopology::eTriangleList;
+		/* Applies to every colour attachment. */
+		Blend blend = Blend::Alpha;
+		uint32_t color_attachments = 1;
+		/* Zero uses the renderer's MSAA setting. */
+		uint32_t samples = 0;
+	};
+
+	Shader(const util::Reference<Renderer> &renderer,
+	    std::span<const Renderer::ShaderData> modules);
+	~Shader() override;
+
+	/* Modules by built-in shader name, e.g. { "instanced.vert",
+	 * "instanced.frag" }. */
+	static util::Reference<Shader> builtin(
+	    const util::Reference<Renderer> &renderer,
+	    std::initializer_list<std::string_view> keys);
+
+	/* Sets a specialization constant for pipelines created afterwards.
+	 * Throws if no stage declares it. */
+	void specialize(std::string_view name, uint32_t value);
 
+	/* Makes a uniform or storage buffer binding dynamic, which SPIR-V
+	 * doesn't record, so its offset is given when the set is bound.
+	 * Rebuilds the layouts; call it before anything uses them. */
+	void use_dynamic_offset(uint32_t set, uint32_t binding);
+
+	[[nodiscard]] vk::PipelineLayout
+	pipeline_layout() const
+	{
+		return _pipeline_layout;
+	}
+
+	/* Indexed by set number; sets no stage uses are empty layouts. */
+	[[nodiscard]] std::span<const vk::DescriptorSetLayout>
+	set_layouts() const
+	{
+		return _set_layouts;
+	}
+
+	/* SPIR-V of the stage at index, in the order the modules were
+	 * given. Points into the data the shader was created from. */
+	[[nodiscard]] std::span<const uint8_t>
+	code(const size_t index) const
+	{
+		return _modules.at(index).code;
+	}
+
+	/* Every stage's bindings, merged. */
+	[[nodiscard]] std::span<const ShaderLayout::Binding>
+	bindings() const
+	{
+		return _bindings;
+	}
+
+	[[nodiscard]] vk::Pipeline create_pipeline(const GraphicsState &state,
+	    vk::PipelineCache cache = {}) const;
+	[[nodiscard]] vk::Pipeline create_compute_pipeline(
+	    vk::PipelineCache cache = {}) const;
+
+private:
+	struct Module {
+		vk::ShaderModule module;
+		ShaderLayout layout;
+		std::span<const uint8_t> code;
+	};
+
+	void merge_bindings();
+	void create_layouts();
+	void destroy_layouts();
+	/* Stage infos point into specialization, which must outlive
+	 * them. */
+	std::vector<vk::PipelineShaderStageCreateInfo> stages(
+	    std::vector<vk::SpecializationInfo> &specialization,
+	    std::vector<vk::SpecializationMapEntry> &entries) const;
+
+	util::Reference<Renderer> _renderer;
+	std::vector<Module> _modules;
+	std::vector<ShaderLayout::Binding> _bindings;
+	std::vector<vk::ShaderStageFlags> _binding_stages;
+	std::vector<ShaderLayout::SpecConstant> _constants;
+	/* Current values, parallel to _constants. */
+	std::vector<uint32_t> _values;
+	std::vector<vk::DescriptorSetLayout> _set_layouts;
+	vk::PipelineLayout _pipeline_layout;
 };
 
 } /* namespace euler::vulkan */
 
-
 #endif /* EULER_VULKAN_SHADER_H */
-
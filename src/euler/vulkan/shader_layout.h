@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SHADER_LAYOUT_H
+#define EULER_VULKAN_SHADER_LAYOUT_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <vulkan/vulkan.hpp>
+
+namespace euler::vulkan {
+
+/* What a SPIR-V module expects from its pipeline, as reflected by
+ * shaders/generate_blobs.rb. */
+struct ShaderLayout {
+	struct Binding {
+		uint32_t set;
+		uint32_t binding;
+		vk::DescriptorType type;
+		/* Zero for runtime-sized (bindless) arrays. */
+		uint32_t count;
+		std::string_view name;
+	};
+
+	struct SpecConstant {
+		uint32_t id;
+		std::string_view name;
+		uint32_t default_value;
+	};
+
+	struct EntryPoint {
+		vk::ShaderStageFlagBits stage;
+		std::string_view name;
+	};
+
+	/* GLSL modules have one, Slang modules one per stage. */
+	std::span<const EntryPoint> entry_points;
+	std::span<const Binding> bindings;
+	uint32_t push_constant_size = 0;
+	std::span<const SpecConstant> spec_constants;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SHADER_LAYOUT_H */
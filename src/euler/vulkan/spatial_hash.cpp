@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/spatial_hash.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+using DrawCommand = euler::vulkan::SpriteBatch::DrawCommand;
+
+static bool
+overlaps(const glm::vec4 &a, const glm::vec4 &b)
+{
+	return a.x < b.x + b.z && b.x < a.x + a.z && a.y < b.y + b.w
+	    && b.y < a.y + a.w;
+}
+
+euler::vulkan::SpatialHash::SpatialHash(const float cell_size)
+    : _cell_size(cell_size)
+{
+	if (!(cell_size > 0))
+		throw std::runtime_error("Cell size must be positive");
+}
+
+glm::vec4
+euler::vulkan::SpatialHash::bounds(const DrawCommand &command)
+{
+	/* The same transform as sprite_expand.cpp, without its rounding
+	 * guarantees; bounds only need to be conservative. */
+	const auto c = std::cos(command.rotation);
+	const auto s = std::sin(command.rotation);
+	const auto ox = command.origin.x * -command.scale.x;
+	const auto oy = command.origin.y * command.scale.y;
+	const glm::vec2 x_axis = { c * command.scale.x * command.texture_pos.z,
+		s * command.scale.x * command.texture_pos.z };
+	const glm::vec2 y_axis = { -s * command.scale.y * command.texture_pos.w,
+		c * command.scale.y * command.texture_pos.w };
+	const glm::vec2 translation = { c * ox + s * oy + command.pos.x - ox,
+		s * ox - c * oy + command.pos.y + oy };
+	const std::array corners = { translation, translation + x_axis,
+		translation + y_axis, translation + x_axis + y_axis };
+	auto min = corners[0];
+	auto max = corners[0];
+	for (const auto &corner : corners) {
+		min = glm::min(min, corner);
+		max = glm::max(max, corner);
+	}
+	return { min.x, min.y, max.x - min.x, max.y - min.y };
+}
+
+euler::vulkan::SpatialHash::Cells
+euler::vulkan::SpatialHash::cells(const glm::vec4 &bounds) const
+{
+	/* Clamped so that far-off objects can't overflow the cell
+	 * coordinates. */
+	constexpr auto LIMIT = static_cast<float>(1 << 30);
+	const auto cell = [&](const float v) {
+		return static_cast<int32_t>(
+		    std::clamp(std::floor(v / _cell_size), -LIMIT, LIMIT));
+	};
+	return Cells {
+		.x0 = cell(bounds.x),
+		.y0 = cell(bounds.y),
+		.x1 = cell(bounds.x + bounds.z),
+		.y1 = cell(bounds.y + bounds.w),
+	};
+}
+
+void
+euler::vulkan::SpatialHash::link(const Id id)
+{
+	auto &object = _objects[id];
+	const auto &c = object.cells;
+	const auto count = (static_cast<uint64_t>(c.x1) - c.x0 + 1)
+	    * (static_cast<uint64_t>(c.y1) - c.y0 + 1);
+	object.large = count > MAX_CELLS;
+	if (object.large) {
+		_large.push_back(id);
+		return;
+	}
+	for (auto y = c.y0; y <= c.y1; ++y) {
+		for (auto x = c.x0; x <= c.x1; ++x)
+			_grid[key(x, y)].push_back(id);
+	}
+}
+
+void
+euler::vulkan::SpatialHash::unlink(const Id id)
+{
+	const auto &object = _objects[id];
+	if (object.large) {
+		std::erase(_large, id);
+		return;
+	}
+	const auto &c = object.cells;
+	for (auto y = c.y0; y <= c.y1; ++y) {
+		for (auto x = c.x0; x <= c.x1; ++x) {
+			const auto it = _grid.find(key(x, y));
+			std::erase(it->second, id);
+			if (it->second.empty()) _grid.erase(it);
+		}
+	}
+}
+
+euler::vulkan::SpatialHash::Id
+euler::vulkan::SpatialHash::insert(const DrawCommand &command)
+{
+	return insert(command, bounds(command));
+}
+
+euler::vulkan::SpatialHash::Id
+euler::vulkan::SpatialHash::insert(const DrawCommand &command,
+    const glm::vec4 &bounds)
+{
+	Id id;
+	if (!_free.empty()) {
+		id = _free.back();
+		_free.pop_back();
+	} else {
+		id = static_cast<Id>(_objects.size());
+		_objects.emplace_back();
+	}
+	_objects[id] = Object {
+		.command = command,
+		.bounds = bounds,
+		.cells = cells(bounds),
+		.order = _order++,
+		.alive = true,
+	};
+	link(id);
+	return id;
+}
+
+void
+euler::vulkan::SpatialHash::update(const Id id, const DrawCommand &command)
+{
+	update(id, command, bounds(command));
+}
+
+void
+euler::vulkan::SpatialHash::update(const Id id, const DrawCommand &command,
+    const glm::vec4 &bounds)
+{
+	if (id >= _objects.size() || !_objects[id].alive)
+		throw std::runtime_error("No such object");
+	auto &object = _objects[id];
+	object.command = command;
+	object.bounds = bounds;
+	const auto moved = cells(bounds);
+	if (moved == object.cells) return;
+	unlink(id);
+	object.cells = moved;
+	link(id);
+}
+
+void
+euler::vulkan::SpatialHash::remove(const Id id)
+{
+	if (id >= _objects.size() || !_objects[id].alive) return;
+	unlink(id);
+	_objects[id].alive = false;
+	_free.push_back(id);
+}
+
+void
+euler::vulkan::SpatialHash::clear()
+{
+	_objects.clear();
+	_free.clear();
+	_grid.clear();
+	_large.clear();
+}
+
+void
+euler::vulkan::SpatialHash::query(const std::span<const glm::vec4> views,
+    std::vector<Id> &out)
+{
+	out.clear();
+	const auto stamp = ++_stamp;
+	const auto visit = [&](const Id id, const glm::vec4 &view) {
+		auto &object = _objects[id];
+		if (object.stamp == stamp || !overlaps(object.bounds, view))
+			return;
+		object.stamp = stamp;
+		out.push_back(id);
+	};
+	for (const auto &view : views) {
+		const auto c = cells(view);
+		const auto count = (static_cast<uint64_t>(c.x1) - c.x0 + 1)
+		    * (static_cast<uint64_t>(c.y1) - c.y0 + 1);
+		/* A view zoomed far out is cheaper to test against every
+		 * occupied cell. */
+		if (count > _grid.size()) {
+			for (const auto &[_, ids] : _grid) {
+				for (const auto id : ids) visit(id, view);
+			}
+			for (const auto id : _large) visit(id, view);
+			continue;
+		}
+		for (auto y = c.y0; y <= c.y1; ++y) {
+			for (auto x = c.x0; x <= c.x1; ++x) {
+				const auto it = _grid.find(key(x, y));
+				if (it == _grid.end()) continue;
+				for (const auto id : it->second)
+					visit(id, view);
+			}
+		}
+		for (const auto id : _large) visit(id, view);
+	}
+	std::ranges::sort(out, {}, [&](const Id id) {
+		return _objects[id].order;
+	});
+}
+
+size_t
+euler::vulkan::SpatialHash::draw(const std::span<const glm::vec4> views,
+    SpriteBatch &batch)
+{
+	query(views, _visible);
+	const auto commands = batch.allocate(_visible.size());
+	for (size_t i = 0; i < _visible.size(); ++i)
+		commands[i] = _objects[_visible[i]].command;
+	return _visible.size();
+}
+
+size_t
+euler::vulkan::SpatialHash::draw(const std::span<Camera *const> cameras,
+    SpriteBatch &batch)
+{
+	_views.clear();
+	for (const auto camera : cameras) {
+		if (camera->state() == Camera::State::Normal)
+			_views.push_back(camera->view_rect());
+	}
+	/* SpriteRenderer draws with VK2D's camera when none is enabled. */
+	if (_views.empty())
+		_views.push_back(Camera::view_rect(Camera::vk2d_spec()));
+	return draw(_views, batch);
+}
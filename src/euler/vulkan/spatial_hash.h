@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPATIAL_HASH_H
+#define EULER_VULKAN_SPATIAL_HASH_H
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/camera.h"
+#include "euler/vulkan/sprite_batch.h"
+
+namespace euler::vulkan {
+
+/*
+ * Sprites and tiles bucketed by a uniform grid over world space, so that
+ * only those a camera can see are sent to the sprite batch. Objects are
+ * re-bucketed only when they move into different cells. Objects spanning
+ * more than MAX_CELLS cells are kept in a list that every query checks
+ * instead.
+ *
+ * Visible objects are drawn in the order they were inserted, whatever
+ * cells they came from.
+ *
+ * Main thread only.
+ */
+class SpatialHash final : public util::Object {
+public:
+	using Id = uint32_t;
+
+	static constexpr float DEFAULT_CELL_SIZE = 256;
+	static constexpr size_t MAX_CELLS = 64;
+
+	explicit SpatialHash(float cell_size = DEFAULT_CELL_SIZE);
+	~SpatialHash() override = default;
+
+	/* Bounds are computed from the sprite's transform. */
+	Id insert(const SpriteBatch::DrawCommand &command);
+	/* bounds: x, y, w, h in world space */
+	Id insert(const SpriteBatch::DrawCommand &command,
+	    const glm::vec4 &bounds);
+	void update(Id id, const SpriteBatch::DrawCommand &command);
+	void update(Id id, const SpriteBatch::DrawCommand &command,
+	    const glm::vec4 &bounds);
+	void remove(Id id);
+	void clear();
+
+	[[nodiscard]] const SpriteBatch::DrawCommand &
+	command(const Id id) const
+	{
+		return _objects[id].command;
+	}
+
+	[[nodiscard]] size_t
+	size() const
+	{
+		return _objects.size() - _free.size();
+	}
+
+	/* Replaces out with the objects overlapping any of views, each
+	 * once, in draw order. */
+	void query(std::span<const glm::vec4> views, std::vector<Id> &out);
+
+	/* Queues the objects visible in any of views, or to any enabled
+	 * camera, into batch and returns how many there were. With no
+	 * enabled camera, VK2D's view is used, as it is for drawing. */
+	size_t draw(std::span<const glm::vec4> views, SpriteBatch &batch);
+	size_t draw(std::span<Camera *const> cameras, SpriteBatch &batch);
+
+	/* x, y, w, h covering the quad command draws. */
+	static glm::vec4 bounds(const SpriteBatch::DrawCommand &command);
+
+private:
+	/* Inclusive cell coordinates. */
+	struct Cells {
+		int32_t x0;
+		int32_t y0;
+		int32_t x1;
+		int32_t y1;
+
+		bool operator==(const Cells &) const = default;
+	};
+
+	struct Object {
+		SpriteBatch::DrawCommand command;
+		glm::vec4 bounds;
+		Cells cells;
+		/* Insertion sequence, for draw order. */
+		uint64_t order;
+		/* Last query that found the object. */
+		uint64_t stamp = 0;
+		bool alive = false;
+		bool large = false;
+	};
+
+	[[nodiscard]] Cells cells(const glm::vec4 &bounds) const;
+	void link(Id id);
+	void unlink(Id id);
+
+	static uint64_t
+	key(const int32_t x, const int32_t y)
+	{
+		return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32
+		    | static_cast<uint32_t>(y);
+	}
+
+	float _cell_size;
+	std::vector<Object> _objects;
+	std::vector<Id> _free;
+	std::unordered_map<uint64_t, std::vector<Id>> _grid;
+	std::vector<Id> _large;
+	/* Scratch for draw(). */
+	std::vector<glm::vec4> _views;
+	std::vector<Id> _visible;
+	uint64_t _order = 0;
+	uint64_t _stamp = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPATIAL_HASH_H */
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/sprite_batch.h"
+
+#include <algorithm>
+#include <memory>
+
+euler::vulkan::SpriteBatch::SpriteBatch(const size_t capacity)
+{
+	_commands.reserve(capacity);
+}
+
+void
+euler::vulkan::SpriteBatch::begin_frame(util::FrameArena &arena)
+{
+	std::pmr::vector<DrawCommand> commands(arena.resource());
+	commands.reserve(std::max(_high_water, _commands.size()));
+	commands.assign(_commands.begin(), _commands.end());
+	/* Assignment would copy into the old resource instead of adopting
+	 * the arena, since polymorphic allocators don't propagate. The old
+	 * storage is in last frame's arena or on the heap and is released
+	 * with it. */
+	std::destroy_at(&_commands);
+	std::construct_at(&_commands, std::move(commands));
+}
+
+void
+euler::vulkan::SpriteBatch::add(const std::span<const DrawCommand> commands)
+{
+	_commands.insert(_commands.end(), commands.begin(), commands.end());
+}
+
+std::span<euler::vulkan::SpriteBatch::DrawCommand>
+euler::vulkan::SpriteBatch::allocate(const size_t count)
+{
+	const auto offset = _commands.size();
+	_commands.resize(offset + count);
+	return std::span(_commands).subspan(offset, count);
+}
+
+void
+euler::vulkan::SpriteBatch::clear()
+{
+	_high_water = std::max(_high_water, _commands.size());
+	_commands.clear();
+}
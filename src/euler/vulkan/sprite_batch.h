@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPRITE_BATCH_H
+#define EULER_VULKAN_SPRITE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "euler/util/arena.h"
+#include "euler/util/object.h"
+
+namespace euler::vulkan {
+
+/*
+ * Collects sprites for a frame, which SpriteRenderer draws in one go. The
+ * commands are expanded into per-instance transforms on the GPU by
+ * spritebatch.comp and then drawn with a single instanced draw per active
+ * camera.
+ *
+ * Main thread only.
+ */
+class SpriteBatch final : public util::Object {
+public:
+	/* Mirrors the std430 DrawCommand in spritebatch.comp. */
+	struct DrawCommand {
+		/* x, y, w, h in texels */
+		glm::vec4 texture_pos;
+		glm::vec4 colour;
+		glm::vec2 pos;
+		glm::vec2 origin;
+		glm::vec2 scale;
+		float rotation;
+		uint32_t texture_index;
+	};
+
+	static_assert(offsetof(DrawCommand, texture_pos) == 0);
+	static_assert(offsetof(DrawCommand, colour) == 16);
+	static_assert(offsetof(DrawCommand, pos) == 32);
+	static_assert(offsetof(DrawCommand, origin) == 40);
+	static_assert(offsetof(DrawCommand, scale) == 48);
+	static_assert(offsetof(DrawCommand, rotation) == 56);
+	static_assert(offsetof(DrawCommand, texture_index) == 60);
+	static_assert(sizeof(DrawCommand) == 64);
+
+	/*
+	 * Mirrors the std430 DrawInstance that spritebatch.comp writes and
+	 * instanced.vert reads: the 2D affine part of the model matrix with
+	 * the quad size folded into the axes, 16-bit texel coordinates, an
+	 * RGBA8 colour and a 16-bit texture index. 40 bytes, down from 112
+	 * for a mat4 and float coordinates.
+	 */
+	struct DrawInstance {
+		glm::vec2 x_axis;
+		glm::vec2 y_axis;
+		glm::vec2 translation;
+		/* x, y, w, h in texels, clamped to 16 bits, so atlas pages
+		 * address exactly up to 65535 texels. */
+		uint16_t texture_pos[4];
+		/* packUnorm4x8 */
+		uint32_t colour;
+		/* A TextureTable slot, which always fits. The shader reads a
+		 * uint and masks off the padding after it. */
+		uint16_t texture_index;
+	};
+
+	static_assert(offsetof(DrawInstance, x_axis) == 0);
+	static_assert(offsetof(DrawInstance, y_axis) == 8);
+	static_assert(offsetof(DrawInstance, translation) == 16);
+	static_assert(offsetof(DrawInstance, texture_pos) == 24);
+	static_assert(offsetof(DrawInstance, colour) == 32);
+	static_assert(offsetof(DrawInstance, texture_index) == 36);
+	/* std430 rounds the array stride up to the vec2 alignment. */
+	static_assert(sizeof(DrawInstance) == 40);
+
+	static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+	/* Where DrawCommands are turned into DrawInstances. Cpu is for
+	 * drivers whose compute path is missing or broken; see
+	 * sprite_expand.h. */
+	enum class Expansion {
+		Gpu,
+		Cpu,
+	};
+
+	explicit SpriteBatch(size_t capacity = DEFAULT_CAPACITY);
+	~SpriteBatch() override = default;
+
+	/* Moves the commands into arena's current frame, where the rest of
+	 * the frame's commands are allocated. They stay on the heap until
+	 * the first call. */
+	void begin_frame(util::FrameArena &arena);
+
+	void
+	add(const DrawCommand &command)
+	{
+		_commands.push_back(command);
+	}
+
+	void add(std::span<const DrawCommand> commands);
+
+	/* Appends count zeroed commands and returns them for the caller to
+	 * fill in place, e.g. a tile layer writing a whole row at once. */
+	std::span<DrawCommand> allocate(size_t count);
+
+	[[nodiscard]] std::span<const DrawCommand>
+	commands() const
+	{
+		return _commands;
+	}
+
+	[[nodiscard]] size_t
+	size() const
+	{
+		return _commands.size();
+	}
+
+	[[nodiscard]] bool
+	empty() const
+	{
+		return _commands.empty();
+	}
+
+	void clear();
+
+	[[nodiscard]] Expansion
+	expansion() const
+	{
+		return _expansion;
+	}
+
+	void
+	set_expansion(const Expansion expansion)
+	{
+		_expansion = expansion;
+	}
+
+	/* Largest batch cleared so far; the buffer never shrinks below it. */
+	[[nodiscard]] size_t
+	high_water() const
+	{
+		return _high_water;
+	}
+
+private:
+	std::pmr::vector<DrawCommand> _commands;
+	Expansion _expansion = Expansion::Gpu;
+	size_t _high_water = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPRITE_BATCH_H */
@@ -0,0 +1,252 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/sprite_expand.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EULER_SIMD_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define EULER_SIMD_NEON 1
+#endif
+
+using DrawCommand = euler::vulkan::SpriteBatch::DrawCommand;
+using DrawInstance = euler::vulkan::SpriteBatch::DrawInstance;
+
+namespace {
+/* Sprites are transposed into structure-of-arrays blocks so each field can
+ * be processed a full vector at a time. */
+constexpr size_t BLOCK = 8;
+
+struct Block {
+	/* inputs */
+	alignas(32) float cos[BLOCK];
+	alignas(32) float sin[BLOCK];
+	alignas(32) float scale_x[BLOCK];
+	alignas(32) float scale_y[BLOCK];
+	alignas(32) float origin_x[BLOCK];
+	alignas(32) float origin_y[BLOCK];
+	alignas(32) float pos_x[BLOCK];
+	alignas(32) float pos_y[BLOCK];
+	/* outputs: columns 0, 1 and 3 of the model matrix, before the quad
+	 * size is folded in */
+	alignas(32) float x_axis_x[BLOCK];
+	alignas(32) float x_axis_y[BLOCK];
+	alignas(32) float y_axis_x[BLOCK];
+	alignas(32) float y_axis_y[BLOCK];
+	alignas(32) float translation_x[BLOCK];
+	alignas(32) float translation_y[BLOCK];
+};
+
+void
+gather(Block &block, const DrawCommand *commands, const size_t count)
+{
+	for (size_t i = 0; i < BLOCK; ++i) {
+		/* Pad the last block with zeros; the results are discarded. */
+		const auto &cmd = i < count ? commands[i] : DrawCommand {};
+		block.cos[i] = std::cos(cmd.rotation);
+		block.sin[i] = std::sin(cmd.rotation);
+		block.scale_x[i] = cmd.scale.x;
+		block.scale_y[i] = cmd.scale.y;
+		block.origin_x[i] = cmd.origin.x;
+		block.origin_y[i] = cmd.origin.y;
+		block.pos_x[i] = cmd.pos.x;
+		block.pos_y[i] = cmd.pos.y;
+	}
+}
+
+/* packUnorm4x8, which rounds to nearest. */
+uint32_t
+pack_unorm_4x8(const glm::vec4 &colour)
+{
+	uint32_t packed = 0;
+	for (int i = 0; i < 4; ++i) {
+		const auto c = std::clamp(colour[i], 0.0f, 1.0f);
+		packed |= static_cast<uint32_t>(std::nearbyint(c * 255.0f))
+		    << (i * 8);
+	}
+	return packed;
+}
+
+/* uint(clamp(v, 0, 65535)) in spritebatch.comp, which truncates. */
+uint16_t
+texel(const float v)
+{
+	return static_cast<uint16_t>(std::clamp(v, 0.0f, 65535.0f));
+}
+
+void
+scatter(const Block &block, const DrawCommand *commands, DrawInstance *out,
+    const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		const auto &cmd = commands[i];
+		auto &inst = out[i];
+		/* The quad's size is folded in here, after the vector
+		 * paths, so it rounds the same on all of them. */
+		inst.x_axis = glm::vec2(block.x_axis_x[i], block.x_axis_y[i])
+		    * cmd.texture_pos.z;
+		inst.y_axis = glm::vec2(block.y_axis_x[i], block.y_axis_y[i])
+		    * cmd.texture_pos.w;
+		inst.translation
+		    = { block.translation_x[i], block.translation_y[i] };
+		for (int j = 0; j < 4; ++j)
+			inst.texture_pos[j] = texel(cmd.texture_pos[j]);
+		inst.colour = pack_unorm_4x8(cmd.colour);
+		inst.texture_index = static_cast<uint16_t>(cmd.texture_index);
+	}
+}
+
+/*
+ * The model matrix spritebatch.comp builds is
+ *
+ *	T(pos - origin') * R(-rotation) * T(origin') * S(scale)
+ *
+ * with origin' = origin * (-scale.x, scale.y). Only the 2D affine part
+ * varies, so it's expanded by hand and every path evaluates exactly this
+ * sequence of operations so that they round identically.
+ */
+#define EULER_EXPAND_AFFINE(V, WIDTH, LOAD, STORE, MUL, ADD, SUB, NEG)        \
+	for (size_t i = 0; i < BLOCK; i += (WIDTH)) {                          \
+		const V c = LOAD(block.cos + i);                               \
+		const V s = LOAD(block.sin + i);                               \
+		const V sx = LOAD(block.scale_x + i);                          \
+		const V sy = LOAD(block.scale_y + i);                          \
+		const V ox = MUL(LOAD(block.origin_x + i), NEG(sx));           \
+		const V oy = MUL(LOAD(block.origin_y + i), sy);                \
+		const V px = SUB(LOAD(block.pos_x + i), ox);                   \
+		const V py = ADD(oy, LOAD(block.pos_y + i));                   \
+		STORE(block.x_axis_x + i, MUL(c, sx));                         \
+		STORE(block.x_axis_y + i, MUL(s, sx));                         \
+		STORE(block.y_axis_x + i, NEG(MUL(s, sy)));                    \
+		STORE(block.y_axis_y + i, MUL(c, sy));                         \
+		STORE(block.translation_x + i,                                 \
+		    ADD(SUB(MUL(c, ox), MUL(s, NEG(oy))), px));                \
+		STORE(block.translation_y + i,                                 \
+		    ADD(ADD(MUL(s, ox), MUL(c, NEG(oy))), py));                \
+	}
+
+#define EULER_SCALAR_LOAD(p) (*(p))
+#define EULER_SCALAR_STORE(p, v) (*(p) = (v))
+#define EULER_SCALAR_MUL(a, b) ((a) * (b))
+#define EULER_SCALAR_ADD(a, b) ((a) + (b))
+#define EULER_SCALAR_SUB(a, b) ((a) - (b))
+#define EULER_SCALAR_NEG(a) (-(a))
+
+void
+affine_scalar(Block &block)
+{
+	EULER_EXPAND_AFFINE(float, 1, EULER_SCALAR_LOAD, EULER_SCALAR_STORE,
+	    EULER_SCALAR_MUL, EULER_SCALAR_ADD, EULER_SCALAR_SUB,
+	    EULER_SCALAR_NEG)
+}
+
+#ifdef EULER_SIMD_X86
+/* Flipping the sign bit is exact, unlike subtracting from zero. */
+#define EULER_SSE_NEG(a) _mm_xor_ps((a), _mm_set1_ps(-0.0f))
+
+void
+affine_sse2(Block &block)
+{
+	EULER_EXPAND_AFFINE(__m128, 4, _mm_load_ps, _mm_store_ps, _mm_mul_ps,
+	    _mm_add_ps, _mm_sub_ps, EULER_SSE_NEG)
+}
+
+#define EULER_AVX_NEG(a) _mm256_xor_ps((a), _mm256_set1_ps(-0.0f))
+
+__attribute__((target("avx2"))) void
+affine_avx2(Block &block)
+{
+	EULER_EXPAND_AFFINE(__m256, 8, _mm256_load_ps, _mm256_store_ps,
+	    _mm256_mul_ps, _mm256_add_ps, _mm256_sub_ps, EULER_AVX_NEG)
+}
+#endif
+
+#ifdef EULER_SIMD_NEON
+void
+affine_neon(Block &block)
+{
+	EULER_EXPAND_AFFINE(float32x4_t, 4, vld1q_f32, vst1q_f32, vmulq_f32,
+	    vaddq_f32, vsubq_f32, vnegq_f32)
+}
+#endif
+
+using AffineFn = void (*)(Block &);
+
+AffineFn
+affine_for(const euler::vulkan::SimdPath path)
+{
+	using euler::vulkan::SimdPath;
+	switch (path) {
+	case SimdPath::Scalar: return affine_scalar;
+#ifdef EULER_SIMD_X86
+	case SimdPath::SSE2: return affine_sse2;
+	case SimdPath::AVX2:
+		if (__builtin_cpu_supports("avx2")) return affine_avx2;
+		break;
+#endif
+#ifdef EULER_SIMD_NEON
+	case SimdPath::NEON: return affine_neon;
+#endif
+	default: break;
+	}
+	throw std::runtime_error(
+	    std::string("SIMD path not supported on this CPU: ")
+	    + std::string(euler::vulkan::simd_path_name(path)));
+}
+
+} /* namespace */
+
+euler::vulkan::SimdPath
+euler::vulkan::best_simd_path()
+{
+#if defined(EULER_SIMD_X86)
+	if (__builtin_cpu_supports("avx2")) return SimdPath::AVX2;
+	return SimdPath::SSE2;
+#elif defined(EULER_SIMD_NEON)
+	return SimdPath::NEON;
+#else
+	return SimdPath::Scalar;
+#endif
+}
+
+std::string_view
+euler::vulkan::simd_path_name(const SimdPath path)
+{
+	switch (path) {
+	case SimdPath::Scalar: return "scalar";
+	case SimdPath::SSE2: return "sse2";
+	case SimdPath::AVX2: return "avx2";
+	case SimdPath::NEON: return "neon";
+	default: return "unknown";
+	}
+}
+
+void
+euler::vulkan::expand_sprites(const std::span<const DrawCommand> commands,
+    const std::span<DrawInstance> out)
+{
+	static const auto path = best_simd_path();
+	expand_sprites(commands, out, path);
+}
+
+void
+euler::vulkan::expand_sprites(const std::span<const DrawCommand> commands,
+    const std::span<DrawInstance> out, const SimdPath path)
+{
+	if (out.size() < commands.size())
+		throw std::runtime_error("Sprite instance buffer is too small");
+	const auto affine = affine_for(path);
+	Block block;
+	for (size_t i = 0; i < commands.size(); i += BLOCK) {
+		const auto count = std::min(BLOCK, commands.size() - i);
+		gather(block, commands.data() + i, count);
+		affine(block);
+		scatter(block, commands.data() + i, out.data() + i, count);
+	}
+}
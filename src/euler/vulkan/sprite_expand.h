@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPRITE_EXPAND_H
+#define EULER_VULKAN_SPRITE_EXPAND_H
+
+#include <span>
+#include <string_view>
+
+#include "euler/vulkan/sprite_batch.h"
+
+namespace euler::vulkan {
+
+/*
+ * CPU implementation of spritebatch.comp, for drivers without a usable
+ * compute path and as a reference to check the GPU against.
+ *
+ * Every instruction set produces bit-identical output: sine and cosine are
+ * evaluated with the scalar libm routines and the vector paths never
+ * contract into fused multiply-adds. Output from
+ * the GPU matches to within float rounding, since the shader is free to
+ * evaluate the matrix products in a different order.
+ */
+enum class SimdPath {
+	Scalar,
+	SSE2,
+	AVX2,
+	NEON,
+};
+
+/* Best path supported by the running CPU. */
+SimdPath best_simd_path();
+std::string_view simd_path_name(SimdPath path);
+
+/* out must hold at least commands.size() instances. */
+void expand_sprites(std::span<const SpriteBatch::DrawCommand> commands,
+    std::span<SpriteBatch::DrawInstance> out);
+void expand_sprites(std::span<const SpriteBatch::DrawCommand> commands,
+    std::span<SpriteBatch::DrawInstance> out, SimdPath path);
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPRITE_EXPAND_H */
@@ -0,0 +1,653 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/sprite_renderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <VK2D/VK2D.h>
+
+#include "euler/vulkan/sprite_expand.h"
+
+using DrawCommand = euler::vulkan::SpriteBatch::DrawCommand;
+using DrawInstance = euler::vulkan::SpriteBatch::DrawInstance;
+
+/* Blending many sprites into 8 bits and then dividing by alpha would band
+ * badly in faint edges. */
+static constexpr auto INTERMEDIATE_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+
+/* local_size_x of spritebatch.comp */
+static constexpr uint32_t BATCH_GROUP_SIZE = 64;
+
+static const vk::ClearValue TRANSPARENT = {};
+
+static vk::Viewport
+viewport(const float x, const float y, const float w, const float h)
+{
+	return vk::Viewport {
+		.x = x,
+		.y = y,
+		.width = w,
+		.height = h,
+		.minDepth = 0,
+		.maxDepth = 1,
+	};
+}
+
+/* rect clipped to extent, as scissors can't start off the target. */
+static vk::Rect2D
+scissor(const glm::vec4 &rect, const vk::Extent2D extent)
+{
+	const auto clip = [](const float v, const uint32_t limit) {
+		return static_cast<uint32_t>(
+		    std::clamp(v, 0.0f, static_cast<float>(limit)));
+	};
+	const auto x0 = clip(rect.x, extent.width);
+	const auto y0 = clip(rect.y, extent.height);
+	const auto x1 = clip(rect.x + rect.z, extent.width);
+	const auto y1 = clip(rect.y + rect.w, extent.height);
+	return vk::Rect2D {
+		.offset = {
+		    static_cast<int32_t>(x0),
+		    static_cast<int32_t>(y0),
+		},
+		.extent = { x1 - x0, y1 - y0 },
+	};
+}
+
+euler::vulkan::SpriteRenderer::SpriteRenderer(
+    const util::Reference<Renderer> &renderer,
+    const util::Reference<RenderGraph> &graph,
+    const util::Reference<SpriteBatch> &batch, Uploader &uploader)
+    : _renderer(renderer)
+    , _graph(graph)
+    , _batch(batch)
+    /* The target is a VK2D texture, so it has the swapchain's format. */
+    , _format(static_cast<vk::Format>(
+	  vk2dRendererGetPointer()->surfaceFormat.format))
+{
+	/* The intermediate is only used between our own passes. The
+	 * resolve's transition is what the graph derives once the passes
+	 * are in it; rebuilt if it ends up deriving something else. */
+	using Access = RenderGraph::Access;
+	const RenderGraph::Transition steady = {
+		.from = RenderGraph::usage(Access::Sampled),
+		.to = RenderGraph::usage(Access::ColorWrite),
+		.next = RenderGraph::usage(Access::Sampled),
+	};
+	_resolve_transition = steady;
+	try {
+		_draw_pass = _graph->create_render_pass(1, INTERMEDIATE_FORMAT,
+		    steady);
+		_resolve_pass = _graph->create_render_pass(1, _format,
+		    _resolve_transition);
+		/* The camera UBO is set 0 of instanced.vert. Making it
+		 * dynamic rebuilds the layouts, so it goes before anything
+		 * allocates from them. */
+		_sprite_shader = Shader::builtin(_renderer,
+		    { "instanced.vert", "instanced.frag" });
+		_camera_buffer = util::make_reference<DescriptorBuffer>(
+		    _renderer, _sprite_shader, 0, sizeof(glm::mat4));
+		_default_index = _camera_buffer->allocate();
+		/* tex[] is set 2 of instanced.frag. */
+		_texture_table = util::make_reference<TextureTable>(_renderer,
+		    _sprite_shader, 2, uploader);
+		_resolve_shader = Shader::builtin(_renderer,
+		    { "sprite_resolve.vert", "sprite_resolve.frag" });
+		_batch_shader
+		    = Shader::builtin(_renderer, { "spritebatch.comp" });
+		create_frames();
+		add_pipelines();
+	} catch (...) {
+		destroy();
+		throw;
+	}
+	/* Drawn outside VK2D and the graph's aliasing, so it's owned here
+	 * and imported. */
+	_sprite_image = _graph->import_image("sprites", { .format = _format },
+	    Access::Sampled);
+	_sprites_pass = _graph->add_pass("sprites", "gui")
+			    .write(_sprite_image, Access::ColorWrite)
+			    .execute([this] { draw(); })
+			    .id();
+	_graph->add_pass("sprite_composite", "gui")
+	    .read(_sprite_image)
+	    .write(RenderGraph::BACKBUFFER, Access::ColorBlend)
+	    .execute([this] { composite(); });
+}
+
+euler::vulkan::SpriteRenderer::~SpriteRenderer()
+{
+	_graph->remove_pass("sprites");
+	_graph->remove_pass("sprite_composite");
+	/* The targets and buffers may still be in use by frames in
+	 * flight. */
+	_renderer->context().device.waitIdle();
+	/* The builders point at the shaders and render passes. */
+	_renderer->pipeline_cache()->wait();
+	destroy();
+}
+
+void
+euler::vulkan::SpriteRenderer::destroy()
+{
+	const auto device = _renderer->context().device;
+	destroy_targets();
+	device.destroyRenderPass(_draw_pass);
+	device.destroyRenderPass(_resolve_pass);
+	device.destroySampler(_sampler);
+	for (const auto &frame : _frames) device.destroyFence(frame.fence);
+	_frames.clear();
+	/* Frees the sets and command buffers with them. */
+	device.destroyDescriptorPool(_descriptor_pool);
+	device.destroyCommandPool(_command_pool);
+}
+
+void
+euler::vulkan::SpriteRenderer::sync_render_passes()
+{
+	const auto resolve = _graph->transition(_sprites_pass, _sprite_image);
+	if (resolve == _resolve_transition) return;
+	const auto device = _renderer->context().device;
+	/* Only this object's submissions use the pass. The framebuffer and
+	 * pipeline stay valid, as the new pass is compatible. */
+	std::vector<vk::Fence> fences;
+	for (const auto &frame : _frames) fences.push_back(frame.fence);
+	if (device.waitForFences(fences, VK_TRUE, UINT64_MAX)
+	    != vk::Result::eSuccess)
+		throw std::runtime_error("Sprite frames timed out");
+	device.destroyRenderPass(_resolve_pass);
+	_resolve_pass = nullptr;
+	_resolve_pass = _graph->create_render_pass(1, _format, resolve);
+	_resolve_transition = resolve;
+}
+
+void
+euler::vulkan::SpriteRenderer::add_pipelines()
+{
+	/* Raw pointers, as the shaders hold the renderer that owns the
+	 * cache. The destructor waits for the builds, and the passes
+	 * outlive them as the first draw waits for the pipelines before
+	 * any pass is rebuilt. */
+	const auto cache = _renderer->pipeline_cache();
+	const auto sprites = _sprite_shader.get();
+	/* Alpha blending into the transparent intermediate leaves it
+	 * premultiplied. */
+	cache->add_pipeline("sprites", { sprites->code(0), sprites->code(1) },
+	    [sprites, pass = _draw_pass](const vk::PipelineCache handle) {
+		    return sprites->create_pipeline(
+			Shader::GraphicsState {
+			    .render_pass = pass,
+			    .blend = Shader::Blend::Alpha,
+			    .samples = 1,
+			},
+			handle);
+	    });
+	const auto resolve = _resolve_shader.get();
+	cache->add_pipeline("sprite_resolve",
+	    { resolve->code(0), resolve->code(1) },
+	    [resolve, pass = _resolve_pass](const vk::PipelineCache handle) {
+		    return resolve->create_pipeline(
+			Shader::GraphicsState {
+			    .render_pass = pass,
+			    .blend = Shader::Blend::None,
+			    .samples = 1,
+			},
+			handle);
+	    });
+	const auto batch = _batch_shader.get();
+	cache->add_pipeline("sprite_batch", { batch->code(0) },
+	    [batch](const vk::PipelineCache handle) {
+		    return batch->create_compute_pipeline(handle);
+	    });
+}
+
+void
+euler::vulkan::SpriteRenderer::create_frames()
+{
+	const auto &ctx = _renderer->context();
+	const auto count = ctx.frames_in_flight;
+	_command_pool = ctx.device.createCommandPool(vk::CommandPoolCreateInfo {
+	    .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+	    .queueFamilyIndex = ctx.graphics_family,
+	});
+	const std::array sizes = {
+		vk::DescriptorPoolSize {
+		    .type = vk::DescriptorType::eStorageBuffer,
+		    .descriptorCount = 3 * count,
+		},
+		vk::DescriptorPoolSize {
+		    .type = vk::DescriptorType::eSampler,
+		    .descriptorCount = 1,
+		},
+		vk::DescriptorPoolSize {
+		    .type = vk::DescriptorType::eCombinedImageSampler,
+		    .descriptorCount = 1,
+		},
+	};
+	_descriptor_pool
+	    = ctx.device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+		.maxSets = 2 * count + 2,
+		.poolSizeCount = static_cast<uint32_t>(sizes.size()),
+		.pPoolSizes = sizes.data(),
+	    });
+	_sampler = ctx.device.createSampler(vk::SamplerCreateInfo {
+	    .magFilter = vk::Filter::eNearest,
+	    .minFilter = vk::Filter::eNearest,
+	    .mipmapMode = vk::SamplerMipmapMode::eNearest,
+	    .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+	    .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+	    .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+	    .maxLod = 0,
+	});
+	const auto commands
+	    = ctx.device.allocateCommandBuffers(vk::CommandBufferAllocateInfo {
+		.commandPool = _command_pool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = count,
+	    });
+	const auto allocate = [&](const util::Reference<Shader> &shader,
+				  const uint32_t set) {
+		const auto layout = shader->set_layouts()[set];
+		return ctx.device.allocateDescriptorSets(
+		    vk::DescriptorSetAllocateInfo {
+			.descriptorPool = _descriptor_pool,
+			.descriptorSetCount = 1,
+			.pSetLayouts = &layout,
+		    })[0];
+	};
+	_sampler_set = allocate(_sprite_shader, 1);
+	_resolve_set = allocate(_resolve_shader, 0);
+	const vk::DescriptorImageInfo sampler = { .sampler = _sampler };
+	ctx.device.updateDescriptorSets(
+	    vk::WriteDescriptorSet {
+		.dstSet = _sampler_set,
+		.dstBinding = 1,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eSampler,
+		.pImageInfo = &sampler,
+	    },
+	    nullptr);
+	for (uint32_t i = 0; i < count; ++i) {
+		auto &frame = _frames.emplace_back();
+		frame.commands = commands[i];
+		frame.fence = ctx.device.createFence(vk::FenceCreateInfo {
+		    .flags = vk::FenceCreateFlagBits::eSignaled,
+		});
+		frame.instance_set = allocate(_sprite_shader, 3);
+		frame.batch_set = allocate(_batch_shader, 0);
+		reserve(frame.draws,
+		    SpriteBatch::DEFAULT_CAPACITY * sizeof(DrawCommand));
+		reserve(frame.instances,
+		    SpriteBatch::DEFAULT_CAPACITY * sizeof(DrawInstance));
+		write_descriptors(frame);
+	}
+}
+
+bool
+euler::vulkan::SpriteRenderer::reserve(util::Reference<Buffer> &buffer,
+    const vk::DeviceSize size) const
+{
+	if (buffer != nullptr && buffer->size() >= size) return false;
+	const auto capacity
+	    = std::max(size, buffer != nullptr ? buffer->size() * 2 : 0);
+	buffer = util::make_reference<Buffer>(_renderer, capacity,
+	    vk::BufferUsageFlagBits::eStorageBuffer,
+	    vk::MemoryPropertyFlagBits::eHostVisible
+		| vk::MemoryPropertyFlagBits::eHostCoherent);
+	return true;
+}
+
+void
+euler::vulkan::SpriteRenderer::write_descriptors(Frame &frame) const
+{
+	const vk::DescriptorBufferInfo draws = {
+		.buffer = frame.draws->buffer(),
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	const vk::DescriptorBufferInfo instances = {
+		.buffer = frame.instances->buffer(),
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+	const auto buffer = [](const vk::DescriptorSet set,
+				const uint32_t binding,
+				const vk::DescriptorBufferInfo &info) {
+		return vk::WriteDescriptorSet {
+			.dstSet = set,
+			.dstBinding = binding,
+			.dstArrayElement = 0,
+			.descriptorCount = 1,
+			.descriptorType = vk::DescriptorType::eStorageBuffer,
+			.pBufferInfo = &info,
+		};
+	};
+	const std::array writes = {
+		buffer(frame.instance_set, 3, instances),
+		buffer(frame.batch_set, 0, draws),
+		buffer(frame.batch_set, 1, instances),
+	};
+	_renderer->context().device.updateDescriptorSets(writes, nullptr);
+}
+
+void
+euler::vulkan::SpriteRenderer::update()
+{
+	const auto desc = _graph->resolve({});
+	if (_target != nullptr && _target->width() == desc.width
+	    && _target->height() == desc.height)
+		return;
+	_renderer->context().device.waitIdle();
+	destroy_targets();
+	create_targets(desc);
+}
+
+void
+euler::vulkan::SpriteRenderer::create_targets(
+    const RenderGraph::ImageDesc &desc)
+{
+	const auto &ctx = _renderer->context();
+	_target = util::make_reference<OffscreenTarget>(_renderer, desc.width,
+	    desc.height);
+	auto &intermediate = _intermediate;
+	intermediate.image = ctx.device.createImage(vk::ImageCreateInfo {
+	    .imageType = vk::ImageType::e2D,
+	    .format = INTERMEDIATE_FORMAT,
+	    .extent = { desc.width, desc.height, 1 },
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .samples = vk::SampleCountFlagBits::e1,
+	    .tiling = vk::ImageTiling::eOptimal,
+	    .usage = vk::ImageUsageFlagBits::eColorAttachment
+		| vk::ImageUsageFlagBits::eSampled,
+	    .sharingMode = vk::SharingMode::eExclusive,
+	    .initialLayout = vk::ImageLayout::eUndefined,
+	});
+	const auto requirements
+	    = ctx.device.getImageMemoryRequirements(intermediate.image);
+	intermediate.memory = ctx.device.allocateMemory(vk::MemoryAllocateInfo {
+	    .allocationSize = requirements.size,
+	    .memoryTypeIndex = Buffer::find_memory_type(ctx.physical_device,
+		requirements.memoryTypeBits,
+		vk::MemoryPropertyFlagBits::eDeviceLocal),
+	});
+	ctx.device.bindImageMemory(intermediate.image, intermediate.memory, 0);
+	intermediate.view = ctx.device.createImageView(vk::ImageViewCreateInfo {
+	    .image = intermediate.image,
+	    .viewType = vk::ImageViewType::e2D,
+	    .format = INTERMEDIATE_FORMAT,
+	    .subresourceRange = {
+		.aspectMask = vk::ImageAspectFlagBits::eColor,
+		.baseMipLevel = 0,
+		.levelCount = 1,
+		.baseArrayLayer = 0,
+		.layerCount = 1,
+	    },
+	});
+	intermediate.framebuffer
+	    = ctx.device.createFramebuffer(vk::FramebufferCreateInfo {
+		.renderPass = _draw_pass,
+		.attachmentCount = 1,
+		.pAttachments = &intermediate.view,
+		.width = desc.width,
+		.height = desc.height,
+		.layers = 1,
+	    });
+	const auto view = _target->view();
+	_resolve_framebuffer
+	    = ctx.device.createFramebuffer(vk::FramebufferCreateInfo {
+		.renderPass = _resolve_pass,
+		.attachmentCount = 1,
+		.pAttachments = &view,
+		.width = desc.width,
+		.height = desc.height,
+		.layers = 1,
+	    });
+	/* Both passes start from an undefined layout, so neither image
+	 * needs preparing. */
+	const vk::DescriptorImageInfo sprites = {
+		.sampler = _sampler,
+		.imageView = intermediate.view,
+		.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+	};
+	ctx.device.updateDescriptorSets(
+	    vk::WriteDescriptorSet {
+		.dstSet = _resolve_set,
+		.dstBinding = 0,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = vk::DescriptorType::eCombinedImageSampler,
+		.pImageInfo = &sprites,
+	    },
+	    nullptr);
+}
+
+void
+euler::vulkan::SpriteRenderer::destroy_targets()
+{
+	const auto device = _renderer->context().device;
+	device.destroyFramebuffer(_resolve_framebuffer);
+	_resolve_framebuffer = nullptr;
+	device.destroyFramebuffer(_intermediate.framebuffer);
+	device.destroyImageView(_intermediate.view);
+	device.destroyImage(_intermediate.image);
+	device.freeMemory(_intermediate.memory);
+	_intermediate = {};
+	_target = nullptr;
+}
+
+euler::vulkan::Camera::Index
+euler::vulkan::SpriteRenderer::attach_camera(Camera *camera)
+{
+	_cameras.push_back(camera);
+	return _camera_buffer->allocate();
+}
+
+void
+euler::vulkan::SpriteRenderer::detach_camera(Camera *camera)
+{
+	std::erase(_cameras, camera);
+	_camera_buffer->release(camera->index());
+}
+
+void
+euler::vulkan::SpriteRenderer::flush_cameras(const bool default_view)
+{
+	for (const auto camera : _cameras)
+		camera->flush_ubo(*_camera_buffer.get());
+	if (!default_view) return;
+	const auto matrix = Camera::matrix(Camera::vk2d_spec());
+	_camera_buffer->write(_default_index,
+	    std::span(reinterpret_cast<const uint8_t *>(&matrix),
+		sizeof(matrix)));
+}
+
+void
+euler::vulkan::SpriteRenderer::expand(Frame &frame, const uint32_t count)
+{
+	const auto commands = _batch->commands();
+	auto grown = reserve(frame.instances, count * sizeof(DrawInstance));
+	if (_batch->expansion() == SpriteBatch::Expansion::Cpu) {
+		if (grown) write_descriptors(frame);
+		expand_sprites(commands,
+		    std::span(reinterpret_cast<DrawInstance *>(
+				  frame.instances->mapped().data()),
+			count));
+		return;
+	}
+	grown |= reserve(frame.draws, commands.size_bytes());
+	if (grown) write_descriptors(frame);
+	std::memcpy(frame.draws->mapped().data(), commands.data(),
+	    commands.size_bytes());
+	const auto layout = _batch_shader->pipeline_layout();
+	frame.commands.bindPipeline(vk::PipelineBindPoint::eCompute,
+	    _batch_pipeline);
+	frame.commands.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+	    layout, 0, frame.batch_set, nullptr);
+	frame.commands.pushConstants(layout, vk::ShaderStageFlagBits::eCompute,
+	    0, sizeof(count), &count);
+	frame.commands.dispatch((count + BATCH_GROUP_SIZE - 1)
+		/ BATCH_GROUP_SIZE,
+	    1, 1);
+	frame.commands.pipelineBarrier(
+	    vk::PipelineStageFlagBits::eComputeShader,
+	    vk::PipelineStageFlagBits::eVertexShader, {},
+	    vk::MemoryBarrier {
+		.srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+		.dstAccessMask = vk::AccessFlagBits::eShaderRead,
+	    },
+	    nullptr, nullptr);
+}
+
+void
+euler::vulkan::SpriteRenderer::draw_views(const Frame &frame,
+    const uint32_t index, const uint32_t count,
+    const std::span<const Camera *const> views)
+{
+	const vk::Extent2D extent = { _target->width(), _target->height() };
+	frame.commands.beginRenderPass(
+	    vk::RenderPassBeginInfo {
+		.renderPass = _draw_pass,
+		.framebuffer = _intermediate.framebuffer,
+		.renderArea = { .offset = { 0, 0 }, .extent = extent },
+		.clearValueCount = 1,
+		.pClearValues = &TRANSPARENT,
+	    },
+	    vk::SubpassContents::eInline);
+	const auto layout = _sprite_shader->pipeline_layout();
+	frame.commands.bindPipeline(vk::PipelineBindPoint::eGraphics,
+	    _sprite_pipeline);
+	const std::array sets = {
+		_sampler_set,
+		_texture_table->descriptor_set(index),
+		frame.instance_set,
+	};
+	frame.commands.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+	    layout, 1, sets, nullptr);
+	const auto view = [&](const Camera::Index element,
+			      const Camera::Spec &spec) {
+		const auto &rect = spec.on_screen;
+		frame.commands.setViewport(0,
+		    viewport(rect.x, rect.y, rect.w, rect.h));
+		const auto clip
+		    = scissor({ rect.x, rect.y, rect.w, rect.h }, extent);
+		if (clip.extent.width == 0 || clip.extent.height == 0) return;
+		frame.commands.setScissor(0, clip);
+		frame.commands.bindDescriptorSets(
+		    vk::PipelineBindPoint::eGraphics, layout, 0,
+		    _camera_buffer->descriptor_set(),
+		    _camera_buffer->offset(element));
+		/* Six vertices per sprite, found from gl_VertexIndex. */
+		frame.commands.draw(count * 6, 1, 0, 0);
+	};
+	if (views.empty()) view(_default_index, Camera::vk2d_spec());
+	for (const auto camera : views) view(camera->index(), camera->spec());
+	frame.commands.endRenderPass();
+}
+
+void
+euler::vulkan::SpriteRenderer::resolve(const Frame &frame)
+{
+	const vk::Extent2D extent = { _target->width(), _target->height() };
+	frame.commands.beginRenderPass(
+	    vk::RenderPassBeginInfo {
+		.renderPass = _resolve_pass,
+		.framebuffer = _resolve_framebuffer,
+		.renderArea = { .offset = { 0, 0 }, .extent = extent },
+		.clearValueCount = 1,
+		.pClearValues = &TRANSPARENT,
+	    },
+	    vk::SubpassContents::eInline);
+	frame.commands.bindPipeline(vk::PipelineBindPoint::eGraphics,
+	    _resolve_pipeline);
+	frame.commands.setViewport(0,
+	    viewport(0, 0, static_cast<float>(extent.width),
+		static_cast<float>(extent.height)));
+	frame.commands.setScissor(0,
+	    vk::Rect2D { .offset = { 0, 0 }, .extent = extent });
+	frame.commands.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+	    _resolve_shader->pipeline_layout(), 0, _resolve_set, nullptr);
+	/* One triangle covering the target. */
+	frame.commands.draw(3, 1, 0, 0);
+	frame.commands.endRenderPass();
+}
+
+void
+euler::vulkan::SpriteRenderer::draw()
+{
+	_drawn = 0;
+	const auto count = static_cast<uint32_t>(_batch->size());
+	/* Nothing to composite; the pass leaves the target alone. The
+	 * target is missing if update() hasn't run yet. */
+	if (count == 0 || _target == nullptr) {
+		_batch->clear();
+		return;
+	}
+	const auto &ctx = _renderer->context();
+	const auto index = _frame;
+	auto &frame = _frames[index];
+	_frame = (_frame + 1) % static_cast<uint32_t>(_frames.size());
+	if (ctx.device.waitForFences(frame.fence, VK_TRUE, UINT64_MAX)
+	    != vk::Result::eSuccess)
+		throw std::runtime_error("Sprite frame timed out");
+	if (!_sprite_pipeline || !_resolve_pipeline || !_batch_pipeline) {
+		const auto cache = _renderer->pipeline_cache();
+		_sprite_pipeline = cache->pipeline("sprites");
+		_resolve_pipeline = cache->pipeline("sprite_resolve");
+		_batch_pipeline = cache->pipeline("sprite_batch");
+		if (!_sprite_pipeline || !_resolve_pipeline
+		    || !_batch_pipeline)
+			throw std::runtime_error("No sprite pipelines");
+	}
+	sync_render_passes();
+
+	/* The frame's fence has signalled, so its copies of the table and
+	 * camera buffer are free to rewrite. */
+	_texture_table->begin_frame(index);
+	_camera_buffer->begin_frame(index);
+	std::vector<const Camera *> views;
+	for (const auto camera : _cameras)
+		if (camera->state() == Camera::State::Normal)
+			views.push_back(camera);
+	flush_cameras(views.empty());
+
+	frame.commands.reset();
+	frame.commands.begin(vk::CommandBufferBeginInfo {
+	    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+	});
+	expand(frame, count);
+	draw_views(frame, index, count, views);
+	resolve(frame);
+	frame.commands.end();
+	ctx.device.resetFences(frame.fence);
+	/* Submitted ahead of VK2D's frame, so on the queue it comes before
+	 * the composite that samples it. */
+	ctx.graphics_queue.submit(vk::SubmitInfo {
+				      .commandBufferCount = 1,
+				      .pCommandBuffers = &frame.commands,
+				  },
+	    frame.fence);
+	_drawn = count * std::max<size_t>(views.size(), 1);
+	_batch->clear();
+}
+
+void
+euler::vulkan::SpriteRenderer::composite()
+{
+	if (_drawn == 0) return;
+	/* The target covers the screen, so it's drawn one texel per pixel
+	 * under VK2D's camera. Camera rotation is not applied. */
+	const auto spec = Camera::vk2d_spec();
+	const auto zoom = spec.zoom > 0 ? spec.zoom : 1.0f;
+	const auto scale = 1.0f / zoom;
+	const auto texture = _target->texture();
+	float white[4] = { 1, 1, 1, 1 };
+	vk2dRendererSetColourMod(white);
+	vk2dRendererSetBlendMode(VK2D_BLEND_MODE_BLEND);
+	vk2dRendererDrawTexture(texture, spec.x, spec.y, scale, scale, 0, 0, 0,
+	    0, 0, vk2dTextureWidth(texture), vk2dTextureHeight(texture));
+}
@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPRITE_RENDERER_H
+#define EULER_VULKAN_SPRITE_RENDERER_H
+
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/buffer.h"
+#include "euler/vulkan/camera.h"
+#include "euler/vulkan/descriptor_buffer.h"
+#include "euler/vulkan/offscreen_target.h"
+#include "euler/vulkan/render_graph.h"
+#include "euler/vulkan/shader.h"
+#include "euler/vulkan/sprite_batch.h"
+#include "euler/vulkan/texture_table.h"
+#include "euler/vulkan/uploader.h"
+
+namespace euler::vulkan {
+
+/*
+ * Draws a sprite batch with the engine's own pipelines, outside VK2D.
+ *
+ * A "sprites" pass expands the batch's commands into instances, with
+ * spritebatch.comp or on the CPU, and draws them in one instanced draw per
+ * enabled camera, into that camera's on-screen rectangle of a floating
+ * point buffer. Blending into a transparent buffer leaves it premultiplied,
+ * so it is resolved back to straight alpha into a VK2D texture the size of
+ * the backbuffer, which a "sprite_composite" pass draws over the scene.
+ *
+ * Camera matrices come from a DescriptorBuffer bound at each camera's
+ * offset and textures from a TextureTable, so neither is capped. With no
+ * enabled camera, sprites are drawn with VK2D's. Every render pass is our
+ * own and single-sampled, so VK2D's render pass and MSAA setting don't
+ * affect the pipelines; the resolve's is built from the render graph's
+ * barriers.
+ */
+class SpriteRenderer final : public util::Object {
+public:
+	/* Adds the passes before "gui" in graph and registers the
+	 * "sprites", "sprite_resolve" and "sprite_batch" pipelines with the
+	 * renderer's pipeline cache, so it must be created before the cache
+	 * is prewarmed. */
+	SpriteRenderer(const util::Reference<Renderer> &renderer,
+	    const util::Reference<RenderGraph> &graph,
+	    const util::Reference<SpriteBatch> &batch, Uploader &uploader);
+	~SpriteRenderer() override;
+
+	/* Matches the targets to the backbuffer. Waits for the GPU when it
+	 * changes, so it must be called between frames, after the graph's
+	 * backbuffer is set. */
+	void update();
+
+	/* Gives camera an element of the camera buffer. */
+	Camera::Index attach_camera(Camera *camera);
+	void detach_camera(Camera *camera);
+
+	/* Live cameras, in creation order. */
+	[[nodiscard]] std::span<Camera *const>
+	cameras() const
+	{
+		return _cameras;
+	}
+
+	/* The textures sprites sample, indexed by DrawCommand's
+	 * texture_index. Pass it to Atlas::upload(). */
+	[[nodiscard]] const util::Reference<TextureTable> &
+	texture_table() const
+	{
+		return _texture_table;
+	}
+
+	/* Sprites drawn in the last frame, once per camera. */
+	[[nodiscard]] size_t
+	drawn() const
+	{
+		return _drawn;
+	}
+
+private:
+	/* One per frame in flight, reused once its fence signals. */
+	struct Frame {
+		vk::CommandBuffer commands;
+		vk::Fence fence;
+		/* The batch's DrawCommands, read by spritebatch.comp. */
+		util::Reference<Buffer> draws;
+		util::Reference<Buffer> instances;
+		/* Set 3 of the sprite shader and set 0 of the batch
+		 * shader. */
+		vk::DescriptorSet instance_set;
+		vk::DescriptorSet batch_set;
+	};
+
+	/* Premultiplied sprites, resolved into _target. */
+	struct Intermediate {
+		vk::Image image;
+		vk::DeviceMemory memory;
+		vk::ImageView view;
+		vk::Framebuffer framebuffer;
+	};
+
+	/* Rebuilds the resolve's render pass if the graph's barriers
+	 * changed. */
+	void sync_render_passes();
+	void add_pipelines();
+	void create_frames();
+	void create_targets(const RenderGraph::ImageDesc &desc);
+	void destroy_targets();
+	void destroy();
+	void write_descriptors(Frame &frame) const;
+	/* Grows buffer to hold size bytes; returns whether it changed. */
+	bool reserve(util::Reference<Buffer> &buffer,
+	    vk::DeviceSize size) const;
+	/* Writes the matrices that changed into the current frame's region
+	 * of the camera buffer, and the default view's if no camera is
+	 * enabled. */
+	void flush_cameras(bool default_view);
+	void expand(Frame &frame, uint32_t count);
+	/* Draws count instances into the intermediate once per view, or
+	 * with VK2D's camera if there are none. */
+	void draw_views(const Frame &frame, uint32_t index, uint32_t count,
+	    std::span<const Camera *const> views);
+	void resolve(const Frame &frame);
+	void draw();
+	void composite();
+
+	util::Reference<Renderer> _renderer;
+	util::Reference<RenderGraph> _graph;
+	util::Reference<SpriteBatch> _batch;
+	vk::Format _format;
+	RenderGraph::ImageId _sprite_image;
+	RenderGraph::PassId _sprites_pass = 0;
+	util::Reference<OffscreenTarget> _target;
+	Intermediate _intermediate;
+	vk::Framebuffer _resolve_framebuffer;
+	/* The intermediate is cleared and left for the resolve to sample;
+	 * the target is only written by the resolve. */
+	vk::RenderPass _draw_pass;
+	vk::RenderPass _resolve_pass;
+	RenderGraph::Transition _resolve_transition;
+	util::Reference<Shader> _sprite_shader;
+	util::Reference<Shader> _resolve_shader;
+	util::Reference<Shader> _batch_shader;
+	/* Owned by the pipeline cache; fetched on the first draw. */
+	vk::Pipeline _sprite_pipeline;
+	vk::Pipeline _resolve_pipeline;
+	vk::Pipeline _batch_pipeline;
+	util::Reference<DescriptorBuffer> _camera_buffer;
+	util::Reference<TextureTable> _texture_table;
+	/* Nearest, clamped to the edge. */
+	vk::Sampler _sampler;
+	vk::CommandPool _command_pool;
+	vk::DescriptorPool _descriptor_pool;
+	/* Set 1 of the sprite shader and set 0 of the resolve shader. */
+	vk::DescriptorSet _sampler_set;
+	vk::DescriptorSet _resolve_set;
+	std::vector<Frame> _frames;
+	uint32_t _frame = 0;
+	/* Cameras remove themselves when destroyed. */
+	std::vector<Camera *> _cameras;
+	/* VK2D's camera, drawn with when no camera is enabled. Rewritten
+	 * every frame it is used, as VK2D doesn't say when it changes. */
+	Camera::Index _default_index = 0;
+	size_t _drawn = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPRITE_RENDERER_H */
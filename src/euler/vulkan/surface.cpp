@@ -4,10 +4,24 @@
 #include "VK2D/Gui.h"
 #include "VK2D/Renderer.h"
 
+#include <format>
+#include <fstream>
+
+#include "euler/util/png.h"
 #include "euler/vulkan/renderer.h"
 
-euler::vulkan::Surface::Surface() = default;
-euler::vulkan::Surface::~Surface() = default;
+euler::vulkan::Surface::Surface()
+    : _pacer(util::make_reference<FramePacer>())
+    , _sprite_batch(util::make_reference<SpriteBatch>())
+    , _spatial_hash(util::make_reference<SpatialHash>())
+{
+}
+
+euler::vulkan::Surface::~Surface()
+{
+	/* The pipeline builders point at the shaders. */
+	if (_renderer != nullptr) _renderer->pipeline_cache()->wait();
+}
 
 const euler::util::Reference<euler::vulkan::Renderer> &
 euler::vulkan::Surface::renderer() const
@@ -21,23 +35,77 @@ euler::vulkan::Surface::renderer()
 	return _renderer;
 }
 bool
-euler::vulkan::Surface::draw(int &exit_code,
+euler::vulkan::Surface::draw(int &exit_code, util::FrameArena &arena,
     const std::function<bool(int &)> &fn)
 {
+	_sprite_batch->begin_frame(arena);
+	if (_uploader != nullptr) _uploader->update();
+	/* Keep the target alive until the frame ends even if it is swapped
+	 * out while drawing. */
+	const auto offscreen = _offscreen;
+	_render_graph->set_backbuffer(backbuffer_desc(), offscreen);
+	/* May wait for the GPU and free VK2D textures, which can't happen
+	 * during a frame. */
+	_lighting->update();
+	_sprites->update();
 	vk2dRendererStartFrame(util::BLACK.to_float_array().data());
+	if (offscreen != nullptr) offscreen->begin();
 	try {
-		const auto result = fn(exit_code);
+		auto result = false;
+		_scene = [&] { result = fn(exit_code); };
+		_render_graph->execute();
+		_scene = nullptr;
+		if (offscreen != nullptr) offscreen->end();
 		vk2dRendererEndFrame();
+		_pacer->presented();
+		capture();
 		return result;
 	} catch (const std::exception &e) {
 		log()->error("Unhandled exception in frame: {}", e.what());
 	} catch (...) {
 		log()->error("Unknown exception in frame");
 	}
+	/* Don't draw a half-built frame's sprites. */
+	_scene = nullptr;
+	_sprite_batch->clear();
+	if (offscreen != nullptr) offscreen->end();
 	vk2dRendererEndFrame();
+	_pacer->presented();
+	++_frame;
 	return false;
 }
 
+void
+euler::vulkan::Surface::capture_frames(std::set<uint64_t> frames,
+    const std::filesystem::path &directory)
+{
+	if (!frames.empty() && _offscreen == nullptr) {
+		throw std::runtime_error(
+		    "Frame captures need an offscreen target");
+	}
+	if (!frames.empty()) std::filesystem::create_directories(directory);
+	_captures = std::move(frames);
+	_capture_directory = directory;
+}
+
+void
+euler::vulkan::Surface::capture()
+{
+	const auto frame = _frame++;
+	if (_captures.erase(frame) == 0 || _offscreen == nullptr) return;
+	const auto path = _capture_directory
+	    / std::format("frame-{:06}.png", frame);
+	const auto pixels = _offscreen->read_pixels();
+	std::ofstream out(path, std::ios::binary);
+	out << util::encode_png(_offscreen->width(), _offscreen->height(),
+	    pixels);
+	if (!out) {
+		log()->error("Failed to write capture {}", path.string());
+		return;
+	}
+	log()->info("Captured frame {} to {}", frame, path.string());
+}
+
 void
 euler::vulkan::Surface::test_gui()
 {
@@ -74,4 +142,66 @@ void
 euler::vulkan::Surface::set_renderer(const util::Reference<Renderer> &renderer)
 {
 	_renderer = renderer;
+	_uploader = util::make_reference<Uploader>(renderer);
+	refresh_display();
+	configure_pacer(renderer->settings());
+	_render_graph = util::make_reference<RenderGraph>(renderer);
+	using Access = RenderGraph::Access;
+	_render_graph->add_pass("scene")
+	    .write(RenderGraph::BACKBUFFER, Access::ColorWrite)
+	    .execute([this] {
+		    if (_scene) _scene();
+		    _spatial_hash->draw(cameras(), *_sprite_batch.get());
+	    });
+	/* VK2D draws the Nuklear overlay itself when the frame ends; the
+	 * pass only orders it after everything else in the graph. */
+	_render_graph->add_pass("gui")
+	    .write(RenderGraph::BACKBUFFER, Access::ColorBlend)
+	    .side_effects();
+	_lighting = util::make_reference<Lighting>(renderer, _render_graph);
+	_sprites = util::make_reference<SpriteRenderer>(renderer,
+	    _render_graph, _sprite_batch, *_uploader.get());
+}
+
+euler::vulkan::Camera::Index
+euler::vulkan::Surface::attach_camera(Camera *camera)
+{
+	if (_sprites == nullptr)
+		throw std::runtime_error("Cameras need a renderer");
+	return _sprites->attach_camera(camera);
+}
+
+void
+euler::vulkan::Surface::detach_camera(Camera *camera)
+{
+	_sprites->detach_camera(camera);
+}
+
+euler::vulkan::RenderGraph::ImageDesc
+euler::vulkan::Surface::backbuffer_desc() const
+{
+	if (_offscreen != nullptr)
+		return { _offscreen->width(), _offscreen->height() };
+	int width = 0, height = 0;
+	SDL_GetWindowSizeInPixels(window(), &width, &height);
+	return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+}
+
+void
+euler::vulkan::Surface::configure_pacer(const util::RendererConfig &settings)
+{
+	_pacer->set_enabled(settings.low_latency);
+	_pacer->set_frame_limit(settings.frame_limit);
+}
+
+void
+euler::vulkan::Surface::refresh_display()
+{
+	const auto display = SDL_GetDisplayForWindow(window());
+	const auto mode = SDL_GetCurrentDisplayMode(display);
+	/* Unknown rates are reported as zero, which the pacer treats as
+	 * its default. */
+	const auto hz = mode != nullptr ? mode->refresh_rate : 0.0f;
+	_pacer->set_refresh_rate(hz);
+	log()->debug("Display refresh rate: {} Hz", hz);
 }
\ No newline at end of file
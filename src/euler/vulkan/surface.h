@@ -3,20 +3,34 @@
 #ifndef EULER_VULKAN_SURFACE_H
 #define EULER_VULKAN_SURFACE_H
 
+#include <filesystem>
 #include <functional>
+#include <set>
+#include <span>
+#include <vector>
 
 #include <SDL3/SDL.h>
 
+#include "euler/util/arena.h"
 #include "euler/util/color.h"
 #include "euler/util/object.h"
 #include "euler/vulkan/camera.h"
+#include "euler/vulkan/frame_pacer.h"
+#include "euler/vulkan/lighting.h"
+#include "euler/vulkan/offscreen_target.h"
+#include "euler/vulkan/render_graph.h"
 #include "euler/vulkan/texture.h"
 #include "euler/vulkan/renderer.h"
+#include "euler/vulkan/spatial_hash.h"
+#include "euler/vulkan/sprite_batch.h"
+#include "euler/vulkan/sprite_renderer.h"
+#include "euler/vulkan/uploader.h"
 
 namespace euler::vulkan {
 class Renderer;
 
 class Surface : public util::Object {
+	friend class Camera;
 	friend class Renderer;
 public:
 	Surface();
@@ -27,7 +41,107 @@ public:
 	virtual util::Reference<util::Logger> log() const = 0;
 	const util::Reference<Renderer> &renderer() const;
 	util::Reference<Renderer> &renderer();
-	bool draw(int &exit_code, const std::function<bool(int &)> &fn);
+	/* Draws a frame. Per-frame data such as the sprite batch's
+	 * commands is allocated from arena. */
+	bool draw(int &exit_code, util::FrameArena &arena,
+	    const std::function<bool(int &)> &fn);
+
+	/* Submits queued texture uploads before every frame. Null until a
+	 * renderer has been attached. */
+	[[nodiscard]] const util::Reference<Uploader> &
+	uploader() const
+	{
+		return _uploader;
+	}
+
+	/* Drawn by the sprite renderer once the scene has been drawn. */
+	[[nodiscard]] const util::Reference<SpriteBatch> &
+	sprite_batch() const
+	{
+		return _sprite_batch;
+	}
+
+	/* Sprites and tiles kept across frames. Whatever the enabled
+	 * cameras can see is queued into the sprite batch after the draw
+	 * callback, so it is drawn over the callback's sprites and shows
+	 * any moves made during it. */
+	[[nodiscard]] const util::Reference<SpatialHash> &
+	spatial_hash() const
+	{
+		return _spatial_hash;
+	}
+
+	/* Call wait() before polling input each frame; presents are
+	 * reported by draw(). */
+	[[nodiscard]] const util::Reference<FramePacer> &
+	frame_pacer() const
+	{
+		return _pacer;
+	}
+
+	/* Composes every frame. Starts with a "scene" pass, which runs the
+	 * draw callback and queues the spatial hash's visible objects, and a
+	 * "gui" pass after it; other systems, such as
+	 * the sprite renderer, add their own passes around these. Null until
+	 * a renderer has been attached. */
+	[[nodiscard]] const util::Reference<RenderGraph> &
+	render_graph() const
+	{
+		return _render_graph;
+	}
+
+	/* 2D lights and shadows, composed into the render graph once
+	 * enabled. Null until a renderer has been attached. */
+	[[nodiscard]] const util::Reference<Lighting> &
+	lighting() const
+	{
+		return _lighting;
+	}
+
+	/* Draws the sprite batch with the engine's own pipelines. Null
+	 * until a renderer has been attached. */
+	[[nodiscard]] const util::Reference<SpriteRenderer> &
+	sprite_renderer() const
+	{
+		return _sprites;
+	}
+
+	/* Live cameras, in creation order. */
+	[[nodiscard]] std::span<Camera *const>
+	cameras() const
+	{
+		if (_sprites == nullptr) return {};
+		return _sprites->cameras();
+	}
+
+	/* Re-reads the refresh rate of the display the window is on. */
+	void refresh_display();
+
+	/* Draws every following frame into target instead of the
+	 * swapchain. Null restores normal presentation. */
+	void
+	set_offscreen(const util::Reference<OffscreenTarget> &target)
+	{
+		_offscreen = target;
+	}
+
+	[[nodiscard]] const util::Reference<OffscreenTarget> &
+	offscreen() const
+	{
+		return _offscreen;
+	}
+
+	/* Writes the given frames, counted from zero, as PNG files in
+	 * directory. Requires an offscreen target. */
+	void capture_frames(std::set<uint64_t> frames,
+	    const std::filesystem::path &directory);
+
+	/* Frames drawn so far. */
+	[[nodiscard]] uint64_t
+	frame_count() const
+	{
+		return _frame;
+	}
 
 	void test_gui();
 
@@ -37,7 +151,25 @@ protected:
 
 private:
 	void set_renderer(const util::Reference<Renderer> &renderer);
+	Camera::Index attach_camera(Camera *camera);
+	void detach_camera(Camera *camera);
+	void configure_pacer(const util::RendererConfig &settings);
+	void capture();
+	[[nodiscard]] RenderGraph::ImageDesc backbuffer_desc() const;
 	util::Reference<Renderer> _renderer;
+	util::Reference<FramePacer> _pacer;
+	util::Reference<SpriteBatch> _sprite_batch;
+	util::Reference<SpatialHash> _spatial_hash;
+	util::Reference<Uploader> _uploader;
+	util::Reference<OffscreenTarget> _offscreen;
+	util::Reference<RenderGraph> _render_graph;
+	util::Reference<Lighting> _lighting;
+	util::Reference<SpriteRenderer> _sprites;
+	/* The draw callback of the frame in progress. */
+	std::function<void()> _scene;
+	std::set<uint64_t> _captures;
+	std::filesystem::path _capture_directory;
+	uint64_t _frame = 0;
 };
 
 } /* namespace euler::vulkan */
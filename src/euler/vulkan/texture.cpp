@@ -2,3 +2,71 @@
 
 #include "euler/vulkan/texture.h"
 
+#include <array>
+
+#include "euler/vulkan/buffer.h"
+
+euler::vulkan::Texture::Texture(const util::Reference<Renderer> &renderer,
+    const uint32_t width, const uint32_t height, const vk::Format format)
+    : _renderer(renderer)
+    , _format(format)
+    , _width(width)
+    , _height(height)
+{
+	const auto &ctx = renderer->context();
+	/* With a separate transfer queue, sharing the image avoids a queue
+	 * family ownership transfer after every upload. */
+	const std::array families = { ctx.graphics_family, ctx.transfer_family };
+	const auto concurrent = ctx.transfer_queue
+	    && ctx.transfer_family != ctx.graphics_family;
+	_image = ctx.device.createImage(vk::ImageCreateInfo {
+	    .imageType = vk::ImageType::e2D,
+	    .format = format,
+	    .extent = { width, height, 1 },
+	    .mipLevels = 1,
+	    .arrayLayers = 1,
+	    .samples = vk::SampleCountFlagBits::e1,
+	    .tiling = vk::ImageTiling::eOptimal,
+	    .usage = vk::ImageUsageFlagBits::eSampled
+		| vk::ImageUsageFlagBits::eTransferDst,
+	    .sharingMode = concurrent ? vk::SharingMode::eConcurrent
+				      : vk::SharingMode::eExclusive,
+	    .queueFamilyIndexCount = concurrent ? 2u : 0u,
+	    .pQueueFamilyIndices = concurrent ? families.data() : nullptr,
+	    .initialLayout = vk::ImageLayout::eUndefined,
+	});
+	const auto requirements = ctx.device.getImageMemoryRequirements(_image);
+	try {
+		_memory = ctx.device.allocateMemory(vk::MemoryAllocateInfo {
+		    .allocationSize = requirements.size,
+		    .memoryTypeIndex = Buffer::find_memory_type(
+			ctx.physical_device, requirements.memoryTypeBits,
+			vk::MemoryPropertyFlagBits::eDeviceLocal),
+		});
+		ctx.device.bindImageMemory(_image, _memory, 0);
+		_view = ctx.device.createImageView(vk::ImageViewCreateInfo {
+		    .image = _image,
+		    .viewType = vk::ImageViewType::e2D,
+		    .format = format,
+		    .subresourceRange = {
+			.aspectMask = vk::ImageAspectFlagBits::eColor,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		    },
+		});
+	} catch (...) {
+		ctx.device.destroyImage(_image);
+		ctx.device.freeMemory(_memory);
+		throw;
+	}
+}
+
+euler::vulkan::Texture::~Texture()
+{
+	const auto device = _renderer->context().device;
+	device.destroyImageView(_view);
+	device.destroyImage(_image);
+	device.freeMemory(_memory);
+}
@@ -3,18 +3,74 @@
 #ifndef EULER_VULKAN_TEXTURE_H
 #define EULER_VULKAN_TEXTURE_H
 
-#include <filesystem>
+#include <atomic>
 
-#include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan.hpp>
 
 #include "euler/util/object.h"
+#include "euler/vulkan/renderer.h"
 
 namespace euler::vulkan {
 
+/* A sampled 2D image. Its contents are filled in by the Uploader; until the
+ * upload has completed, ready() is false and the image must not be drawn. */
 class Texture final : public util::Object {
 public:
-	Texture(const std::filesystem::path &path);
+	static constexpr auto DEFAULT_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+	Texture(const util::Reference<Renderer> &renderer, uint32_t width,
+	    uint32_t height, vk::Format format = DEFAULT_FORMAT);
 	~Texture() override;
+
+	[[nodiscard]] vk::Image
+	image() const
+	{
+		return _image;
+	}
+
+	[[nodiscard]] vk::ImageView
+	view() const
+	{
+		return _view;
+	}
+
+	[[nodiscard]] vk::Format
+	format() const
+	{
+		return _format;
+	}
+
+	[[nodiscard]] uint32_t
+	width() const
+	{
+		return _width;
+	}
+
+	[[nodiscard]] uint32_t
+	height() const
+	{
+		return _height;
+	}
+
+	[[nodiscard]] bool
+	ready() const
+	{
+		return _ready.load(std::memory_order_acquire);
+	}
+
+private:
+	friend class Uploader;
+
+	util::Reference<Renderer> _renderer;
+	vk::Image _image;
+	vk::DeviceMemory _memory;
+	vk::ImageView _view;
+	vk::Format _format;
+	uint32_t _width;
+	uint32_t _height;
+	/* Layout the last upload left the image in. */
+	vk::ImageLayout _layout = vk::ImageLayout::eUndefined;
+	std::atomic<bool> _ready = false;
 };
 
 } /* namespace euler::vulkan */
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/texture_table.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+
+euler::vulkan::TextureTable::TextureTable(
+    const util::Reference<Renderer> &renderer,
+    const util::Reference<Shader> &shader, const uint32_t set,
+    Uploader &uploader)
+    : _renderer(renderer)
+    , _shader(shader)
+    , _set_index(set)
+{
+	auto found = false;
+	for (const auto &binding : shader->bindings()) {
+		if (binding.set != set) continue;
+		if (found || binding.count != 0
+		    || binding.type != vk::DescriptorType::eSampledImage) {
+			throw std::runtime_error(std::format(
+			    "Descriptor set {} is not a texture table", set));
+		}
+		found = true;
+		_binding = binding.binding;
+	}
+	if (!found) {
+		throw std::runtime_error(
+		    std::format("Shader has no descriptor set {}", set));
+	}
+	_capacity = Shader::MAX_BINDLESS_DESCRIPTORS;
+
+	const auto &ctx = renderer->context();
+	const auto frames = ctx.frames_in_flight;
+	const vk::DescriptorPoolSize size = {
+		.type = vk::DescriptorType::eSampledImage,
+		.descriptorCount = _capacity * frames,
+	};
+	/* The layout is update-after-bind, which its pool has to be too. */
+	_pool = ctx.device.createDescriptorPool(vk::DescriptorPoolCreateInfo {
+	    .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+	    .maxSets = frames,
+	    .poolSizeCount = 1,
+	    .pPoolSizes = &size,
+	});
+	try {
+		const std::vector layouts(frames, shader->set_layouts()[set]);
+		_sets = ctx.device.allocateDescriptorSets(
+		    vk::DescriptorSetAllocateInfo {
+			.descriptorPool = _pool,
+			.descriptorSetCount = frames,
+			.pSetLayouts = layouts.data(),
+		    });
+		_placeholder = util::make_reference<Texture>(renderer, 1, 1);
+		const std::array<uint8_t, 4> transparent = {};
+		uploader.upload(_placeholder, transparent);
+		uploader.finish();
+	} catch (...) {
+		ctx.device.destroyDescriptorPool(_pool);
+		throw;
+	}
+	_stale.resize(frames);
+}
+
+euler::vulkan::TextureTable::~TextureTable()
+{
+	/* Frames may still sample the sets. */
+	const auto device = _renderer->context().device;
+	device.waitIdle();
+	device.destroyDescriptorPool(_pool);
+}
+
+void
+euler::vulkan::TextureTable::touch(const Slot slot)
+{
+	for (auto &stale : _stale) stale.push_back(slot);
+}
+
+euler::vulkan::TextureTable::Slot
+euler::vulkan::TextureTable::add(const util::Reference<Texture> &texture)
+{
+	if (const auto it = _slots.find(texture.get()); it != _slots.end())
+		return it->second;
+	Slot slot;
+	if (!_free.empty()) {
+		slot = _free.back();
+		_free.pop_back();
+	} else if (_textures.size() < _capacity) {
+		slot = static_cast<Slot>(_textures.size());
+		_textures.emplace_back();
+	} else {
+		throw std::runtime_error(std::format(
+		    "Texture table is full ({} slots)", _capacity));
+	}
+	_textures[slot] = texture;
+	_slots.emplace(texture.get(), slot);
+	if (!texture->ready()) _loading.push_back(slot);
+	touch(slot);
+	return slot;
+}
+
+void
+euler::vulkan::TextureTable::remove(const Slot slot)
+{
+	if (slot >= _textures.size() || _textures[slot] == nullptr) {
+		throw std::runtime_error(
+		    std::format("No texture in slot {}", slot));
+	}
+	_slots.erase(_textures[slot].get());
+	std::erase(_loading, slot);
+	/* The sets keep pointing at the texture until the slot is reused,
+	 * which is fine as they are partially bound and nothing samples
+	 * it. */
+	_retired.push_back(
+	    Retired { slot, _frame, std::move(_textures[slot]) });
+	_textures[slot] = nullptr;
+}
+
+void
+euler::vulkan::TextureTable::remove(const util::Reference<Texture> &texture)
+{
+	const auto it = _slots.find(texture.get());
+	if (it == _slots.end()) return;
+	remove(it->second);
+}
+
+void
+euler::vulkan::TextureTable::begin_frame(const uint32_t frame)
+{
+	++_frame;
+	const auto frames = _renderer->context().frames_in_flight;
+	while (!_retired.empty() && _retired.front().frame + frames <= _frame) {
+		_free.push_back(_retired.front().slot);
+		_retired.pop_front();
+	}
+	/* Swaps the placeholder out of every set once the upload is
+	 * done. */
+	std::erase_if(_loading, [&](const Slot slot) {
+		if (!_textures[slot]->ready()) return false;
+		touch(slot);
+		return true;
+	});
+
+	auto &stale = _stale.at(frame);
+	if (stale.empty()) return;
+	std::ranges::sort(stale);
+	const auto [first, last] = std::ranges::unique(stale);
+	stale.erase(first, last);
+	std::vector<vk::DescriptorImageInfo> images;
+	images.reserve(stale.size());
+	std::vector<vk::WriteDescriptorSet> writes;
+	for (const auto slot : stale) {
+		/* Freed since; its descriptor is never sampled. */
+		const auto &texture = _textures[slot];
+		if (texture == nullptr) continue;
+		const auto &view = texture->ready() ? texture : _placeholder;
+		images.push_back(vk::DescriptorImageInfo {
+		    .imageView = view->view(),
+		    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+		});
+		writes.push_back(vk::WriteDescriptorSet {
+		    .dstSet = _sets[frame],
+		    .dstBinding = _binding,
+		    .dstArrayElement = slot,
+		    .descriptorCount = 1,
+		    .descriptorType = vk::DescriptorType::eSampledImage,
+		    .pImageInfo = &images.back(),
+		});
+	}
+	_renderer->context().device.updateDescriptorSets(writes, nullptr);
+	stale.clear();
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_TEXTURE_TABLE_H
+#define EULER_VULKAN_TEXTURE_TABLE_H
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/shader.h"
+#include "euler/vulkan/texture.h"
+#include "euler/vulkan/uploader.h"
+
+namespace euler::vulkan {
+
+/*
+ * Every texture a sprite batch may sample, in one descriptor set that is
+ * bound once per frame and indexed by slot in the shader, like tex[] in
+ * instanced.frag. DrawCommand::texture_index is a slot.
+ *
+ * Each frame in flight has its own copy of the set. begin_frame() brings a
+ * frame's copy up to date once its fence has signalled, so a descriptor is
+ * never rewritten while a frame that may sample it is still running. A
+ * texture whose upload hasn't completed samples as transparent until it
+ * has.
+ *
+ * Removed slots are recycled once every frame that could still sample them
+ * has finished, and the table keeps the texture alive until then.
+ *
+ * Main thread only.
+ */
+class TextureTable final : public util::Object {
+public:
+	using Slot = uint32_t;
+
+	/* The table is the descriptor set set of shader, which must contain
+	 * exactly one binding: a runtime-sized array of sampled images.
+	 * Uploads the transparent placeholder through uploader and waits
+	 * for it. */
+	TextureTable(const util::Reference<Renderer> &renderer,
+	    const util::Reference<Shader> &shader, uint32_t set,
+	    Uploader &uploader);
+	~TextureTable() override;
+
+	/* Returns the texture's slot, adding it if it has none. Throws once
+	 * every slot is taken. */
+	Slot add(const util::Reference<Texture> &texture);
+	/* The slot may be handed out again after the frames in flight. */
+	void remove(Slot slot);
+	void remove(const util::Reference<Texture> &texture);
+
+	/* Recycles slots removed at least frames_in_flight frames ago and
+	 * rewrites the slots of frame's set that changed since it last
+	 * began. Call once frame's fence has signalled, before recording
+	 * anything that binds its set. */
+	void begin_frame(uint32_t frame);
+
+	[[nodiscard]] vk::DescriptorSet
+	descriptor_set(const uint32_t frame) const
+	{
+		return _sets.at(frame);
+	}
+
+	[[nodiscard]] uint32_t
+	set_index() const
+	{
+		return _set_index;
+	}
+
+	[[nodiscard]] uint32_t
+	capacity() const
+	{
+		return _capacity;
+	}
+
+	/* Slots holding a texture, not counting those waiting to be
+	 * recycled. */
+	[[nodiscard]] size_t
+	size() const
+	{
+		return _slots.size();
+	}
+
+private:
+	struct Retired {
+		Slot slot;
+		uint64_t frame;
+		util::Reference<Texture> texture;
+	};
+
+	/* Marks slot for rewriting in every frame's set. */
+	void touch(Slot slot);
+
+	util::Reference<Renderer> _renderer;
+	/* Owns the set layout. */
+	util::Reference<Shader> _shader;
+	uint32_t _set_index;
+	uint32_t _binding = 0;
+	uint32_t _capacity = 0;
+	vk::DescriptorPool _pool;
+	/* One per frame in flight. */
+	std::vector<vk::DescriptorSet> _sets;
+	/* Slots each frame's set has yet to rewrite. */
+	std::vector<std::vector<Slot>> _stale;
+	/* 1x1 and transparent, sampled in place of textures that aren't
+	 * ready. */
+	util::Reference<Texture> _placeholder;
+	/* Indexed by slot; null for free and retired slots. */
+	std::vector<util::Reference<Texture>> _textures;
+	std::unordered_map<const Texture *, Slot> _slots;
+	/* Slots whose texture is still uploading. */
+	std::vector<Slot> _loading;
+	std::vector<Slot> _free;
+	std::deque<Retired> _retired;
+	uint64_t _frame = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_TEXTURE_TABLE_H */
@@ -0,0 +1,313 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/uploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr vk::ImageSubresourceRange COLOR_RANGE = {
+	.aspectMask = vk::ImageAspectFlagBits::eColor,
+	.baseMipLevel = 0,
+	.levelCount = 1,
+	.baseArrayLayer = 0,
+	.layerCount = 1,
+};
+
+/* Stages that sample textures on the graphics queue. */
+static constexpr vk::PipelineStageFlags SHADER_STAGES
+    = vk::PipelineStageFlagBits::eFragmentShader
+    | vk::PipelineStageFlagBits::eComputeShader;
+
+static vk::DeviceSize
+texel_size(const vk::Format format)
+{
+	switch (format) {
+	case vk::Format::eR8Unorm: return 1;
+	case vk::Format::eR8G8Unorm: return 2;
+	case vk::Format::eR8G8B8A8Unorm: [[fallthrough]];
+	case vk::Format::eR8G8B8A8Srgb: [[fallthrough]];
+	case vk::Format::eB8G8R8A8Unorm: [[fallthrough]];
+	case vk::Format::eB8G8R8A8Srgb: return 4;
+	case vk::Format::eR16G16B16A16Sfloat: return 8;
+	default: throw std::runtime_error("Unsupported texture upload format");
+	}
+}
+
+euler::vulkan::Uploader::Uploader(const util::Reference<Renderer> &renderer,
+    const vk::DeviceSize staging_size, const vk::DeviceSize frame_budget)
+    : _renderer(renderer)
+    , _frame_budget(frame_budget)
+{
+	const auto &ctx = renderer->context();
+	if (ctx.transfer_queue) {
+		_queue = ctx.transfer_queue;
+		_family = ctx.transfer_family;
+	} else {
+		renderer->log()->debug(
+		    "No transfer queue, uploading on the graphics queue");
+		_queue = ctx.graphics_queue;
+		_family = ctx.graphics_family;
+	}
+	_pool = ctx.device.createCommandPool(vk::CommandPoolCreateInfo {
+	    .flags = vk::CommandPoolCreateFlagBits::eTransient
+		| vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+	    .queueFamilyIndex = _family,
+	});
+	_staging = util::make_reference<Buffer>(renderer, staging_size,
+	    vk::BufferUsageFlagBits::eTransferSrc,
+	    vk::MemoryPropertyFlagBits::eHostVisible
+		| vk::MemoryPropertyFlagBits::eHostCoherent);
+	/* Copy offsets must be multiples of the texel size and of the
+	 * optimal alignment; 16 covers every format we accept. */
+	_alignment = std::max<vk::DeviceSize>(16,
+	    ctx.physical_device.getProperties()
+		.limits.optimalBufferCopyOffsetAlignment);
+}
+
+euler::vulkan::Uploader::~Uploader()
+{
+	const auto device = _renderer->context().device;
+	for (const auto &sub : _in_flight) {
+		(void)device.waitForFences(sub.fence, VK_TRUE, UINT64_MAX);
+		device.destroyFence(sub.fence);
+	}
+	for (const auto &sub : _free) device.destroyFence(sub.fence);
+	/* Destroying the pool frees its command buffers. */
+	device.destroyCommandPool(_pool);
+}
+
+euler::vulkan::Uploader::Serial
+euler::vulkan::Uploader::upload(const util::Reference<Texture> &texture,
+    const std::span<const uint8_t> pixels, vk::Rect2D region)
+{
+	if (region.extent.width == 0 || region.extent.height == 0)
+		region = vk::Rect2D { { 0, 0 },
+			{ texture->width(), texture->height() } };
+	const auto bytes = texel_size(texture->format()) * region.extent.width
+	    * region.extent.height;
+	if (pixels.size() < bytes)
+		throw std::runtime_error("Too few pixels for texture upload");
+	if (bytes > _staging->size())
+		throw std::runtime_error(
+		    "Texture upload is larger than the staging ring");
+	std::lock_guard lock(_mutex);
+	const auto serial = ++_next_serial;
+	_pending.push_back(Pending {
+	    texture,
+	    region,
+	    std::vector(pixels.begin(), pixels.begin() + bytes),
+	    serial,
+	});
+	return serial;
+}
+
+size_t
+euler::vulkan::Uploader::pending() const
+{
+	std::lock_guard lock(_mutex);
+	return _pending.size();
+}
+
+void
+euler::vulkan::Uploader::retire()
+{
+	const auto device = _renderer->context().device;
+	while (!_in_flight.empty()) {
+		auto &sub = _in_flight.front();
+		if (device.getFenceStatus(sub.fence) != vk::Result::eSuccess)
+			break;
+		for (const auto &texture : sub.textures)
+			texture->_ready.store(true, std::memory_order_release);
+		_used -= sub.ring_bytes;
+		_tail = sub.ring_end;
+		if (_used == 0) _head = _tail = 0;
+		_completed.store(sub.serial, std::memory_order_release);
+		sub.textures.clear();
+		_free.push_back(std::move(sub));
+		_in_flight.pop_front();
+	}
+}
+
+std::optional<vk::DeviceSize>
+euler::vulkan::Uploader::allocate(const vk::DeviceSize size,
+    vk::DeviceSize &consumed)
+{
+	const auto capacity = _staging->size();
+	const auto offset = (_head + _alignment - 1) / _alignment * _alignment;
+	if (_used == 0 || _head > _tail) {
+		/* Free space is [head, capacity) followed by [0, tail). */
+		if (offset + size <= capacity) {
+			consumed = offset + size - _head;
+			_head = offset + size;
+			return offset;
+		}
+		if (size <= _tail || (_used == 0 && size <= capacity)) {
+			consumed = capacity - _head + size;
+			_head = size;
+			return 0;
+		}
+		return std::nullopt;
+	}
+	/* Wrapped: free space is [head, tail). */
+	if (offset + size > _tail) return std::nullopt;
+	consumed = offset + size - _head;
+	_head = offset + size;
+	return offset;
+}
+
+euler::vulkan::Uploader::Submission
+euler::vulkan::Uploader::acquire_submission()
+{
+	const auto device = _renderer->context().device;
+	if (!_free.empty()) {
+		auto sub = std::move(_free.back());
+		_free.pop_back();
+		device.resetFences(sub.fence);
+		sub.commands.reset();
+		return sub;
+	}
+	Submission sub;
+	sub.commands = device.allocateCommandBuffers(
+	    vk::CommandBufferAllocateInfo {
+		.commandPool = _pool,
+		.level = vk::CommandBufferLevel::ePrimary,
+		.commandBufferCount = 1,
+	    })
+			   .front();
+	sub.fence = device.createFence({});
+	return sub;
+}
+
+void
+euler::vulkan::Uploader::update()
+{
+	retire();
+	std::deque<Pending> batch;
+	vk::DeviceSize budget = _frame_budget;
+	{
+		std::lock_guard lock(_mutex);
+		/* Always take at least one upload so oversized ones still
+		 * make progress. */
+		while (!_pending.empty()) {
+			const vk::DeviceSize size = _pending.front().pixels.size();
+			if (!batch.empty() && size > budget) break;
+			budget -= std::min(budget, size);
+			batch.push_back(std::move(_pending.front()));
+			_pending.pop_front();
+		}
+	}
+	if (batch.empty()) return;
+
+	auto sub = acquire_submission();
+	sub.commands.begin(vk::CommandBufferBeginInfo {
+	    .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+	});
+	const auto on_graphics
+	    = _family == _renderer->context().graphics_family;
+	size_t staged = 0;
+	for (auto &item : batch) {
+		vk::DeviceSize consumed = 0;
+		const auto offset = allocate(item.pixels.size(), consumed);
+		/* Ring is full of in-flight uploads; try again next frame. */
+		if (!offset.has_value()) break;
+		std::memcpy(_staging->mapped().data() + *offset,
+		    item.pixels.data(), item.pixels.size());
+		sub.ring_bytes += consumed;
+		_used += consumed;
+		sub.ring_end = _head;
+
+		auto &texture = *item.texture.get();
+		const auto to_transfer = vk::ImageMemoryBarrier {
+			.srcAccessMask = vk::AccessFlagBits::eNone,
+			.dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.oldLayout = texture._layout,
+			.newLayout = vk::ImageLayout::eTransferDstOptimal,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = texture.image(),
+			.subresourceRange = COLOR_RANGE,
+		};
+		/* On the graphics queue, wait for earlier frames to finish
+		 * sampling the old contents. */
+		sub.commands.pipelineBarrier(on_graphics
+			? SHADER_STAGES
+			: vk::PipelineStageFlagBits::eTopOfPipe,
+		    vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+		    to_transfer);
+		sub.commands.copyBufferToImage(_staging->buffer(),
+		    texture.image(), vk::ImageLayout::eTransferDstOptimal,
+		    vk::BufferImageCopy {
+			.bufferOffset = *offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+			    .aspectMask = vk::ImageAspectFlagBits::eColor,
+			    .mipLevel = 0,
+			    .baseArrayLayer = 0,
+			    .layerCount = 1,
+			},
+			.imageOffset = { item.region.offset.x,
+			    item.region.offset.y, 0 },
+			.imageExtent = { item.region.extent.width,
+			    item.region.extent.height, 1 },
+		    });
+		const auto to_shader = vk::ImageMemoryBarrier {
+			.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+			.dstAccessMask = on_graphics
+			    ? vk::AccessFlagBits::eShaderRead
+			    : vk::AccessFlagBits::eNone,
+			.oldLayout = vk::ImageLayout::eTransferDstOptimal,
+			.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = texture.image(),
+			.subresourceRange = COLOR_RANGE,
+		};
+		/* Textures are only marked ready once the fence has been
+		 * observed, which orders the copy before any later
+		 * submission that samples them. */
+		sub.commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+		    on_graphics ? SHADER_STAGES
+				: vk::PipelineStageFlagBits::eBottomOfPipe,
+		    {}, nullptr, nullptr, to_shader);
+		texture._layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		sub.textures.push_back(item.texture);
+		sub.serial = item.serial;
+		++staged;
+	}
+	sub.commands.end();
+
+	if (staged < batch.size()) {
+		/* Put back what didn't fit, keeping submission order. */
+		std::lock_guard lock(_mutex);
+		for (auto it = batch.rbegin();
+		    it != batch.rend() - static_cast<ptrdiff_t>(staged); ++it)
+			_pending.push_front(std::move(*it));
+	}
+	if (staged == 0) {
+		_free.push_back(std::move(sub));
+		return;
+	}
+	_queue.submit(vk::SubmitInfo {
+			  .commandBufferCount = 1,
+			  .pCommandBuffers = &sub.commands,
+		      },
+	    sub.fence);
+	_in_flight.push_back(std::move(sub));
+}
+
+void
+euler::vulkan::Uploader::finish()
+{
+	const auto device = _renderer->context().device;
+	for (;;) {
+		update();
+		for (const auto &sub : _in_flight) {
+			(void)device.waitForFences(sub.fence, VK_TRUE,
+			    UINT64_MAX);
+		}
+		retire();
+		if (pending() == 0) return;
+	}
+}
@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_UPLOADER_H
+#define EULER_VULKAN_UPLOADER_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/buffer.h"
+#include "euler/vulkan/texture.h"
+
+namespace euler::vulkan {
+
+/*
+ * Streams texture data to the GPU without stalling the frame. Pixels are
+ * queued from any thread; once per frame, update() copies as much of the
+ * queue as the frame budget allows into a persistently mapped staging ring
+ * and submits the copies, preferring a dedicated transfer queue.
+ *
+ * Completion is reported through serials: every upload() returns one, and
+ * completed() turns true once the GPU has finished that upload and every
+ * upload queued before it. The uploader never waits on the GPU except when
+ * it is destroyed.
+ */
+class Uploader final : public util::Object {
+public:
+	using Serial = uint64_t;
+
+	static constexpr vk::DeviceSize DEFAULT_STAGING_SIZE = 64 << 20;
+	static constexpr vk::DeviceSize DEFAULT_FRAME_BUDGET = 8 << 20;
+
+	explicit Uploader(const util::Reference<Renderer> &renderer,
+	    vk::DeviceSize staging_size = DEFAULT_STAGING_SIZE,
+	    vk::DeviceSize frame_budget = DEFAULT_FRAME_BUDGET);
+	~Uploader() override;
+
+	/* Queues tightly packed pixels for region of texture. An empty
+	 * region means the whole texture. Thread-safe. */
+	Serial upload(const util::Reference<Texture> &texture,
+	    std::span<const uint8_t> pixels, vk::Rect2D region = {});
+
+	/* Retires finished uploads and submits queued ones. Main thread,
+	 * outside of a frame. */
+	void update();
+	/* Submits everything queued and waits for it. Stalls, so only for
+	 * startup. Main thread, outside of a frame. */
+	void finish();
+
+	[[nodiscard]] bool
+	completed(const Serial serial) const
+	{
+		return serial <= _completed;
+	}
+
+	[[nodiscard]] Serial
+	completed_serial() const
+	{
+		return _completed;
+	}
+
+	/* Uploads queued but not yet submitted. */
+	[[nodiscard]] size_t pending() const;
+
+	void
+	set_frame_budget(const vk::DeviceSize budget)
+	{
+		_frame_budget = budget;
+	}
+
+private:
+	struct Pending {
+		util::Reference<Texture> texture;
+		vk::Rect2D region;
+		std::vector<uint8_t> pixels;
+		Serial serial;
+	};
+
+	struct Submission {
+		vk::CommandBuffer commands;
+		vk::Fence fence;
+		Serial serial = 0;
+		/* Ring space released when this submission retires. */
+		vk::DeviceSize ring_end = 0;
+		vk::DeviceSize ring_bytes = 0;
+		std::vector<util::Reference<Texture>> textures;
+	};
+
+	void retire();
+	std::optional<vk::DeviceSize> allocate(vk::DeviceSize size,
+	    vk::DeviceSize &consumed);
+	Submission acquire_submission();
+
+	util::Reference<Renderer> _renderer;
+	vk::Queue _queue;
+	uint32_t _family;
+	vk::CommandPool _pool;
+	util::Reference<Buffer> _staging;
+	vk::DeviceSize _alignment;
+	vk::DeviceSize _frame_budget;
+	/* Staging ring: bytes in [_tail, _head) modulo size are in flight. */
+	vk::DeviceSize _head = 0;
+	vk::DeviceSize _tail = 0;
+	vk::DeviceSize _used = 0;
+	std::deque<Submission> _in_flight;
+	std::vector<Submission> _free;
+	std::atomic<Serial> _completed = 0;
+
+	mutable std::mutex _mutex;
+	std::deque<Pending> _pending;
+	Serial _next_serial = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_UPLOADER_H */